@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -30,7 +30,36 @@ SOURCES += \
     highlighter.cpp \
     completelistwidget.cpp \
     console.cpp \
-    findreplacedialog.cpp
+    findreplacedialog.cpp \
+    filesaver.cpp \
+    editjournal.cpp \
+    undohistory.cpp \
+    findengine.cpp \
+    projectfiles.cpp \
+    findinfiles.cpp \
+    trigramindex.cpp \
+    gotofiledialog.cpp \
+    editortab.cpp \
+    compilecache.cpp \
+    builder.cpp \
+    precompiledheader.cpp \
+    includegraph.cpp \
+    projectbuilder.cpp \
+    outputdecoder.cpp \
+    diagnostics.cpp \
+    syntaxchecker.cpp \
+    runprofiler.cpp \
+    profilepanel.cpp \
+    benchmark.cpp \
+    benchmarkdialog.cpp \
+    runconfiguration.cpp \
+    runconfigurationdialog.cpp \
+    testrunner.cpp \
+    testpanel.cpp \
+    runlimitsdialog.cpp \
+    pythonrunner.cpp \
+    startupprofiler.cpp \
+    tokencache.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -38,7 +67,36 @@ HEADERS += \
     highlighter.h \
     completelistwidget.h \
     console.h \
-    findreplacedialog.h
+    findreplacedialog.h \
+    filesaver.h \
+    editjournal.h \
+    undohistory.h \
+    findengine.h \
+    projectfiles.h \
+    findinfiles.h \
+    trigramindex.h \
+    gotofiledialog.h \
+    editortab.h \
+    compilecache.h \
+    builder.h \
+    precompiledheader.h \
+    includegraph.h \
+    projectbuilder.h \
+    outputdecoder.h \
+    diagnostics.h \
+    syntaxchecker.h \
+    runprofiler.h \
+    profilepanel.h \
+    benchmark.h \
+    benchmarkdialog.h \
+    runconfiguration.h \
+    runconfigurationdialog.h \
+    testrunner.h \
+    testpanel.h \
+    runlimitsdialog.h \
+    pythonrunner.h \
+    startupprofiler.h \
+    tokencache.h
 
 FORMS += \
         mainwindow.ui
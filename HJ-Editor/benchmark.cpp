@@ -0,0 +1,333 @@
+#include "benchmark.h"
+#include "runprofiler.h"
+#include <QtConcurrent>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int MaxRecords = 50;
+
+// 双侧 95% 的 t 分布临界值，自由度 1..30
+const double TCritical[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+double tCritical(int degrees)
+{
+    if (degrees <= 0)
+        return 0;
+    if (degrees <= 30)
+        return TCritical[degrees - 1];
+    if (degrees <= 60)
+        return 2.000;
+    if (degrees <= 120)
+        return 1.980;
+    return 1.960;
+}
+
+QJsonObject toJson(const BenchmarkRecord &record)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("revision"), record.revision);
+    object.insert(QStringLiteral("configuration"), record.configuration);
+    object.insert(QStringLiteral("time"), record.time.toString(Qt::ISODate));
+    object.insert(QStringLiteral("warmups"), record.options.warmups);
+    object.insert(QStringLiteral("trials"), record.options.trials);
+    object.insert(QStringLiteral("input"), record.options.input);
+    object.insert(QStringLiteral("cpu"), record.options.cpu);
+    object.insert(QStringLiteral("count"), record.stats.count);
+    object.insert(QStringLiteral("median"), record.stats.median);
+    object.insert(QStringLiteral("p95"), record.stats.p95);
+    object.insert(QStringLiteral("mean"), record.stats.mean);
+    object.insert(QStringLiteral("stddev"), record.stats.stddev);
+    object.insert(QStringLiteral("meanLow"), record.stats.meanLow);
+    object.insert(QStringLiteral("meanHigh"), record.stats.meanHigh);
+    object.insert(QStringLiteral("medianLow"), record.stats.medianLow);
+    object.insert(QStringLiteral("medianHigh"), record.stats.medianHigh);
+    return object;
+}
+
+BenchmarkRecord fromJson(const QJsonObject &object)
+{
+    BenchmarkRecord record;
+    record.revision = object.value(QStringLiteral("revision")).toString();
+    // 引入运行配置之前的记录都是用默认的 Debug 配置得到的
+    record.configuration = object.value(QStringLiteral("configuration")).toString(QStringLiteral("debug"));
+    record.time = QDateTime::fromString(object.value(QStringLiteral("time")).toString(), Qt::ISODate);
+    record.options.warmups = object.value(QStringLiteral("warmups")).toInt();
+    record.options.trials = object.value(QStringLiteral("trials")).toInt();
+    record.options.input = object.value(QStringLiteral("input")).toString();
+    record.options.cpu = object.value(QStringLiteral("cpu")).toInt(-1);
+    record.stats.count = object.value(QStringLiteral("count")).toInt();
+    record.stats.median = object.value(QStringLiteral("median")).toDouble();
+    record.stats.p95 = object.value(QStringLiteral("p95")).toDouble();
+    record.stats.mean = object.value(QStringLiteral("mean")).toDouble();
+    record.stats.stddev = object.value(QStringLiteral("stddev")).toDouble();
+    record.stats.meanLow = object.value(QStringLiteral("meanLow")).toDouble();
+    record.stats.meanHigh = object.value(QStringLiteral("meanHigh")).toDouble();
+    record.stats.medianLow = object.value(QStringLiteral("medianLow")).toDouble();
+    record.stats.medianHigh = object.value(QStringLiteral("medianHigh")).toDouble();
+    return record;
+}
+
+} // namespace
+
+BenchmarkOptions BenchmarkOptions::load()
+{
+    QSettings settings;
+    BenchmarkOptions options;
+    options.warmups = settings.value(QStringLiteral("benchmark/warmups"), 3).toInt();
+    options.trials = qMax(2, settings.value(QStringLiteral("benchmark/trials"), 20).toInt());
+    options.input = settings.value(QStringLiteral("benchmark/input")).toString();
+    options.cpu = settings.value(QStringLiteral("benchmark/cpu"), -1).toInt();
+    return options;
+}
+
+void BenchmarkOptions::save() const
+{
+    QSettings settings;
+    settings.setValue(QStringLiteral("benchmark/warmups"), warmups);
+    settings.setValue(QStringLiteral("benchmark/trials"), trials);
+    settings.setValue(QStringLiteral("benchmark/input"), input);
+    settings.setValue(QStringLiteral("benchmark/cpu"), cpu);
+}
+
+BenchmarkStats BenchmarkStats::compute(QVector<double> samples)
+{
+    BenchmarkStats stats;
+    std::sort(samples.begin(), samples.end());
+    const int n = samples.size();
+    stats.count = n;
+    if (n == 0) {
+        stats.median = stats.p95 = stats.mean = stats.stddev = 0;
+        stats.meanLow = stats.meanHigh = stats.medianLow = stats.medianHigh = 0;
+        return stats;
+    }
+    stats.median = n % 2 ? samples.at(n / 2) : (samples.at(n / 2 - 1) + samples.at(n / 2)) / 2;
+    // 分位数在相邻样本之间线性插值
+    double position = 0.95 * (n - 1);
+    int below = int(std::floor(position));
+    int above = qMin(below + 1, n - 1);
+    stats.p95 = samples.at(below) + (samples.at(above) - samples.at(below)) * (position - below);
+
+    double sum = 0;
+    for (double sample : samples)
+        sum += sample;
+    stats.mean = sum / n;
+    double squares = 0;
+    for (double sample : samples)
+        squares += (sample - stats.mean) * (sample - stats.mean);
+    stats.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+    double margin = tCritical(n - 1) * stats.stddev / std::sqrt(double(n));
+    stats.meanLow = stats.mean - margin;
+    stats.meanHigh = stats.mean + margin;
+
+    // 中位数的区间取第 j、k 个样本，j、k = n/2 ∓ 1.96·√n/2（二项分布的正态近似）
+    double spread = 1.96 * std::sqrt(double(n)) / 2;
+    int low = qBound(1, int(std::floor(n / 2.0 - spread)), n);
+    int high = qBound(1, int(std::ceil(n / 2.0 + 1 + spread)), n);
+    stats.medianLow = samples.at(low - 1);
+    stats.medianHigh = samples.at(high - 1);
+    return stats;
+}
+
+Benchmark::Benchmark(QObject *parent) : QObject(parent)
+{
+    running = false;
+    pool.setMaxThreadCount(1);
+    connect(&watcher, &QFutureWatcher<BenchmarkResult>::finished, this, &Benchmark::runFinished);
+}
+
+Benchmark::~Benchmark()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void Benchmark::start(const QString &binary, const QString &workingDirectory, const BenchmarkOptions &options,
+                      const RunLimits &limits, bool addressSpace)
+{
+    cancel();
+    cancelFlag.reset(new QAtomicInt(0));
+    running = true;
+    QSharedPointer<QAtomicInt> flag = cancelFlag;
+    const QString wrapper = RunProfiler::isSupported() ? QCoreApplication::applicationFilePath() : QString();
+    const QStringList wrapperOptions = RunProfiler::pinningOptions(options.cpu)
+                                       + RunProfiler::limitOptions(limits, addressSpace);
+    watcher.setFuture(QtConcurrent::run(&pool, [this, wrapper, binary, workingDirectory, options, wrapperOptions,
+                                                limits, flag] {
+        return run(wrapper, binary, workingDirectory, options, wrapperOptions, limits, flag.data());
+    }));
+}
+
+void Benchmark::cancel()
+{
+    if (cancelFlag)
+        cancelFlag->store(1);
+    running = false;
+}
+
+bool Benchmark::isRunning() const
+{
+    return running;
+}
+
+void Benchmark::runFinished()
+{
+    if (!running)
+        return;
+    running = false;
+    emit finished(watcher.result());
+}
+
+// 后台线程：逐次运行，任何一次异常结束都中止整个测试
+BenchmarkResult Benchmark::run(const QString &wrapper, const QString &binary, const QString &workingDirectory,
+                               const BenchmarkOptions &options, const QStringList &wrapperOptions,
+                               const RunLimits &limits, const QAtomicInt *cancel)
+{
+    BenchmarkResult result;
+    result.ok = false;
+    const QString report = RunProfiler::reportPath(QStringLiteral("benchmark.txt"));
+    const int total = options.warmups + options.trials;
+    for (int i = 0; i < total; ++i) {
+        QProcess process;
+        process.setWorkingDirectory(workingDirectory);
+        process.setStandardInputFile(options.input.isEmpty() ? QProcess::nullDevice() : options.input);
+        process.setStandardOutputFile(QProcess::nullDevice());
+        process.setStandardErrorFile(QProcess::nullDevice());
+        QFile::remove(report);
+        // 不支持包装进程的平台上退而求其次，计时包含创建进程的开销
+        QElapsedTimer timer;
+        timer.start();
+        if (wrapper.isEmpty())
+            process.start(binary, QStringList());
+        else
+            process.start(wrapper, RunProfiler::wrapperArguments(report, binary, QStringList(), wrapperOptions));
+        if (!process.waitForStarted()) {
+            result.error = process.errorString();
+            return result;
+        }
+        while (!process.waitForFinished(50) && process.state() != QProcess::NotRunning) {
+            if (cancel->load()) {
+                process.kill();
+                process.waitForFinished();
+                QFile::remove(report);
+                return result;
+            }
+        }
+        double elapsed = timer.nsecsElapsed() / 1e6;
+        int exitCode = process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+        if (!wrapper.isEmpty()) {
+            RunProfile profile = RunProfiler::readReport(report);
+            if (!profile.valid) {
+                result.error = tr("第 %1 次运行没有得到计时结果").arg(i + 1);
+                return result;
+            }
+            // 超出运行限制的那次运行被包装进程结束，给出判定而不是信号编号
+            if (profile.verdict == RunProfile::TimeLimitExceeded || profile.verdict == RunProfile::MemoryLimitExceeded
+                    || profile.verdict == RunProfile::OutputLimitExceeded) {
+                result.error = tr("第 %1 次运行%2，限制：%3").arg(i + 1).arg(profile.verdictText()).arg(limits.describe());
+                QFile::remove(report);
+                return result;
+            }
+            elapsed = profile.wallTime / 1000.0;
+            exitCode = profile.signal ? -profile.signal : profile.exitCode;
+        }
+        if (exitCode != 0) {
+            result.error = exitCode < 0 ? tr("第 %1 次运行被信号 %2 结束").arg(i + 1).arg(-exitCode)
+                                        : tr("第 %1 次运行的退出码为 %2").arg(i + 1).arg(exitCode);
+            QFile::remove(report);
+            return result;
+        }
+        if (i >= options.warmups)
+            result.samples.append(elapsed);
+        emit progress(i + 1, total);
+    }
+    QFile::remove(report);
+    result.ok = true;
+    return result;
+}
+
+QString Benchmark::historyPath(const QString &source)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String("/benchmarks");
+    QDir().mkpath(dir);
+    return dir + QLatin1Char('/')
+           + QString::fromLatin1(QCryptographicHash::hash(source.toUtf8(), QCryptographicHash::Sha1).toHex())
+           + QLatin1String(".json");
+}
+
+QVector<BenchmarkRecord> Benchmark::history(const QString &source)
+{
+    QVector<BenchmarkRecord> records;
+    QFile in(historyPath(source));
+    if (!in.open(QIODevice::ReadOnly))
+        return records;
+    for (const QJsonValue &value : QJsonDocument::fromJson(in.readAll()).array())
+        records.append(fromJson(value.toObject()));
+    return records;
+}
+
+void Benchmark::record(const QString &source, const BenchmarkRecord &record)
+{
+    QVector<BenchmarkRecord> records = history(source);
+    records.append(record);
+    if (records.size() > MaxRecords)
+        records.remove(0, records.size() - MaxRecords);
+    QJsonArray array;
+    for (const BenchmarkRecord &entry : records)
+        array.append(toJson(entry));
+    QSaveFile out(historyPath(source));
+    if (!out.open(QIODevice::WriteOnly))
+        return;
+    out.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+    out.commit();
+}
+
+QString Benchmark::describe(const BenchmarkRecord &record)
+{
+    const BenchmarkStats &stats = record.stats;
+    return tr("%1 次（预热 %2 次）：中位数 %3 ms [%4, %5]，p95 %6 ms，均值 %7 ms [%8, %9]，标准差 %10 ms")
+        .arg(stats.count).arg(record.options.warmups)
+        .arg(stats.median, 0, 'f', 3).arg(stats.medianLow, 0, 'f', 3).arg(stats.medianHigh, 0, 'f', 3)
+        .arg(stats.p95, 0, 'f', 3)
+        .arg(stats.mean, 0, 'f', 3).arg(stats.meanLow, 0, 'f', 3).arg(stats.meanHigh, 0, 'f', 3)
+        .arg(stats.stddev, 0, 'f', 3);
+}
+
+// 以中位数比较；两个中位数的置信区间不重叠时才认为差异可信
+QString Benchmark::compare(const BenchmarkRecord &record, const QVector<BenchmarkRecord> &history)
+{
+    for (int i = history.size() - 1; i >= 0; --i) {
+        const BenchmarkRecord &previous = history.at(i);
+        if (previous.revision == record.revision || previous.configuration != record.configuration
+            || previous.options.input != record.options.input || previous.stats.median <= 0)
+            continue;
+        double change = (record.stats.median - previous.stats.median) / previous.stats.median * 100;
+        bool significant = record.stats.medianHigh < previous.stats.medianLow
+                           || record.stats.medianLow > previous.stats.medianHigh;
+        QString verdict = !significant ? tr("差异在误差范围内")
+                                       : (change < 0 ? tr("变快了") : tr("变慢了"));
+        return tr("与上一版本（%1）相比：中位数 %2 ms → %3 ms（%4%5%），%6")
+            .arg(previous.time.toString(QStringLiteral("MM-dd HH:mm")))
+            .arg(previous.stats.median, 0, 'f', 3).arg(record.stats.median, 0, 'f', 3)
+            .arg(change >= 0 ? QStringLiteral("+") : QString()).arg(change, 0, 'f', 1)
+            .arg(verdict);
+    }
+    return QString();
+}
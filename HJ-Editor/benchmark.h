@@ -0,0 +1,99 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QDateTime>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include "runprofiler.h"
+
+// 基准测试的设置，保存在 QSettings 的 benchmark/ 下
+struct BenchmarkOptions {
+    int warmups;     // 预热次数，不计入样本
+    int trials;      // 计入样本的次数
+    QString input;   // 每次运行的标准输入文件，空表示没有输入
+    int cpu;         // 固定运行的核，-1 表示不固定
+
+    static BenchmarkOptions load();
+    void save() const;
+};
+
+// 一组墙钟时间样本（毫秒）的统计量，置信水平均为 95%
+struct BenchmarkStats {
+    int count;
+    double median;
+    double p95;
+    double mean;
+    double stddev;       // 样本标准差
+    double meanLow;      // 均值的置信区间（t 分布）
+    double meanHigh;
+    double medianLow;    // 中位数的置信区间（次序统计量，不假设分布）
+    double medianHigh;
+
+    static BenchmarkStats compute(QVector<double> samples);
+};
+
+struct BenchmarkResult {
+    bool ok;
+    QString error;
+    QVector<double> samples;   // 毫秒，不含预热
+};
+
+// 历史记录中的一次基准测试，revision 为源文件内容的 SHA-1，configuration 为运行配置的 id
+struct BenchmarkRecord {
+    QString revision;
+    QString configuration;
+    QDateTime time;
+    BenchmarkOptions options;
+    BenchmarkStats stats;
+};
+
+// 基准测试：在后台线程中把编译好的程序依次运行“预热 + 样本”次，标准输入每次都从同一个文件读取，
+// 输出丢弃。计时经性能分析的包装进程取得，只包含被测程序从 exec 到退出的时间，
+// 不含编辑器启动进程的开销；也由包装进程把程序固定在指定的核上，并施加与普通运行相同的运行限制。
+// 结果按源文件保存历史，与上一个不同版本（同一输入）的结果比较，判断修改是否变快。
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Benchmark(QObject *parent = nullptr);
+    ~Benchmark();
+
+    // addressSpace 见 RunProfiler::limitOptions
+    void start(const QString &binary, const QString &workingDirectory, const BenchmarkOptions &options,
+               const RunLimits &limits, bool addressSpace);
+    // 结束正在运行的程序，不再发出 finished
+    void cancel();
+    bool isRunning() const;
+
+    static QVector<BenchmarkRecord> history(const QString &source);
+    static void record(const QString &source, const BenchmarkRecord &record);
+    static QString describe(const BenchmarkRecord &record);
+    // 与历史中上一个不同版本（同一运行配置、同一输入）的比较，没有可比较的记录时返回空
+    static QString compare(const BenchmarkRecord &record, const QVector<BenchmarkRecord> &history);
+
+signals:
+    // 在后台线程中发出
+    void progress(int done, int total);
+    void finished(const BenchmarkResult &result);
+
+private slots:
+    void runFinished();
+
+private:
+    BenchmarkResult run(const QString &wrapper, const QString &binary, const QString &workingDirectory,
+                        const BenchmarkOptions &options, const QStringList &wrapperOptions,
+                        const RunLimits &limits, const QAtomicInt *cancel);
+    static QString historyPath(const QString &source);
+
+    QThreadPool pool;   // 单线程
+    QFutureWatcher<BenchmarkResult> watcher;
+    QSharedPointer<QAtomicInt> cancelFlag;
+    bool running;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,79 @@
+#include "benchmarkdialog.h"
+#include <QSpinBox>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QThread>
+
+BenchmarkDialog::BenchmarkDialog(QWidget *parent) : QDialog(parent)
+{
+    setWindowTitle("基准测试设置");
+
+    warmupBox = new QSpinBox(this);
+    trialBox = new QSpinBox(this);
+    inputEdit = new QLineEdit(this);
+    pinCheckBox = new QCheckBox("固定在核", this);
+    cpuBox = new QSpinBox(this);
+    QPushButton *browseButton = new QPushButton("浏览...", this);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    warmupBox->setRange(0, 100);
+    trialBox->setRange(2, 10000);
+    cpuBox->setRange(0, qMax(0, QThread::idealThreadCount() - 1));
+    inputEdit->setPlaceholderText("不提供输入");
+    inputEdit->setClearButtonEnabled(true);
+
+    QHBoxLayout *inputLayout = new QHBoxLayout;
+    inputLayout->addWidget(inputEdit);
+    inputLayout->addWidget(browseButton);
+    QHBoxLayout *cpuLayout = new QHBoxLayout;
+    cpuLayout->addWidget(pinCheckBox);
+    cpuLayout->addWidget(cpuBox);
+    cpuLayout->addStretch();
+    QFormLayout *form = new QFormLayout;
+    form->addRow("预热次数:", warmupBox);
+    form->addRow("测试次数:", trialBox);
+    form->addRow("标准输入:", inputLayout);
+    form->addRow("CPU:", cpuLayout);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(form);
+    mainLayout->addWidget(buttons);
+    setLayout(mainLayout);
+
+    connect(browseButton, &QPushButton::clicked, this, &BenchmarkDialog::chooseInput);
+    connect(pinCheckBox, &QCheckBox::toggled, cpuBox, &QSpinBox::setEnabled);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+}
+
+void BenchmarkDialog::setOptions(const BenchmarkOptions &options)
+{
+    warmupBox->setValue(options.warmups);
+    trialBox->setValue(options.trials);
+    inputEdit->setText(options.input);
+    pinCheckBox->setChecked(options.cpu >= 0);
+    cpuBox->setEnabled(options.cpu >= 0);
+    cpuBox->setValue(qMax(0, options.cpu));
+}
+
+BenchmarkOptions BenchmarkDialog::options() const
+{
+    BenchmarkOptions options;
+    options.warmups = warmupBox->value();
+    options.trials = trialBox->value();
+    options.input = inputEdit->text().trimmed();
+    options.cpu = pinCheckBox->isChecked() ? cpuBox->value() : -1;
+    return options;
+}
+
+void BenchmarkDialog::chooseInput()
+{
+    QString path = QFileDialog::getOpenFileName(this, tr("选择标准输入文件"), inputEdit->text());
+    if (!path.isEmpty())
+        inputEdit->setText(path);
+}
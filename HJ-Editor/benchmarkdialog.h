@@ -0,0 +1,34 @@
+#ifndef BENCHMARKDIALOG_H
+#define BENCHMARKDIALOG_H
+
+#include <QDialog>
+#include "benchmark.h"
+
+QT_BEGIN_NAMESPACE
+class QSpinBox;
+class QLineEdit;
+class QCheckBox;
+QT_END_NAMESPACE
+
+// “基准测试设置”：预热与样本次数、标准输入文件、是否固定在某个核上运行
+class BenchmarkDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit BenchmarkDialog(QWidget *parent = nullptr);
+    void setOptions(const BenchmarkOptions &options);
+    BenchmarkOptions options() const;
+
+private slots:
+    void chooseInput();
+
+private:
+    QSpinBox *warmupBox;
+    QSpinBox *trialBox;
+    QLineEdit *inputEdit;
+    QCheckBox *pinCheckBox;
+    QSpinBox *cpuBox;
+};
+
+#endif // BENCHMARKDIALOG_H
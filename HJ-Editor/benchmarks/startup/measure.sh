@@ -0,0 +1,27 @@
+#!/bin/sh
+# 反复启动编辑器测量启动时间：每次以 --startup-profile 启动，第一次绘制完成后报告时间线并退出。
+# 用法：measure.sh 编辑器可执行文件 [次数]
+# 第一次通常是冷启动（Qt 库不在页缓存中），其余为热启动；要测冷启动需先以 root 执行
+#   sync; echo 3 > /proc/sys/vm/drop_caches
+# 没有显示器时可设 QT_QPA_PLATFORM=offscreen（绘制路径不同，结果偏乐观）。
+
+editor=${1:?usage: $0 editor-binary [runs]}
+runs=${2:-10}
+log=$(mktemp) || exit 1
+trap 'rm -f "$log"' EXIT
+
+i=1
+while [ "$i" -le "$runs" ]; do
+    echo "== 第 $i 次"
+    HJ_STARTUP_PROFILE=1 HJ_STARTUP_PROFILE_QUIT=1 "$editor" 2>&1 | tee -a "$log"
+    i=$((i + 1))
+done
+
+# 汇总“第一次可交互绘制 N ms”
+grep -o '第一次可交互绘制 [0-9]* ms' "$log" | awk '{ print $2 }' | sort -n | awk '
+    { value[NR] = $1 }
+    END {
+        if (NR == 0) { print "没有取得时间线"; exit 1 }
+        printf "共 %d 次：最小 %d ms，中位数 %d ms，最大 %d ms（目标 150 ms）\n",
+               NR, value[1], value[int((NR + 1) / 2)], value[NR]
+    }'
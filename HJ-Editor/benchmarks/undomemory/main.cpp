@@ -0,0 +1,138 @@
+#include "undohistory.h"
+#include <QGuiApplication>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QElapsedTimer>
+#include <QFile>
+#include <cstdio>
+#include <cstdlib>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+
+enum Mode {
+    NoUndo,          // 不记录撤销，作为基线
+    DocumentUndo,    // QTextDocument 自带的撤销栈（原来的做法）
+    DeltaHistory     // UndoHistory
+};
+
+// 堆上正在使用的字节数；没有 glibc 时退回常驻内存
+qint64 heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return qint64(mallinfo2().uordblks);
+#else
+    QFile status(QStringLiteral("/proc/self/statm"));
+    if (!status.open(QIODevice::ReadOnly))
+        return 0;
+    const QList<QByteArray> fields = status.readAll().split(' ');
+    return fields.value(1).toLongLong() * 4096;
+#endif
+}
+
+// 约 1 MB 的类 C++ 文本
+QString sampleText()
+{
+    QString text;
+    for (int i = 0; text.size() < (1 << 20); ++i)
+        text += QString("    int value%1 = compute(value%2, %3); // 第 %1 行\n").arg(i).arg(i / 2).arg(i * 7);
+    return text;
+}
+
+// 固定种子的编辑序列：七成连续输入一个字符，两成删除，一成在别处粘贴一段
+struct Edit {
+    int position;
+    int removed;
+    QString added;
+};
+
+QVector<Edit> editScript(int count, int textSize)
+{
+    QVector<Edit> edits;
+    unsigned seed = 12345;
+    auto next = [&seed] { seed = seed * 1103515245 + 12345; return int((seed >> 8) & 0x7fffff); };
+    int cursor = textSize / 2;
+    int size = textSize;
+    const QString paste = QString("for (int i = 0; i < n; ++i)\n    sum += data[i];\n").repeated(4);
+    for (int i = 0; i < count; ++i) {
+        Edit edit;
+        const int kind = next() % 10;
+        if (kind < 7) {
+            edit.position = cursor;
+            edit.removed = 0;
+            edit.added = QString(QChar('a' + next() % 26));
+        } else if (kind < 9) {
+            edit.position = qMax(cursor - 1, 0);
+            edit.removed = cursor > 0 ? 1 : 0;
+        } else {
+            cursor = next() % size;
+            edit.position = cursor;
+            edit.removed = 0;
+            edit.added = paste;
+        }
+        cursor = edit.position + edit.added.size();
+        size += edit.added.size() - edit.removed;
+        edits.append(edit);
+    }
+    return edits;
+}
+
+void measure(Mode mode, const QString &text, const QVector<Edit> &edits)
+{
+    QTextDocument document;
+    document.setUndoRedoEnabled(false);
+    document.setPlainText(text);
+
+    // 在创建历史之前取基准，UndoHistory 的文本镜像（文档的第二份拷贝）也要算进去
+    const qint64 before = heapInUse();
+    UndoHistory *history = nullptr;
+    if (mode == DocumentUndo) {
+        document.setUndoRedoEnabled(true);
+    } else if (mode == DeltaHistory) {
+        history = new UndoHistory(&document);
+        history->setMemoryBudget(qint64(1) << 40);   // 不限预算，测的是全部留在内存中的大小
+    }
+    const qint64 setup = heapInUse() - before;
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextCursor cursor(&document);
+    for (const Edit &edit : edits) {
+        cursor.setPosition(edit.position);
+        if (edit.removed > 0) {
+            cursor.setPosition(edit.position + edit.removed, QTextCursor::KeepAnchor);
+            cursor.removeSelectedText();
+        }
+        if (!edit.added.isEmpty())
+            cursor.insertText(edit.added);
+    }
+    const qint64 elapsed = timer.elapsed();
+    const qint64 used = heapInUse() - before;
+
+    static const char *names[] = {"无撤销（基线）", "QTextDocument 撤销栈", "UndoHistory"};
+    printf("%-24s 堆增长 %9.1f KB  用时 %5lld ms", names[mode], used / 1024.0, elapsed);
+    if (history)
+        printf("  其中镜像 %9.1f KB  历史自报 %9.1f KB", setup / 1024.0, history->memoryUsage() / 1024.0);
+    printf("\n");
+    delete history;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    const int count = argc > 1 ? atoi(argv[1]) : 10000;
+    const QString text = sampleText();
+    const QVector<Edit> edits = editScript(count, text.size());
+    printf("文本 %d 个字符，%d 次编辑\n", text.size(), count);
+    // 减去基线后即为撤销记录本身的开销
+    measure(NoUndo, text, edits);
+    measure(DocumentUndo, text, edits);
+    measure(DeltaHistory, text, edits);
+    return 0;
+}
@@ -0,0 +1,18 @@
+# 撤销历史内存基准：同样的 1 万次编辑，比较 QTextDocument 自带的撤销栈与 UndoHistory 的内存占用
+# qmake && make && ./undomemory [编辑次数]
+
+QT       += core gui
+
+TARGET = undomemory
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+        main.cpp \
+    ../../undohistory.cpp
+
+HEADERS += \
+    ../../undohistory.h
@@ -0,0 +1,369 @@
+#include "builder.h"
+#include "compilecache.h"
+#include "precompiledheader.h"
+#include "projectbuilder.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <QProcess>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QMutex>
+#include <QHash>
+
+namespace {
+
+const QByteArray CacheKeyVersion("hj-build-1");
+const QByteArray DirectKeyVersion("hj-direct-1");
+const qint64 TimestampSlack = 2000;   // 部分文件系统的修改时间精度只有 1~2 秒
+
+} // namespace
+
+Builder::Builder(QObject *parent) : QObject(parent)
+{
+    building = false;
+    pool.setMaxThreadCount(1);
+    headerPool.setMaxThreadCount(1);
+    headerCancel.reset(new QAtomicInt(0));
+    connect(&watcher, &QFutureWatcher<BuildResult>::finished, this, &Builder::buildFinished);
+}
+
+Builder::~Builder()
+{
+    cancel();
+    headerCancel->store(1);
+    // 构建线程可能还会向 headerPool 提交任务，先等它结束
+    pool.waitForDone();
+    headerPool.waitForDone();
+}
+
+void Builder::start(const BuildRequest &request)
+{
+    cancel();
+    cancelFlag.reset(new QAtomicInt(0));
+    building = true;
+    QSharedPointer<QAtomicInt> flag = cancelFlag;
+    QSharedPointer<QAtomicInt> headerFlag = headerCancel;
+    QThreadPool *headers = &headerPool;
+    IncludeGraph *graph = &includeGraph;
+    // setFuture 会丢弃上一个 future 尚未投递的 finished 通知
+    watcher.setFuture(QtConcurrent::run(&pool, [request, flag, headers, headerFlag, graph] {
+        if (request.project)
+            return buildProject(request, graph, flag.data());
+        return build(request, graph, flag.data(), headers, headerFlag);
+    }));
+}
+
+void Builder::warmUp(const BuildRequest &request)
+{
+    QSharedPointer<QAtomicInt> headerFlag = headerCancel;
+    QThreadPool *headers = &headerPool;
+    QtConcurrent::run(&headerPool, [request, headers, headerFlag] {
+        QByteArray identity = compilerIdentity(request.compiler, headerFlag.data());
+        if (!identity.isEmpty())
+            precompiledHeader(request, identity, headers, headerFlag);
+    });
+}
+
+void Builder::cancel()
+{
+    if (cancelFlag)
+        cancelFlag->store(1);
+    building = false;
+}
+
+bool Builder::isBuilding() const
+{
+    return building;
+}
+
+void Builder::buildFinished()
+{
+    if (!building)
+        return;
+    building = false;
+    emit finished(watcher.result());
+}
+
+bool Builder::runTool(const QString &program, const QStringList &arguments, const QAtomicInt *cancel,
+                      QByteArray *standardOutput, QByteArray *standardError, int *exitCode,
+                      QCryptographicHash *hash, const std::function<void(const QByteArray &)> &onStandardError)
+{
+    QProcess process;
+    process.start(program, arguments);
+    if (!process.waitForStarted()) {
+        if (standardError)
+            *standardError = process.errorString().toLocal8Bit();
+        return false;
+    }
+    process.closeWriteChannel();
+    for (;;) {
+        // 边运行边取走输出，预处理结果可能有几 MB，直接进入哈希不必整块保存
+        bool done = process.waitForFinished(50);
+        QByteArray out = process.readAllStandardOutput();
+        if (hash)
+            hash->addData(out);
+        else if (standardOutput)
+            standardOutput->append(out);
+        QByteArray err = process.readAllStandardError();
+        if (onStandardError) {
+            if (!err.isEmpty())
+                onStandardError(err);
+        } else if (standardError) {
+            standardError->append(err);
+        }
+        if (done || process.state() == QProcess::NotRunning)
+            break;
+        if (cancel && cancel->load()) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+    }
+    if (exitCode)
+        *exitCode = process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+    return true;
+}
+
+QString Builder::compilerStamp(const QString &compiler)
+{
+    QString executable = QStandardPaths::findExecutable(compiler);
+    if (executable.isEmpty())
+        executable = compiler;
+    QFileInfo info(executable);
+    return info.canonicalFilePath() + QLatin1Char(':') + QString::number(info.size())
+           + QLatin1Char(':') + QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+// 编译器的版本信息加上可执行文件的大小与修改时间，升级编译器后缓存自然失效
+QByteArray Builder::compilerIdentity(const QString &compiler, const QAtomicInt *cancel)
+{
+    static QMutex mutex;
+    static QHash<QString, QByteArray> identities;
+
+    QString executable = QStandardPaths::findExecutable(compiler);
+    if (executable.isEmpty())
+        executable = compiler;
+    const QString stamp = compilerStamp(compiler);
+    {
+        QMutexLocker locker(&mutex);
+        auto it = identities.constFind(stamp);
+        if (it != identities.constEnd())
+            return it.value();
+    }
+    QByteArray version;
+    int exitCode = -1;
+    if (!runTool(executable, QStringList() << QStringLiteral("--version"), cancel, &version, nullptr, &exitCode) || exitCode != 0)
+        return QByteArray();
+    QByteArray identity = stamp.toUtf8() + '\n' + version;
+    QMutexLocker locker(&mutex);
+    identities.insert(stamp, identity);
+    return identity;
+}
+
+QStringList Builder::diagnosticOptions(const QString &compiler, const QByteArray &identity, const QAtomicInt *cancel)
+{
+    static QMutex mutex;
+    static QHash<QByteArray, bool> supported;
+
+    if (!QSettings().value(QStringLiteral("build/jsonDiagnostics"), true).toBool())
+        return QStringList();
+    const QStringList json = QStringList() << QStringLiteral("-fdiagnostics-format=json");
+    {
+        QMutexLocker locker(&mutex);
+        auto it = supported.constFind(identity);
+        if (it != supported.constEnd())
+            return it.value() ? json : QStringList();
+    }
+    // 用空输入试一次，不认识该选项的编译器会报错退出
+    int exitCode = -1;
+    QStringList probe = json;
+    probe << QStringLiteral("-fsyntax-only") << QStringLiteral("-x") << QStringLiteral("c++") << QStringLiteral("/dev/null");
+    if (!runTool(compiler, probe, cancel, nullptr, nullptr, &exitCode))
+        return QStringList();
+    QMutexLocker locker(&mutex);
+    supported.insert(identity, exitCode == 0);
+    return exitCode == 0 ? json : QStringList();
+}
+
+QString Builder::precompiledHeader(const BuildRequest &request, const QByteArray &identity,
+                                   QThreadPool *headerPool, const QSharedPointer<QAtomicInt> &headerCancel)
+{
+    if (!QSettings().value(QStringLiteral("build/precompiledHeaders"), true).toBool())
+        return QString();
+    QByteArray includes = PrecompiledHeader::leadingIncludes(request.source);
+    if (includes.isEmpty())
+        return QString();
+    bool ready = false;
+    QString header = PrecompiledHeader::headerPath(identity, request.flags, includes, &ready);
+    if (ready)
+        return header;
+    // 这一次照常编译，预编译头建好后的运行才用上它
+    QtConcurrent::run(headerPool, [request, header, includes, headerCancel] {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        PrecompiledHeader::build(request.compiler, request.flags, header, includes, headerCancel.data());
+    });
+    return QString();
+}
+
+bool Builder::useCached(const CompileCache &cache, const QByteArray &key, BuildResult *result)
+{
+    QString binary = cache.lookup(key);
+    if (binary.isEmpty())
+        return false;
+    // 第一次编译时的警告随缓存条目保存，重新解析后照样标在编辑器中
+    const QByteArray log = cache.log(key);
+    if (!log.isEmpty()) {
+        DiagnosticParser parser;
+        parser.feed(log);
+        parser.finish();
+        result->output = parser.text();
+        result->diagnostics = parser.diagnostics();
+    }
+    result->ok = true;
+    result->cacheHit = true;
+    result->binary = binary;
+    return true;
+}
+
+// 工作线程：直接模式或预处理求键，查缓存，未命中时编译并放入缓存
+BuildResult Builder::build(const BuildRequest &request, IncludeGraph *graph, const QAtomicInt *cancel,
+                           QThreadPool *headerPool, const QSharedPointer<QAtomicInt> &headerCancel)
+{
+    QElapsedTimer timer;
+    timer.start();
+    BuildResult result;
+    result.ok = false;
+    result.cacheHit = false;
+    result.elapsed = 0;
+    result.linkElapsed = -1;
+
+    QByteArray identity = compilerIdentity(request.compiler, cancel);
+    if (identity.isEmpty()) {
+        result.output = tr("无法启动编译器 ") + request.compiler + QLatin1Char('\n');
+        return result;
+    }
+
+    QSettings settings;
+    CompileCache cache(CompileCache::defaultDirectory(request.configuration),
+                       settings.value(QStringLiteral("build/cacheSizeMB"), 512).toLongLong() << 20);
+
+    QCryptographicHash options(QCryptographicHash::Sha1);
+    options.addData(identity);
+    for (const QString &flag : request.flags) {
+        options.addData("\0", 1);
+        options.addData(flag.toUtf8());
+    }
+    const QByteArray optionsHash = options.result();
+
+    // 直接模式：键由源文件路径与内容、编译器与选项组成，清单再核对项目内头文件是否变化。
+    // 系统头文件不在依赖图中，它们随编译器版本与选项一起由键覆盖
+    const QString source = QFileInfo(request.source).absoluteFilePath();
+    QFile sourceFile(source);
+    QByteArray directKey;
+    QByteArray dependencies;
+    if (sourceFile.open(QIODevice::ReadOnly)) {
+        QCryptographicHash direct(QCryptographicHash::Sha1);
+        direct.addData(DirectKeyVersion);
+        direct.addData(optionsHash);
+        direct.addData(source.toUtf8());
+        direct.addData("\0", 1);
+        direct.addData(&sourceFile);
+        directKey = direct.result();
+        graph->setSearchPaths(IncludeGraph::searchPathsOf(request.flags, QFileInfo(source).absolutePath()));
+        graph->startPass();
+        dependencies = graph->signature(source);
+        const QByteArray cached = cache.manifest(directKey, dependencies);
+        if (!cached.isEmpty() && useCached(cache, cached, &result)) {
+            result.elapsed = timer.elapsed();
+            return result;
+        }
+    }
+    // 清单对不上时才运行预处理器；刚改过的文件可能在同一个时间戳内再次改动，这时不保存清单
+    auto saveManifest = [&](const QByteArray &key) {
+        if (directKey.isEmpty())
+            return;
+        const qint64 recent = QDateTime::currentMSecsSinceEpoch() - TimestampSlack;
+        for (const QString &file : graph->closure(source)) {
+            if (QFileInfo(file).lastModified().toMSecsSinceEpoch() > recent)
+                return;
+        }
+        cache.setManifest(directKey, dependencies, key);
+    };
+
+    QCryptographicHash key(QCryptographicHash::Sha1);
+    key.addData(CacheKeyVersion);
+    key.addData(identity);
+    for (const QString &flag : request.flags) {
+        key.addData("\0", 1);
+        key.addData(flag.toUtf8());
+    }
+    key.addData("\0", 1);
+    // 预处理输出包含行号标记中的源文件路径，同一内容换个位置会重新编译一次
+    QByteArray errors;
+    int exitCode = -1;
+    QStringList preprocess = QStringList() << QStringLiteral("-E") << request.source;
+    if (!runTool(request.compiler, preprocess + request.flags, cancel, nullptr, &errors, &exitCode, &key)) {
+        result.output = QString::fromLocal8Bit(errors);
+        return result;
+    }
+    if (exitCode != 0) {
+        // 预处理就失败了（头文件找不到等），错误信息已经足够
+        DiagnosticParser parser;
+        parser.feed(errors);
+        parser.finish();
+        result.output = parser.text();
+        result.diagnostics = parser.diagnostics();
+        result.elapsed = timer.elapsed();
+        return result;
+    }
+
+    const QByteArray cacheKey = key.result();
+    if (useCached(cache, cacheKey, &result)) {
+        saveManifest(cacheKey);
+        result.elapsed = timer.elapsed();
+        return result;
+    }
+
+    QString temporary = cache.temporaryPath(cacheKey);
+    QStringList compile;
+    // 预编译头只影响编译速度，不影响结果，因此不参与缓存键
+    QString header = precompiledHeader(request, identity, headerPool, headerCancel);
+    if (!header.isEmpty())
+        compile << QStringLiteral("-include") << header;
+    compile << diagnosticOptions(request.compiler, identity, cancel);
+    compile << request.source << QStringLiteral("-o") << temporary;
+    // 诊断边到达边解析，模板错误输出很长时也不必等编译结束再整块处理
+    DiagnosticParser parser;
+    QByteArray log;
+    bool ran = runTool(request.compiler, compile + request.flags, cancel, nullptr, nullptr, &exitCode, nullptr,
+                       [&parser, &log](const QByteArray &data) {
+        parser.feed(data);
+        log += data;
+    });
+    parser.finish();
+    result.output = parser.text();
+    result.diagnostics = parser.diagnostics();
+    if (!ran) {
+        QFile::remove(temporary);
+        return result;
+    }
+    result.elapsed = timer.elapsed();
+    if (exitCode != 0) {
+        QFile::remove(temporary);
+        return result;
+    }
+    result.binary = cache.insert(cacheKey, temporary);
+    result.ok = !result.binary.isEmpty();
+    if (result.ok) {
+        cache.setLog(cacheKey, log);
+        saveManifest(cacheKey);
+    }
+    if (!result.ok)
+        result.output += tr("无法写入编译缓存 ") + cache.directory() + QLatin1Char('\n');
+    return result;
+}
@@ -0,0 +1,106 @@
+#ifndef BUILDER_H
+#define BUILDER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QVector>
+#include <functional>
+#include "includegraph.h"
+#include "diagnostics.h"
+
+QT_BEGIN_NAMESPACE
+class QCryptographicHash;
+QT_END_NAMESPACE
+
+class CompileCache;
+
+struct BuildRequest {
+    QString source;
+    QString compiler;
+    QStringList flags;
+    bool project;     // 项目模式：构建 source 所在目录下的全部翻译单元
+    QString configuration;   // 运行配置的 id，各配置的编译缓存分开存放
+};
+
+// 项目模式下每个翻译单元的编译情况
+struct UnitTiming {
+    QString file;     // 相对项目目录
+    qint64 elapsed;   // 毫秒，-1 表示目标文件已是最新
+    bool ok;
+};
+
+struct BuildResult {
+    bool ok;
+    bool cacheHit;    // 项目模式下表示没有任何文件需要重新编译或链接
+    QString binary;
+    QString output;   // 编译器输出（错误与警告），JSON 诊断已转为文本
+    qint64 elapsed;   // 毫秒
+    QVector<Diagnostic> diagnostics;
+    QVector<UnitTiming> units;
+    qint64 linkElapsed;   // 毫秒，-1 表示没有重新链接
+};
+
+// 运行前的构建：在后台线程中预处理源文件，以“预处理结果 + 编译器版本 + 编译选项”的哈希为键
+// 查找编译缓存，命中时直接给出缓存中的可执行文件，未命中才真正编译并放入缓存。
+// 预处理结果包含了所有 #include 展开的内容，头文件改动同样会使缓存失效。
+// 预处理之前先走直接模式：按源文件内容、编译器与选项找到上次的清单，源文件引入的项目内头文件
+// （路径、大小、修改时间）都没变时直接沿用清单中的预处理键，不必运行 -E。
+// 源文件开头引入了重量级标准头文件时，在另一个低优先级线程中预编译这些头文件，之后的编译用 -include 引入。
+class Builder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Builder(QObject *parent = nullptr);
+    ~Builder();
+
+    void start(const BuildRequest &request);
+    // 取消当前构建（结束编译器进程），不再发出 finished
+    void cancel();
+    bool isBuilding() const;
+    // 在后台提前建立 request 所需的预编译头（打开、保存文件时调用），不影响正在进行的构建
+    void warmUp(const BuildRequest &request);
+
+    // 运行外部工具直到结束；hash 非空时标准输出直接进入哈希而不保存，
+    // onStandardError 非空时标准错误边到达边交给它（此时不再存入 standardError）。cancel 置位时结束进程并返回 false
+    static bool runTool(const QString &program, const QStringList &arguments, const QAtomicInt *cancel,
+                        QByteArray *standardOutput, QByteArray *standardError, int *exitCode,
+                        QCryptographicHash *hash = nullptr,
+                        const std::function<void(const QByteArray &)> &onStandardError = nullptr);
+    // 编译器支持 -fdiagnostics-format=json（g++ 9 起）时返回该选项，否则为空；结果按编译器缓存
+    static QStringList diagnosticOptions(const QString &compiler, const QByteArray &identity, const QAtomicInt *cancel);
+    // 编译器的版本信息，可执行文件变化后随之变化；无法运行编译器时返回空
+    static QByteArray compilerIdentity(const QString &compiler, const QAtomicInt *cancel);
+    // 编译器可执行文件的规范路径、大小与修改时间，不必运行编译器，可在 GUI 线程中调用
+    static QString compilerStamp(const QString &compiler);
+
+signals:
+    void finished(const BuildResult &result);
+
+private slots:
+    void buildFinished();
+
+private:
+    static BuildResult build(const BuildRequest &request, IncludeGraph *graph, const QAtomicInt *cancel,
+                             QThreadPool *headerPool, const QSharedPointer<QAtomicInt> &headerCancel);
+    // 命中时把缓存条目与保存的编译器输出填入 result
+    static bool useCached(const CompileCache &cache, const QByteArray &key, BuildResult *result);
+    // 取得可用的预编译头，还没有建好时交给 headerPool 在后台建立并返回空串
+    static QString precompiledHeader(const BuildRequest &request, const QByteArray &identity,
+                                     QThreadPool *headerPool, const QSharedPointer<QAtomicInt> &headerCancel);
+
+    QThreadPool pool;         // 单线程，构建依次进行
+    QThreadPool headerPool;   // 单线程，建立预编译头
+    QFutureWatcher<BuildResult> watcher;
+    QSharedPointer<QAtomicInt> cancelFlag;
+    QSharedPointer<QAtomicInt> headerCancel;   // 只在析构时置位
+    IncludeGraph includeGraph;                 // 只在构建线程中使用，跨构建保留
+    bool building;
+};
+
+#endif // BUILDER_H
@@ -16,6 +16,8 @@ CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent)
     connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(highlightCurrentLine()));
     // 当光标位置变化时显示代码补全窗口
     connect(this, SIGNAL(cursorPositionChanged()), this, SLOT(showCompleteWidget()));
+    // 滚动时重新计算可见区域内的查找高亮
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateSearchSelections()));
 
     // 初始化行号区域宽度
     updateLineNumberAreaWidth(0);
@@ -33,14 +35,58 @@ CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent)
     p.setColor(QPalette::Text, Qt::white);
     this->setPalette(p);
 
-    // 初始化代码补全列表（添加C++关键字）
-    setUpCompleteList();
-    // 创建代码补全窗口
-    completeWidget = new CompleteListWidget(this);
-    completeWidget->hide();  // 默认隐藏
-    // 设置补全窗口最大高度（最多显示5行）
-    completeWidget->setMaximumHeight(fontMetrics().height()*5);
+    // 代码补全列表与补全窗口在第一次需要补全时才创建，见 showCompleteWidget()
+    completeWidget = nullptr;
     completeState = CompleteState::Hide;  // 初始状态：隐藏补全窗口
+
+    // 撤销历史随文档由标签页提供，见 showDocument()
+    history = nullptr;
+}
+
+UndoHistory *CodeEditor::undoHistory() const
+{
+    return history;
+}
+
+// 切换到另一个标签页的文档。文档归标签页所有，编辑器不会删除它
+void CodeEditor::showDocument(QTextDocument *document, UndoHistory *history)
+{
+    if (completeWidget)
+        completeWidget->hide();
+    completeState = CompleteState::Hide;
+    searchMatches.clear();
+    searchSelections.clear();
+    bracketSelections.clear();
+    diagnosticMarks.clear();
+    diagnosticSelections.clear();
+    document->setDefaultFont(font());
+    setDocument(document);
+    this->history = history;
+    updateLineNumberAreaWidth(0);
+    highlightCurrentLine();
+}
+
+void CodeEditor::undo()
+{
+    if (history)
+        moveCursorAfterUndo(history->undo());
+}
+
+void CodeEditor::redo()
+{
+    if (history)
+        moveCursorAfterUndo(history->redo());
+}
+
+// 撤销/重做后把光标移动到发生变化的位置
+void CodeEditor::moveCursorAfterUndo(int position)
+{
+    if (position < 0)
+        return;
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(qMin(position, document()->characterCount() - 1));
+    setTextCursor(cursor);
+    ensureCursorVisible();
 }
 
 // 计算行号区域的宽度（根据最大行号的位数动态调整）
@@ -58,12 +104,18 @@ int CodeEditor::lineNumberAreaWidth()
     // 确保至少有3位宽，避免行数较少时行号区域过窄
     if (digits < 3) digits = 3;
 
-    // 计算宽度：3像素边距 + 数字宽度 * 位数
-    int space = 3 + fontMetrics().width(QLatin1Char('9')) * digits;
+    // 计算宽度：诊断标记 + 3像素边距 + 数字宽度 * 位数
+    int space = diagnosticMarkerWidth() + 3 + fontMetrics().width(QLatin1Char('9')) * digits;
 
     return space;
 }
 
+// 行号左侧留给诊断标记的宽度，始终保留，标记出现时行号不会左右跳动
+int CodeEditor::diagnosticMarkerWidth()
+{
+    return fontMetrics().height() / 2 + 4;
+}
+
 // 更新行号区域宽度（槽函数）
 void CodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
 {
@@ -94,12 +146,14 @@ void CodeEditor::resizeEvent(QResizeEvent *e)
     QRect cr = contentsRect();
     // 设置行号区域的几何位置和大小
     lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    updateSearchSelections();
 }
 
 // 高亮当前行
 void CodeEditor::highlightCurrentLine()
 {
-    QList<QTextEdit::ExtraSelection> extraSelections;
+    lineSelections.clear();
+    bracketSelections.clear();
 
     if (!isReadOnly()) {
         QTextEdit::ExtraSelection selection;
@@ -116,11 +170,237 @@ void CodeEditor::highlightCurrentLine()
         selection.cursor.clearSelection();
 
         // 添加到额外选择列表
-        extraSelections.append(selection);
+        lineSelections.append(selection);
     }
 
     // 设置额外选择，实现高亮
-    setExtraSelections(extraSelections);
+    updateExtraSelections();
+}
+
+// 合并各类额外高亮
+void CodeEditor::updateExtraSelections()
+{
+    setExtraSelections(lineSelections + diagnosticSelections + searchSelections + bracketSelections);
+}
+
+void CodeEditor::setSearchMatches(const QVector<FindMatch> &matches)
+{
+    searchMatches = matches;
+    updateSearchSelections();
+}
+
+// 只为可见区域内的匹配创建高亮，匹配再多也不会拖慢绘制
+void CodeEditor::updateSearchSelections()
+{
+    if (searchMatches.isEmpty() && searchSelections.isEmpty())
+        return;
+    searchSelections.clear();
+    if (!searchMatches.isEmpty()) {
+        int first = firstVisibleBlock().position();
+        QTextBlock lastBlock = cursorForPosition(QPoint(viewport()->width(), viewport()->height())).block();
+        int last = lastBlock.position() + lastBlock.length();
+
+        // 匹配互不重叠且按起点排序，终点同样有序
+        auto it = std::lower_bound(searchMatches.constBegin(), searchMatches.constEnd(), first,
+                                   [](const FindMatch &match, int value) { return match.start + match.length <= value; });
+        QTextEdit::ExtraSelection selection;
+        selection.format.setBackground(QColor(255, 200, 0, 100));
+        for (int count = 0; it != searchMatches.constEnd() && it->start < last && count < 2000; ++it, ++count) {
+            selection.cursor = QTextCursor(document());
+            selection.cursor.setPosition(it->start);
+            selection.cursor.setPosition(it->start + it->length, QTextCursor::KeepAnchor);
+            searchSelections.append(selection);
+        }
+    }
+    updateExtraSelections();
+}
+
+namespace {
+
+const int MaxDiagnosticMarks = 1000;
+
+// g++ 的列按 UTF-8 字节计，换算成块内的字符位置
+int positionOfColumn(const QTextBlock &block, int column)
+{
+    const QString text = block.text();
+    int bytes = 0;
+    int i = 0;
+    while (i < text.size() && bytes < column - 1) {
+        const ushort c = text.at(i).unicode();
+        if (text.at(i).isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            bytes += 4;
+            i += 2;
+            continue;
+        }
+        bytes += c < 0x80 ? 1 : (c < 0x800 ? 2 : 3);
+        ++i;
+    }
+    return block.position() + i;
+}
+
+QColor severityColor(Diagnostic::Severity severity)
+{
+    switch (severity) {
+    case Diagnostic::Error:
+        return QColor(240, 70, 70);
+    case Diagnostic::Warning:
+        return QColor(230, 190, 40);
+    default:
+        return QColor(90, 160, 230);
+    }
+}
+
+QString severityTitle(Diagnostic::Severity severity)
+{
+    switch (severity) {
+    case Diagnostic::Error:
+        return QObject::tr("错误");
+    case Diagnostic::Warning:
+        return QObject::tr("警告");
+    default:
+        return QObject::tr("提示");
+    }
+}
+
+} // namespace
+
+// 诊断随编译结果整体替换；行号超出文档的（文件在编译后被改短）直接忽略
+void CodeEditor::setDiagnostics(const QVector<Diagnostic> &diagnostics)
+{
+    if (diagnostics.isEmpty() && diagnosticMarks.isEmpty())
+        return;
+    updateMarkerLines();   // 旧标记所在的行
+    diagnosticMarks.clear();
+    diagnosticSelections.clear();
+    for (const Diagnostic &diagnostic : diagnostics) {
+        if (diagnosticMarks.size() >= MaxDiagnosticMarks)
+            break;
+        QTextBlock block = document()->findBlockByNumber(diagnostic.line - 1);
+        if (diagnostic.line <= 0 || !block.isValid())
+            continue;
+        int end = block.position() + block.length() - 1;
+        int start = block.position();
+        int finish = end;   // 没有列号（如链接错误）时标出整行
+        if (diagnostic.column > 0) {
+            start = positionOfColumn(block, diagnostic.column);
+            finish = diagnostic.endColumn >= diagnostic.column ? positionOfColumn(block, diagnostic.endColumn + 1) : start + 1;
+        }
+        // 只有插入点时标出一个字符，位于行尾时标出前一个字符
+        if (finish > end)
+            finish = end;
+        if (start >= finish)
+            start = qMax(block.position(), finish - 1);
+        DiagnosticMark mark;
+        mark.cursor = QTextCursor(document());
+        mark.cursor.setPosition(start);
+        mark.cursor.setPosition(finish, QTextCursor::KeepAnchor);
+        mark.diagnostic = diagnostic;
+        diagnosticMarks.append(mark);
+
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = mark.cursor;
+        selection.format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+        selection.format.setUnderlineColor(severityColor(diagnostic.severity));
+        diagnosticSelections.append(selection);
+    }
+    updateMarkerLines();   // 新标记所在的行
+    updateExtraSelections();
+}
+
+// 只重绘带标记的行号区域，而不是整个行号区
+void CodeEditor::updateMarkerLines()
+{
+    const QRect area = lineNumberArea->rect();
+    for (const DiagnosticMark &mark : diagnosticMarks) {
+        QRect rect = blockBoundingGeometry(mark.cursor.block()).translated(contentOffset()).toAlignedRect();
+        if (rect.intersects(area))
+            lineNumberArea->update(0, rect.top(), lineNumberArea->width(), rect.height());
+    }
+}
+
+// 按位置顺序在诊断之间循环跳转
+bool CodeEditor::gotoDiagnostic(bool forward, QString *message)
+{
+    if (diagnosticMarks.isEmpty())
+        return false;
+    const int position = textCursor().selectionStart();
+    const DiagnosticMark *target = nullptr;
+    const DiagnosticMark *wrap = nullptr;
+    for (const DiagnosticMark &mark : diagnosticMarks) {
+        const int start = mark.cursor.selectionStart();
+        if (forward) {
+            if (start > position && (!target || start < target->cursor.selectionStart()))
+                target = &mark;
+            if (!wrap || start < wrap->cursor.selectionStart())
+                wrap = &mark;
+        } else {
+            if (start < position && (!target || start > target->cursor.selectionStart()))
+                target = &mark;
+            if (!wrap || start > wrap->cursor.selectionStart())
+                wrap = &mark;
+        }
+    }
+    if (!target)
+        target = wrap;
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(target->cursor.selectionStart());
+    setTextCursor(cursor);
+    centerCursor();
+    if (message)
+        *message = QString(tr("第 %1 行 %2：%3")).arg(cursor.blockNumber() + 1)
+                       .arg(severityTitle(target->diagnostic.severity)).arg(target->diagnostic.message);
+    return true;
+}
+
+QString CodeEditor::diagnosticToolTip(const QVector<const DiagnosticMark *> &marks) const
+{
+    QString html;
+    for (const DiagnosticMark *mark : marks) {
+        const Diagnostic &diagnostic = mark->diagnostic;
+        if (!html.isEmpty())
+            html += QLatin1String("<hr>");
+        html += QString(QLatin1String("<b style=\"color:%1\">%2</b> ")).arg(severityColor(diagnostic.severity).name())
+                    .arg(severityTitle(diagnostic.severity));
+        html += diagnostic.message.toHtmlEscaped();
+        if (!diagnostic.option.isEmpty())
+            html += QLatin1String(" [") + diagnostic.option.toHtmlEscaped() + QLatin1Char(']');
+        for (const QString &note : diagnostic.notes)
+            html += QLatin1String("<br>&nbsp;&nbsp;") + note.toHtmlEscaped();
+        for (const FixIt &fix : diagnostic.fixits) {
+            html += QLatin1String("<br>") + QString(tr("建议：第 %1 行第 %2 列改为 ")).arg(fix.line).arg(fix.column);
+            html += fix.text.isEmpty() ? tr("（删除）") : QLatin1String("<code>") + fix.text.toHtmlEscaped() + QLatin1String("</code>");
+        }
+    }
+    return html;
+}
+
+// 行号区的提示列出该行所有诊断，编辑区的提示只列出鼠标下的诊断
+bool CodeEditor::diagnosticToolTipEvent(QEvent *event, bool inLineNumberArea)
+{
+    if (diagnosticMarks.isEmpty())
+        return false;
+    QHelpEvent *help = static_cast<QHelpEvent *>(event);
+    QTextCursor cursor = cursorForPosition(QPoint(inLineNumberArea ? 0 : help->pos().x(), help->pos().y()));
+    QVector<const DiagnosticMark *> marks;
+    for (const DiagnosticMark &mark : diagnosticMarks) {
+        bool hit = inLineNumberArea ? mark.cursor.block() == cursor.block()
+                                    : cursor.position() >= mark.cursor.selectionStart() && cursor.position() <= mark.cursor.selectionEnd();
+        if (hit)
+            marks.append(&mark);
+    }
+    if (marks.isEmpty()) {
+        QToolTip::hideText();
+        return false;
+    }
+    QToolTip::showText(help->globalPos(), diagnosticToolTip(marks), inLineNumberArea ? lineNumberArea : viewport());
+    return true;
+}
+
+bool CodeEditor::viewportEvent(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip && diagnosticToolTipEvent(event, false))
+        return true;
+    return QPlainTextEdit::viewportEvent(event);
 }
 
 // 绘制行号区域
@@ -138,6 +418,19 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
     int top = (int) blockBoundingGeometry(block).translated(contentOffset()).top();
     int bottom = top + (int) blockBoundingRect(block).height();  // 底部位置
 
+    // 每行只画最严重的一个诊断
+    QHash<int, Diagnostic::Severity> markers;
+    for (const DiagnosticMark &mark : diagnosticMarks) {
+        int line = mark.cursor.blockNumber();
+        auto it = markers.find(line);
+        if (it == markers.end())
+            markers.insert(line, mark.diagnostic.severity);
+        else if (mark.diagnostic.severity < it.value())
+            it.value() = mark.diagnostic.severity;
+    }
+    const int markerWidth = diagnosticMarkerWidth();
+    const int markerSize = fontMetrics().height() / 2;
+
     // 循环绘制所有可见行的行号
     while (block.isValid() && top <= event->rect().bottom()) {
         if (block.isVisible() && bottom >= event->rect().top()) {
@@ -146,8 +439,17 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
             // 设置画笔颜色
             painter.setPen(Qt::lightGray);
             // 绘制行号文本（居中对齐）
-            painter.drawText(0, top, lineNumberArea->width(), fontMetrics().height(),
+            painter.drawText(markerWidth, top, lineNumberArea->width() - markerWidth, fontMetrics().height(),
                              Qt::AlignCenter, number);
+            auto marker = markers.constFind(blockNumber);
+            if (marker != markers.constEnd()) {
+                painter.save();
+                painter.setRenderHint(QPainter::Antialiasing);
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(severityColor(marker.value()));
+                painter.drawEllipse(2, top + (fontMetrics().height() - markerSize) / 2, markerSize, markerSize);
+                painter.restore();
+            }
         }
 
         // 移动到下一个文本块
@@ -161,8 +463,15 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
 // 按键事件处理：实现代码补全、括号匹配等功能
 void CodeEditor::keyPressEvent(QKeyEvent *event)
 {
+    // 撤销/重做交给 UndoHistory
+    if (event->matches(QKeySequence::Undo)) {
+        undo();
+    }
+    else if (event->matches(QKeySequence::Redo)) {
+        redo();
+    }
     // 自动补全括号：Shift + (
-    if (event->modifiers() == Qt::ShiftModifier && event->key() == 40) {
+    else if (event->modifiers() == Qt::ShiftModifier && event->key() == 40) {
         this->insertPlainText(tr("()"));
         this->moveCursor(QTextCursor::PreviousCharacter);  // 将光标移到括号中间
     }
@@ -337,14 +646,25 @@ void CodeEditor::showCompleteWidget()
     if (completeState == CompleteState::Ignore) return;
 
     // 隐藏补全窗口并设置状态为隐藏
-    completeWidget->hide();
+    if (completeWidget) {
+        completeWidget->hide();
+        completeWidget->clear();  // 清空补全列表
+    }
     completeState = CompleteState::Hide;
 
     // 获取光标前的单词
     QString word = this->getWordOfCursor();
-    completeWidget->clear();  // 清空补全列表
 
     if (!word.isEmpty()) {  // 如果有单词需要补全
+        if (!completeWidget) {
+            // 初始化代码补全列表（添加C++关键字）
+            setUpCompleteList();
+            // 创建代码补全窗口
+            completeWidget = new CompleteListWidget(this);
+            completeWidget->hide();  // 默认隐藏
+            // 设置补全窗口最大高度（最多显示5行）
+            completeWidget->setMaximumHeight(fontMetrics().height()*5);
+        }
         int maxSize = 0;  // 记录最长补全项的长度
         QMap<QString, int> distance;  // 存储补全项与当前单词的编辑距离
         vector<QString> itemList;  // 存储匹配的补全项
@@ -464,7 +784,8 @@ void CodeEditor::highlightMatchingParenthesis()
         extraSelections.append(selection);
 
         // 设置额外的选择以显示高亮
-        setExtraSelections(extraSelections);
+        bracketSelections = extraSelections;
+        updateExtraSelections();
     }
 }
 
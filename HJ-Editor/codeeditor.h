@@ -7,6 +7,9 @@
 #include <QListWidget>
 #include <QListWidgetItem>
 #include "completelistwidget.h"
+#include "undohistory.h"
+#include "findengine.h"
+#include "diagnostics.h"
 #include <algorithm>
 #include<QTextCursor>
 QT_BEGIN_NAMESPACE
@@ -32,16 +35,28 @@ public:
     void setUpCompleteList();
     void highlightMatchingParenthesis();
     QTextCursor findMatchingBracket(int,char);
+    UndoHistory *undoHistory() const;
+    void showDocument(QTextDocument *document, UndoHistory *history);
+    void setSearchMatches(const QVector<FindMatch> &matches);  // 高亮可见区域内的查找结果
+    void setDiagnostics(const QVector<Diagnostic> &diagnostics);  // 标出当前文档的编译诊断（波浪线与行号区标记）
+    bool gotoDiagnostic(bool forward, QString *message);   // 光标移到下一个/上一个诊断，没有诊断时返回 false
+    bool diagnosticToolTipEvent(QEvent *event, bool inLineNumberArea);
+
+public slots:
+    void undo();
+    void redo();
 
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
 
 private slots:
     void updateLineNumberAreaWidth(int newBlockCount);//
     void highlightCurrentLine();//
     void updateLineNumberArea(const QRect &, int);//
     void showCompleteWidget();//
+    void updateSearchSelections();
     //void completeWidgetKeyDown();
 
 private:
@@ -54,6 +69,24 @@ private:
     QString getWordOfCursor();
     int completeState;
     int getCompleteWidgetX();
+    UndoHistory *history;
+    void moveCursorAfterUndo(int position);
+    //---------额外高亮（当前行、括号、查找结果）分别维护后合并-------
+    QList<QTextEdit::ExtraSelection> lineSelections;
+    QList<QTextEdit::ExtraSelection> bracketSelections;
+    QList<QTextEdit::ExtraSelection> searchSelections;
+    QVector<FindMatch> searchMatches;
+    void updateExtraSelections();
+    //---------编译诊断：光标随编辑移动，标记始终落在原来的代码上-------
+    struct DiagnosticMark {
+        QTextCursor cursor;
+        Diagnostic diagnostic;
+    };
+    QVector<DiagnosticMark> diagnosticMarks;
+    QList<QTextEdit::ExtraSelection> diagnosticSelections;
+    int diagnosticMarkerWidth();
+    void updateMarkerLines();
+    QString diagnosticToolTip(const QVector<const DiagnosticMark *> &marks) const;
 };
 
 //![codeeditordefinition]
@@ -76,6 +109,12 @@ protected:
 
     }
 
+    bool event(QEvent *event) override {
+        if (event->type() == QEvent::ToolTip && codeEditor->diagnosticToolTipEvent(event, true))
+            return true;
+        return QWidget::event(event);
+    }
+
 private:
     CodeEditor *codeEditor;
 };
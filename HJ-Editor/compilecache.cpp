@@ -0,0 +1,146 @@
+#include "compilecache.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+const QLatin1String TemporaryPrefix("tmp-");
+const QLatin1String LogSuffix(".log");
+const QLatin1String ManifestSuffix(".manifest");
+
+} // namespace
+
+CompileCache::CompileCache(const QString &directory, qint64 budget)
+{
+    dir = directory;
+    this->budget = budget;
+    QDir().mkpath(dir);
+}
+
+QString CompileCache::directory() const
+{
+    return dir;
+}
+
+QString CompileCache::defaultDirectory(const QString &name)
+{
+    QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/build");
+    return name.isEmpty() ? root : root + QLatin1Char('/') + name;
+}
+
+QString CompileCache::path(const QByteArray &key) const
+{
+    return dir + QLatin1Char('/') + QString::fromLatin1(key.toHex());
+}
+
+QString CompileCache::lookup(const QByteArray &key) const
+{
+    QString file = path(key);
+    QFile entry(file);
+    if (!entry.open(QIODevice::ReadOnly))
+        return QString();
+    // 修改时间即最近使用时间，淘汰时据此排序
+    entry.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    return file;
+}
+
+QString CompileCache::temporaryPath(const QByteArray &key) const
+{
+    return dir + QLatin1Char('/') + TemporaryPrefix + QString::fromLatin1(key.toHex())
+           + QLatin1Char('-') + QString::number(QCoreApplication::applicationPid());
+}
+
+QString CompileCache::insert(const QByteArray &key, const QString &file)
+{
+    QString target = path(key);
+    // 另一个进程可能已经放入了同一个键，内容相同，保留哪一个都可以
+    QFile::remove(target);
+    if (!QFile::rename(file, target)) {
+        QFile::remove(file);
+        return QString();
+    }
+    evict();
+    return target;
+}
+
+void CompileCache::setLog(const QByteArray &key, const QByteArray &log)
+{
+    const QString file = path(key) + LogSuffix;
+    if (log.isEmpty()) {
+        QFile::remove(file);
+        return;
+    }
+    QSaveFile out(file);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(log);
+        out.commit();
+    }
+}
+
+QByteArray CompileCache::log(const QByteArray &key) const
+{
+    QFile file(path(key) + LogSuffix);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void CompileCache::setManifest(const QByteArray &directKey, const QByteArray &dependencies, const QByteArray &key)
+{
+    QSaveFile out(path(directKey) + ManifestSuffix);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(key.toHex() + '\n' + dependencies.toHex() + '\n');
+        out.commit();
+    }
+}
+
+QByteArray CompileCache::manifest(const QByteArray &directKey, const QByteArray &dependencies) const
+{
+    QFile file(path(directKey) + ManifestSuffix);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    if (lines.size() < 2 || lines.at(1) != dependencies.toHex())
+        return QByteArray();
+    return QByteArray::fromHex(lines.at(0));
+}
+
+void CompileCache::evict()
+{
+    QDir cacheDir(dir);
+    QFileInfoList entries = cacheDir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);  // 新的在前
+    qint64 total = 0;
+    bool newest = true;   // 最新的条目即使超出预算也保留，它可能马上就要运行
+    for (const QFileInfo &info : entries) {
+        if (info.fileName().startsWith(TemporaryPrefix)) {
+            // 崩溃遗留的临时文件，一小时以上没有动过就清理掉
+            if (info.lastModified().secsTo(QDateTime::currentDateTime()) > 3600)
+                QFile::remove(info.filePath());
+            continue;
+        }
+        if (info.fileName().endsWith(ManifestSuffix)) {
+            // 清单只指向条目，很小，不计入预算；指向的条目已被淘汰时清理
+            QFile file(info.filePath());
+            if (file.open(QIODevice::ReadOnly) && !QFile::exists(dir + QLatin1Char('/') + QString::fromLatin1(file.readLine().trimmed())))
+                QFile::remove(info.filePath());
+            continue;
+        }
+        if (info.fileName().endsWith(LogSuffix)) {
+            // 条目已被淘汰（可能是别的进程）时一并清理
+            if (!QFile::exists(info.filePath().left(info.filePath().size() - LogSuffix.size())))
+                QFile::remove(info.filePath());
+            continue;
+        }
+        total += info.size();
+        if (total > budget && !newest) {
+            QFile::remove(info.filePath());
+            QFile::remove(info.filePath() + LogSuffix);
+        }
+        newest = false;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef COMPILECACHE_H
+#define COMPILECACHE_H
+
+#include <QString>
+#include <QByteArray>
+
+// 编译结果缓存：以内容哈希为键把编译好的文件保存在本地缓存目录，
+// 命中时更新修改时间，总大小超出预算时按修改时间淘汰最久未用的条目（LRU）。
+// 只在构建线程中使用；写入先生成临时文件再 rename，其他进程读到的总是完整文件。
+class CompileCache
+{
+public:
+    explicit CompileCache(const QString &directory, qint64 budget);
+
+    // 缓存中键为 key 的文件，不存在时返回空串
+    QString lookup(const QByteArray &key) const;
+    // 存放新文件的临时路径，编译器直接写到这里，再用 insert 移入缓存
+    QString temporaryPath(const QByteArray &key) const;
+    QString insert(const QByteArray &key, const QString &file);
+    // 编译时的编译器输出与条目一同保存（键加 .log），命中时照样给出警告；log 为空时不保存
+    void setLog(const QByteArray &key, const QByteArray &log);
+    QByteArray log(const QByteArray &key) const;
+    // 直接模式的清单：directKey（源文件内容、编译器与选项）对应的依赖签名与预处理键。
+    // 依赖签名与保存时一致才返回预处理键，否则返回空
+    void setManifest(const QByteArray &directKey, const QByteArray &dependencies, const QByteArray &key);
+    QByteArray manifest(const QByteArray &directKey, const QByteArray &dependencies) const;
+    void evict();
+
+    QString directory() const;
+    // 缓存根目录，name 为子目录（不同构建配置各用一个）
+    static QString defaultDirectory(const QString &name = QString());
+
+private:
+    QString path(const QByteArray &key) const;
+
+    QString dir;
+    qint64 budget;
+};
+
+#endif // COMPILECACHE_H
@@ -1,4 +1,85 @@
 #include "console.h"
+#include <QScrollBar>
+#include <QSettings>
+#include <QMenu>
+#include <QContextMenuEvent>
+#include <QMouseEvent>
+#include <QRegularExpression>
+#include <QCoreApplication>
+#include <climits>
+
+const char Console::BenchmarkOption[]="--console-benchmark";
+
+namespace {
+
+const int FrameInterval = 16;   // 刷新间隔，约一帧
+const QRgb StandardErrorColor = 0xf14c4c;
+const QRgb CompilerColor = 0x9da5b4;
+const QRgb PhaseColor = 0x3b8eea;
+const QRgb TimestampColor = 0x808080;
+
+int countLines(const QVector<OutputSpan> &spans)
+{
+  int lines=0;
+  for(const OutputSpan &span:spans)lines+=span.text.count(QLatin1Char('\n'));
+  return lines;
+}
+
+bool endsWithNewline(const QVector<OutputSpan> &spans)
+{
+  return !spans.isEmpty()&&spans.last().text.endsWith(QLatin1Char('\n'));
+}
+
+void appendSpan(QVector<OutputSpan> *spans,const OutputSpan &span)
+{
+  if(span.text.isEmpty())return;
+  if(!spans->isEmpty()&&spans->last().format==span.format)spans->last().text+=span.text;
+  else spans->append(span);
+}
+
+// 只保留最后 maxLines 行
+void trimToLines(QVector<OutputSpan> *spans,int maxLines)
+{
+  int newlines=0;
+  for(int s=spans->size()-1;s>=0;--s){
+      const QString &text=spans->at(s).text;
+      int i=text.size()-1;
+      for(;i>=0;--i){
+          if(text.at(i)==QLatin1Char('\n')&&++newlines>maxLines)break;
+        }
+      if(i>=0){
+          (*spans)[s].text.remove(0,i+1);
+          spans->remove(0,s);
+          return;
+        }
+    }
+}
+
+// 在第一个换行处（含）把 spans 分为两部分
+void splitAfterFirstNewline(const QVector<OutputSpan> &spans,QVector<OutputSpan> *head,QVector<OutputSpan> *tail)
+{
+  bool found=false;
+  for(const OutputSpan &span:spans){
+      if(found){
+          tail->append(span);
+          continue;
+        }
+      int newline=span.text.indexOf(QLatin1Char('\n'));
+      if(newline<0){
+          head->append(span);
+          continue;
+        }
+      found=true;
+      OutputSpan first=span;
+      first.text=span.text.left(newline+1);
+      head->append(first);
+      OutputSpan rest=span;
+      rest.text=span.text.mid(newline+1);
+      if(!rest.text.isEmpty())tail->append(rest);
+    }
+}
+
+}
 
 Console::Console(QWidget* parent):QPlainTextEdit(parent)
 {
@@ -12,10 +93,26 @@ Console::Console(QWidget* parent):QPlainTextEdit(parent)
   p.setColor(QPalette::Inactive, QPalette::Base, editorColor);
   p.setColor(QPalette::Text,Qt::white);
   this->setPalette(p);
+
+  // 输出区不需要撤销，大量输出时撤销栈会占用大量内存
+  setUndoRedoEnabled(false);
+  QSettings settings;
+  maxLines=settings.value(QStringLiteral("console/maxLines"),10000).toInt();
+  if(maxLines<=0)maxLines=INT_MAX;
+  setMaximumBlockCount(maxLines==INT_MAX?0:maxLines);
+  timestamps=settings.value(QStringLiteral("console/showTimestamps"),false).toBool();
+  for(bool &shown:visible)shown=true;
+  historyLines=0;
+  atLineStart=true;
+  received=0;
+  flushTimer.setSingleShot(true);
+  flushTimer.setInterval(FrameInterval);
+  connect(&flushTimer,&QTimer::timeout,this,&Console::flushOutput);
 }
 void Console::keyPressEvent(QKeyEvent *event){
   if(event->key()==Qt::Key_Backspace&&this->textCursor().atBlockStart())return;
   if(event->key()==Qt::Key_Return){
+      flushOutput();
       QString data=(this->textCursor()).block().text()+tr("\n");
       qDebug()<<"sending data:  "<<data;
       parentWindow->inputData(data);
@@ -27,3 +124,252 @@ void Console::resetCursorPosition(){
   cursor.movePosition(QTextCursor::End,QTextCursor::MoveAnchor);
   this->setTextCursor(cursor);
 }
+
+void Console::appendOutput(Channel channel,const QString &text,qint64 bytes)
+{
+  OutputSpan span;
+  span.text=text;
+  appendOutput(channel,QVector<OutputSpan>()<<span,bytes<0?text.size():bytes);
+}
+
+void Console::appendOutput(Channel channel,const QVector<OutputSpan> &spans,qint64 bytes)
+{
+  if(!runTimer.isValid())runTimer.start();
+  if(channel==StandardOutput||channel==StandardError){
+      if(!outputTimer.isValid())outputTimer.start();
+      received+=bytes;
+    }
+  Chunk chunk;
+  chunk.channel=channel;
+  chunk.time=runTimer.elapsed();
+  for(const OutputSpan &span:spans)appendSpan(&chunk.spans,span);
+  if(chunk.spans.isEmpty())return;
+  chunk.lines=qMax(1,countLines(chunk.spans));
+  pending.append(chunk);
+  record(chunk);
+  if(!flushTimer.isActive())flushTimer.start();
+}
+
+void Console::beginPhase(const QString &title)
+{
+  QString line=tr("── ")+title+tr(" ──\n");
+  // 上一段输出没有换行时先换行，分隔行总是独占一行
+  if(!history.isEmpty()&&!endsWithNewline(history.last().spans))line.prepend(QLatin1Char('\n'));
+  appendOutput(PhaseMarker,line,0);
+}
+
+// 记入历史：同一来源未结束的行接到上一条记录后面，每条记录都从行首开始，时间戳才准确
+void Console::record(const Chunk &chunk)
+{
+  Chunk rest=chunk;
+  if(!history.isEmpty()&&history.last().channel==chunk.channel&&!endsWithNewline(history.last().spans)){
+      QVector<OutputSpan> head;
+      rest.spans.clear();
+      splitAfterFirstNewline(chunk.spans,&head,&rest.spans);
+      Chunk &last=history.last();
+      for(const OutputSpan &span:head)appendSpan(&last.spans,span);
+      historyLines-=last.lines;
+      last.lines=qMax(1,countLines(last.spans));
+      historyLines+=last.lines;
+    }
+  if(!rest.spans.isEmpty()){
+      trimToLines(&rest.spans,maxLines);
+      rest.lines=qMax(1,countLines(rest.spans));
+      history.append(rest);
+      historyLines+=rest.lines;
+    }
+  while(history.size()>1&&historyLines-history.first().lines>=maxLines){
+      historyLines-=history.first().lines;
+      history.removeFirst();
+    }
+}
+
+void Console::flushOutput()
+{
+  flushTimer.stop();
+  if(pending.isEmpty())return;
+  // 一帧内来不及显示的部分只保留最后 maxLines 行，开头的行插入后也会马上被丢弃
+  int lines=0;
+  for(int i=pending.size()-1;i>=0;--i){
+      lines+=countLines(pending.at(i).spans);
+      if(lines>maxLines){
+          trimToLines(&pending[i].spans,maxLines-(lines-countLines(pending.at(i).spans)));
+          pending.erase(pending.begin(),pending.begin()+i);
+          break;
+        }
+    }
+  render(pending);
+  pending.clear();
+}
+
+void Console::render(const QList<Chunk> &chunks)
+{
+  QScrollBar *bar=verticalScrollBar();
+  bool atBottom=bar->value()==bar->maximum();
+  QTextCharFormat stampFormat;
+  stampFormat.setForeground(QColor(TimestampColor));
+  QTextCursor cursor(document());
+  cursor.movePosition(QTextCursor::End);
+  cursor.beginEditBlock();
+  for(const Chunk &chunk:chunks){
+      if(!visible[chunk.channel])continue;
+      const QString stamp=QString(tr("[%1] ")).arg(chunk.time/1000.0,8,'f',3);
+      for(const OutputSpan &span:chunk.spans){
+          QTextCharFormat format=channelFormat(chunk.channel,span.format);
+          if(!timestamps){
+              cursor.insertText(span.text,format);
+              atLineStart=span.text.endsWith(QLatin1Char('\n'));
+              continue;
+            }
+          // 每个行首插入这段输出到达的时间
+          int from=0;
+          while(from<span.text.size()){
+              if(atLineStart)cursor.insertText(stamp,stampFormat);
+              int newline=span.text.indexOf(QLatin1Char('\n'),from);
+              int to=newline<0?span.text.size():newline+1;
+              cursor.insertText(span.text.mid(from,to-from),format);
+              atLineStart=newline>=0;
+              from=to;
+            }
+        }
+    }
+  cursor.endEditBlock();
+  if(atBottom)bar->setValue(bar->maximum());
+}
+
+void Console::rerender()
+{
+  flushTimer.stop();
+  pending.clear();
+  clear();
+  atLineStart=true;
+  render(history);
+}
+
+QTextCharFormat Console::channelFormat(Channel channel,const QTextCharFormat &format) const
+{
+  QTextCharFormat result=format;
+  // 程序自己指定了颜色（ANSI 转义）时不覆盖
+  if(channel==StandardError&&!format.hasProperty(QTextFormat::ForegroundBrush))
+    result.setForeground(QColor(StandardErrorColor));
+  else if(channel==CompilerOutput&&!format.hasProperty(QTextFormat::ForegroundBrush))
+    result.setForeground(QColor(CompilerColor));
+  else if(channel==PhaseMarker){
+      result.setForeground(QColor(PhaseColor));
+      result.setFontWeight(QFont::Bold);
+    }
+  return result;
+}
+
+bool Console::isChannelVisible(Channel channel) const
+{
+  return visible[channel];
+}
+
+void Console::setChannelVisible(Channel channel,bool shown)
+{
+  if(visible[channel]==shown)return;
+  visible[channel]=shown;
+  rerender();
+}
+
+void Console::setTimestampsVisible(bool shown)
+{
+  if(timestamps==shown)return;
+  timestamps=shown;
+  QSettings().setValue(QStringLiteral("console/showTimestamps"),shown);
+  rerender();
+}
+
+void Console::contextMenuEvent(QContextMenuEvent *event)
+{
+  QMenu *menu=createStandardContextMenu();
+  menu->addSeparator();
+  const Channel channels[]={StandardOutput,StandardError,CompilerOutput};
+  const QString labels[]={tr("显示标准输出"),tr("显示标准错误"),tr("显示编译输出")};
+  for(int i=0;i<3;++i){
+      QAction *action=menu->addAction(labels[i]);
+      action->setCheckable(true);
+      action->setChecked(visible[channels[i]]);
+      Channel channel=channels[i];
+      connect(action,&QAction::toggled,this,[this,channel](bool checked){setChannelVisible(channel,checked);});
+    }
+  QAction *stampAction=menu->addAction(tr("显示时间戳"));
+  stampAction->setCheckable(true);
+  stampAction->setChecked(timestamps);
+  connect(stampAction,&QAction::toggled,this,&Console::setTimestampsVisible);
+  menu->exec(event->globalPos());
+  delete menu;
+}
+
+// 双击编译输出中的 file:line:col: 跳到源代码的对应位置，其余行照常选词
+void Console::mouseDoubleClickEvent(QMouseEvent *event)
+{
+  static const QRegularExpression location(QStringLiteral("^(?:\\[\\s*[\\d.]+\\] )?(.+?):(\\d+)(?::(\\d+))?:"));
+  QRegularExpressionMatch match=location.match(cursorForPosition(event->pos()).block().text());
+  if(match.hasMatch()&&parentWindow->openDiagnosticLocation(match.captured(1),match.captured(2).toInt(),match.captured(3).toInt())){
+      event->accept();
+      return;
+    }
+  QPlainTextEdit::mouseDoubleClickEvent(event);
+}
+
+void Console::reset()
+{
+  flushTimer.stop();
+  pending.clear();
+  history.clear();
+  historyLines=0;
+  atLineStart=true;
+  received=0;
+  runTimer.invalidate();
+  outputTimer.invalidate();
+  clear();
+}
+
+qint64 Console::receivedBytes() const
+{
+  return received;
+}
+
+double Console::throughput() const
+{
+  if(!outputTimer.isValid()||outputTimer.elapsed()==0)return 0;
+  return received/1048576.0/(outputTimer.elapsed()/1000.0);
+}
+
+// 模拟程序的大量输出：按一次管道读取的大小分块，与实际运行一样经 OutputDecoder 解码后送入 appendOutput，
+// 块之间处理事件，刷新定时器照常触发；全部显示完才停止计时。没有显示器时可设 QT_QPA_PLATFORM=offscreen
+int Console::runBenchmark(int megabytes)
+{
+  const int ChunkSize=64*1024;
+  QByteArray chunk;
+  for(int line=0;chunk.size()<ChunkSize;++line){
+      // 每 16 行带一段 ANSI 颜色，覆盖解码器的转义序列处理
+      if(line%16==0)chunk+="\x1b[32mok\x1b[0m ";
+      chunk+=QByteArray("line ")+QByteArray::number(line)+" 0123456789 abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ\n";
+    }
+  chunk.truncate(ChunkSize);
+
+  Console console;
+  console.parentWindow=nullptr;
+  console.resize(800,600);
+  console.show();
+  OutputDecoder decoder;
+  const qint64 total=qint64(qMax(1,megabytes))<<20;
+  QElapsedTimer timer;
+  timer.start();
+  for(qint64 sent=0;sent<total;sent+=chunk.size()){
+      console.appendOutput(StandardOutput,decoder.decode(chunk),chunk.size());
+      QCoreApplication::processEvents();
+    }
+  console.flushOutput();
+  QCoreApplication::processEvents();
+  const qint64 elapsed=qMax<qint64>(1,timer.elapsed());
+
+  qInfo().noquote()<<QString(tr("输出区吞吐量：%1 MB，用时 %2 ms，%3 MB/s（throughput() 报告 %4 MB/s），保留 %5 行"))
+                     .arg(console.receivedBytes()/1048576.0,0,'f',1).arg(elapsed)
+                     .arg(console.receivedBytes()/1048576.0/(elapsed/1000.0),0,'f',1)
+                     .arg(console.throughput(),0,'f',1).arg(console.blockCount());
+  return 0;
+}
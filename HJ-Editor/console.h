@@ -6,17 +6,73 @@
 #include <QPlainTextEdit>
 #include <QDebug>
 #include <QTextBlock>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
 #include "mainwindow.h"
+#include "outputdecoder.h"
+
+// 输出区：程序输出只追加到末尾。收到的数据先攒在 pending 中，每帧（16 ms）最多刷新一次，
+// 一次插入、一次排版；保留的行数有上限（maximumBlockCount），超出时从开头丢弃，
+// 相当于一个按行计的环形缓冲区，输出再多也不会拖慢编辑器。
+// 标准输出、标准错误与编译输出分别标记来源与到达时间，按到达顺序合并显示；
+// 右键菜单可以按来源过滤、显示时间戳，切换时用保留的记录重新显示。
 class Console : public QPlainTextEdit
 {
   Q_OBJECT
 public:
+  enum Channel {
+    StandardOutput,
+    StandardError,
+    CompilerOutput,
+    PhaseMarker      // “编译”“运行”等阶段分隔行
+  };
+
   Console(QWidget* parent=0);
   MainWindow *parentWindow;
+  // bytes 为这段文本解码前的字节数，用于统计程序输出的吞吐量；-1 表示按字符数计
+  void appendOutput(Channel channel,const QString &text,qint64 bytes=-1);
+  void appendOutput(Channel channel,const QVector<OutputSpan> &spans,qint64 bytes);
+  void beginPhase(const QString &title);
+  void flushOutput();                  // 立即显示攒下的输出（程序结束时调用）
+  void reset();                        // 清空内容与统计，开始新的一次运行
+  qint64 receivedBytes() const;        // 本次运行程序输出的字节数
+  double throughput() const;           // 本次运行从收到第一段程序输出起的平均吞吐量（MB/s）
+  bool isChannelVisible(Channel channel) const;
+  void setChannelVisible(Channel channel,bool shown);
+  void setTimestampsVisible(bool shown);
+  // --console-benchmark [MB]：不创建主窗口，把 MB 兆字节的模拟输出送进输出区并报告吞吐量
+  static const char BenchmarkOption[];
+  static int runBenchmark(int megabytes);
 protected:
   void keyPressEvent(QKeyEvent *event)override;
+  void contextMenuEvent(QContextMenuEvent *event)override;
+  void mouseDoubleClickEvent(QMouseEvent *event)override;
 protected slots:
   void resetCursorPosition();
+private:
+  struct Chunk {
+    Channel channel;
+    qint64 time;                 // 相对本次运行开始的毫秒数
+    QVector<OutputSpan> spans;   // 相邻同格式的段已合并
+    int lines;                   // 换行数，至少按一行计
+  };
+  void record(const Chunk &chunk);
+  void render(const QList<Chunk> &chunks);
+  void rerender();
+  QTextCharFormat channelFormat(Channel channel,const QTextCharFormat &format) const;
+
+  QList<Chunk> pending;   // 尚未显示
+  QList<Chunk> history;   // 已收到的全部输出（同样限制行数），过滤条件变化时重新显示
+  int historyLines;
+  bool atLineStart;       // 显示内容是否停在行首（决定是否插入时间戳）
+  QTimer flushTimer;
+  QElapsedTimer runTimer;
+  QElapsedTimer outputTimer;
+  qint64 received;
+  int maxLines;           // 0 或负数的设置表示不限，此时为 INT_MAX
+  bool visible[4];
+  bool timestamps;
 };
 
 #endif // CONSOLE_H
@@ -0,0 +1,258 @@
+#include "diagnostics.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+namespace {
+
+Diagnostic::Severity severityOf(const QString &kind)
+{
+    if (kind.startsWith(QLatin1String("warning")))
+        return Diagnostic::Warning;
+    if (kind == QLatin1String("note"))
+        return Diagnostic::Note;
+    return Diagnostic::Error;   // error、fatal error、sorry 等
+}
+
+void readLocation(const QJsonObject &location, QString *file, int *line, int *column)
+{
+    *file = location.value(QStringLiteral("file")).toString();
+    *line = location.value(QStringLiteral("line")).toInt();
+    // g++ 11 起另给出 byte-column，column 可能按显示宽度计（制表符展开），优先用字节列
+    const QJsonValue byteColumn = location.value(QStringLiteral("byte-column"));
+    *column = byteColumn.isUndefined() ? location.value(QStringLiteral("column")).toInt() : byteColumn.toInt();
+}
+
+Diagnostic fromJson(const QJsonObject &object)
+{
+    Diagnostic diagnostic;
+    diagnostic.line = 0;
+    diagnostic.column = 0;
+    diagnostic.endColumn = 0;
+    diagnostic.severity = severityOf(object.value(QStringLiteral("kind")).toString());
+    diagnostic.message = object.value(QStringLiteral("message")).toString();
+    diagnostic.option = object.value(QStringLiteral("option")).toString();
+    const QJsonArray locations = object.value(QStringLiteral("locations")).toArray();
+    if (!locations.isEmpty()) {
+        const QJsonObject location = locations.at(0).toObject();
+        readLocation(location.value(QStringLiteral("caret")).toObject(), &diagnostic.file, &diagnostic.line, &diagnostic.column);
+        const QJsonObject finish = location.value(QStringLiteral("finish")).toObject();
+        if (finish.value(QStringLiteral("line")).toInt() == diagnostic.line)
+            diagnostic.endColumn = finish.value(QStringLiteral("column")).toInt();
+    }
+    for (const QJsonValue &value : object.value(QStringLiteral("fixits")).toArray()) {
+        const QJsonObject fixit = value.toObject();
+        FixIt fix;
+        QString file;
+        readLocation(fixit.value(QStringLiteral("start")).toObject(), &file, &fix.line, &fix.column);
+        readLocation(fixit.value(QStringLiteral("next")).toObject(), &file, &fix.endLine, &fix.endColumn);
+        fix.text = fixit.value(QStringLiteral("string")).toString();
+        diagnostic.fixits.append(fix);
+    }
+    return diagnostic;
+}
+
+} // namespace
+
+DiagnosticParser::DiagnosticParser()
+{
+    mode = Unknown;
+    scanned = 0;
+    depth = 0;
+    elementStart = -1;
+    inString = false;
+    escaped = false;
+}
+
+QVector<Diagnostic> DiagnosticParser::diagnostics() const
+{
+    return results;
+}
+
+QString DiagnosticParser::text() const
+{
+    return rendered;
+}
+
+QString DiagnosticParser::severityName(Diagnostic::Severity severity)
+{
+    // 与 g++ 的文本输出一致，输出区按同一格式识别位置
+    switch (severity) {
+    case Diagnostic::Error:
+        return QStringLiteral("error");
+    case Diagnostic::Warning:
+        return QStringLiteral("warning");
+    case Diagnostic::Note:
+        return QStringLiteral("note");
+    }
+    return QString();
+}
+
+QString DiagnosticParser::format(const Diagnostic &diagnostic)
+{
+    QString location = diagnostic.file;
+    if (diagnostic.line > 0)
+        location += QLatin1Char(':') + QString::number(diagnostic.line);
+    if (diagnostic.column > 0)
+        location += QLatin1Char(':') + QString::number(diagnostic.column);
+    QString line = location + QLatin1String(": ") + severityName(diagnostic.severity) + QLatin1String(": ") + diagnostic.message;
+    if (!diagnostic.option.isEmpty())
+        line += QLatin1String(" [") + diagnostic.option + QLatin1Char(']');
+    return line;
+}
+
+void DiagnosticParser::feed(const QByteArray &data)
+{
+    if (mode == Json) {
+        feedJson(data);
+        return;
+    }
+    if (mode == Text) {
+        feedText(data);
+        return;
+    }
+    // 根据第一个非空白字符决定格式
+    buffer += data;
+    int i = 0;
+    while (i < buffer.size() && QChar::isSpace(uchar(buffer.at(i))))
+        ++i;
+    if (i == buffer.size())
+        return;
+    QByteArray pending = buffer;
+    buffer.clear();
+    if (pending.at(i) == '[') {
+        mode = Json;
+        scanned = 0;
+        depth = 0;
+        elementStart = -1;
+        inString = false;
+        escaped = false;
+        feedJson(pending);
+    } else {
+        mode = Text;
+        feedText(pending);
+    }
+}
+
+void DiagnosticParser::feedJson(const QByteArray &data)
+{
+    buffer += data;
+    for (int i = scanned; i < buffer.size(); ++i) {
+        const char c = buffer.at(i);
+        if (inString) {
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == '"')
+                inString = false;
+            continue;
+        }
+        if (c == '"') {
+            inString = true;
+        } else if (c == '[' || c == '{') {
+            if (depth == 1 && c == '{')
+                elementStart = i;
+            ++depth;
+        } else if (c == ']' || c == '}') {
+            --depth;
+            if (depth == 1 && c == '}' && elementStart >= 0) {
+                // 顶层数组中的一个诊断完整了
+                QJsonDocument document = QJsonDocument::fromJson(buffer.mid(elementStart, i - elementStart + 1));
+                if (document.isObject())
+                    addJsonDiagnostic(document.object());
+                elementStart = -1;
+            } else if (depth <= 0) {
+                // 数组结束，之后的内容（链接器输出等）重新判断格式
+                QByteArray rest = buffer.mid(i + 1);
+                buffer.clear();
+                scanned = 0;
+                mode = Unknown;
+                feed(rest);
+                return;
+            }
+        }
+    }
+    // 已解析的部分不再保留
+    if (elementStart < 0) {
+        buffer.clear();
+        scanned = 0;
+    } else {
+        buffer.remove(0, elementStart);
+        elementStart = 0;
+        scanned = buffer.size();
+    }
+}
+
+void DiagnosticParser::addJsonDiagnostic(const QJsonObject &object)
+{
+    Diagnostic diagnostic = fromJson(object);
+    QStringList childLines;
+    for (const QJsonValue &value : object.value(QStringLiteral("children")).toArray()) {
+        Diagnostic child = fromJson(value.toObject());
+        childLines.append(format(child));
+    }
+    diagnostic.notes = childLines;
+    results.append(diagnostic);
+    rendered += format(diagnostic) + QLatin1Char('\n');
+    for (const QString &line : childLines)
+        rendered += line + QLatin1Char('\n');
+}
+
+void DiagnosticParser::feedText(const QByteArray &data)
+{
+    buffer += data;
+    int start = 0;
+    for (;;) {
+        int newline = buffer.indexOf('\n', start);
+        if (newline < 0)
+            break;
+        parseLine(QString::fromLocal8Bit(buffer.constData() + start, newline - start));
+        start = newline + 1;
+    }
+    buffer.remove(0, start);
+}
+
+void DiagnosticParser::parseLine(const QString &line)
+{
+    static const QRegularExpression pattern(QStringLiteral("^(.+?):(\\d+):(?:(\\d+):)? (fatal error|error|warning|note): (.*)$"));
+    static const QRegularExpression optionPattern(QStringLiteral(" \\[(-W[^\\]]+)\\]$"));
+    rendered += line + QLatin1Char('\n');
+    QRegularExpressionMatch match = pattern.match(line);
+    if (!match.hasMatch())
+        return;
+    Diagnostic diagnostic;
+    diagnostic.file = match.captured(1);
+    diagnostic.line = match.captured(2).toInt();
+    diagnostic.column = match.captured(3).toInt();
+    diagnostic.endColumn = 0;
+    diagnostic.severity = severityOf(match.captured(4));
+    diagnostic.message = match.captured(5);
+    QRegularExpressionMatch option = optionPattern.match(diagnostic.message);
+    if (option.hasMatch()) {
+        diagnostic.option = option.captured(1);
+        diagnostic.message.truncate(option.capturedStart());
+    }
+    // note 附在前一条诊断上
+    if (diagnostic.severity == Diagnostic::Note && !results.isEmpty()) {
+        results.last().notes.append(line);
+        return;
+    }
+    results.append(diagnostic);
+}
+
+void DiagnosticParser::finish()
+{
+    if (buffer.trimmed().isEmpty() && mode != Json) {
+        buffer.clear();
+        return;
+    }
+    if (mode == Json) {
+        // 不完整的 JSON：原样显示
+        rendered += QString::fromLocal8Bit(buffer);
+    } else {
+        parseLine(QString::fromLocal8Bit(buffer));
+    }
+    buffer.clear();
+}
@@ -0,0 +1,80 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QJsonObject;
+QT_END_NAMESPACE
+
+// 编译器给出的修改建议：把 [列, 结束列) 替换为 text（行、列均从 1 开始，列按字节计）
+struct FixIt {
+    int line;
+    int column;
+    int endLine;
+    int endColumn;
+    QString text;
+};
+
+// 一条编译诊断。行、列从 1 开始，列按 UTF-8 字节计（与 g++ 一致），0 表示未知
+struct Diagnostic {
+    enum Severity {
+        Error,
+        Warning,
+        Note
+    };
+    QString file;
+    int line;
+    int column;
+    int endColumn;      // 同一行内的结束列（含），0 表示只有插入点
+    Severity severity;
+    QString message;
+    QString option;     // 触发警告的选项，如 -Wunused-variable
+    QVector<FixIt> fixits;
+    QStringList notes;  // 附带的 note，显示在提示中
+};
+
+// 增量解析编译器的标准错误输出，数据分块到达时边收边解析。
+// 输出以 [ 开头时按 -fdiagnostics-format=json 解析：逐个切出顶层数组中的对象，每个对象完整后立即解析；
+// 否则按文本格式（file:line:col: error: message）逐行解析。JSON 数组结束后的内容（链接器的错误等）按文本处理。
+// 同时生成给人看的文本，JSON 诊断转成与文本格式相同的样子。
+class DiagnosticParser
+{
+public:
+    DiagnosticParser();
+
+    void feed(const QByteArray &data);
+    // 数据结束：解析剩下的不完整行
+    void finish();
+    QVector<Diagnostic> diagnostics() const;
+    QString text() const;
+
+    static QString severityName(Diagnostic::Severity severity);
+    static QString format(const Diagnostic &diagnostic);
+
+private:
+    void feedJson(const QByteArray &data);
+    void feedText(const QByteArray &data);
+    void parseLine(const QString &line);
+    void addJsonDiagnostic(const QJsonObject &object);
+
+    enum Mode {
+        Unknown,
+        Json,
+        Text
+    };
+    Mode mode;
+    QByteArray buffer;
+    int scanned;        // JSON：buffer 中已扫描的长度
+    int depth;
+    int elementStart;
+    bool inString;
+    bool escaped;
+    QVector<Diagnostic> results;
+    QString rendered;
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,306 @@
+#include "editjournal.h"
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QUuid>
+#include <QThread>
+#include <QCoreApplication>
+#include <QStandardPaths>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 JournalMagic = 0x484A4A4C;  // "HJJL"
+const quint32 JournalVersion = 1;
+const int FlushInterval = 1000;           // 增量攒批写盘的间隔（毫秒）
+const qint64 MinCompactBytes = 1 << 20;   // 日志超过该大小且超过文档两倍大小时压缩
+
+enum RecordType {
+    DeltaRecord = 1,
+    CheckpointRecord = 2
+};
+
+QString journalDirectory()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String("/journal");
+    QDir().mkpath(dir);
+    return dir;
+}
+
+// 所有日志共用一个低优先级写线程
+QThread *journalThread()
+{
+    static QThread *thread = nullptr;
+    if (!thread) {
+        thread = new QThread;
+        thread->setObjectName(QLatin1String("EditJournal"));
+        thread->start(QThread::LowPriority);
+        // 退出请求投递到写线程自己的事件队列，排在之前已投递的写入/删除之后，
+        // 保证 closeEvent 中的 discard 等请求在线程停止前都被执行
+        QObject *context = new QObject;
+        context->moveToThread(thread);
+        QObject::connect(qApp, &QCoreApplication::aboutToQuit, [context] {
+            QMetaObject::invokeMethod(context, [context] {
+                delete context;
+                QThread::currentThread()->quit();
+            }, Qt::QueuedConnection);
+            thread->wait();
+        });
+    }
+    return thread;
+}
+
+} // namespace
+
+EditJournal::EditJournal(QTextDocument *document, QObject *parent)
+    : QObject(parent),
+      document(document),
+      path(journalDirectory() + QLatin1Char('/') + QUuid::createUuid().toString().mid(1, 36) + QLatin1String(".journal")),
+      lock(path + QLatin1String(".lock"))
+{
+    // 只按进程是否存活判断锁是否失效，避免长时间运行的实例被误判
+    lock.setStaleLockTime(0);
+    lock.tryLock(0);
+
+    writer = new JournalWriter(path);
+    writer->moveToThread(journalThread());
+    connectWriter(Qt::AutoConnection);
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FlushInterval);
+    connect(&flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+    connect(document, &QTextDocument::contentsChange, this, &EditJournal::contentsChanged);
+
+    baseSize = 0;
+    baseModified = 0;
+    headerWritten = false;
+    bytesSinceCheckpoint = 0;
+    length = document->characterCount() - 1;
+    lastRevision = document->revision();
+}
+
+EditJournal::~EditJournal()
+{
+    if (writer->thread()->isFinished()) {
+        // 程序退出时写线程已经停止，剩余的增量直接在当前线程同步写入
+        disconnect(this, nullptr, writer, nullptr);
+        connectWriter(Qt::DirectConnection);
+        flush();
+        delete writer;
+        return;
+    }
+    flush();
+    writer->deleteLater();
+}
+
+void EditJournal::connectWriter(Qt::ConnectionType type)
+{
+    connect(this, &EditJournal::appendRequested, writer, &JournalWriter::append, type);
+    connect(this, &EditJournal::rewriteRequested, writer, &JournalWriter::rewrite, type);
+    connect(this, &EditJournal::removeRequested, writer, &JournalWriter::remove, type);
+}
+
+void EditJournal::reset(const QString &basePath)
+{
+    discard();
+    this->basePath = basePath;
+    QFileInfo info(basePath);
+    baseSize = basePath.isEmpty() ? 0 : info.size();
+    baseModified = basePath.isEmpty() ? 0 : info.lastModified().toMSecsSinceEpoch();
+}
+
+void EditJournal::checkpoint()
+{
+    flushTimer.stop();
+    buffer.clear();
+    QByteArray data = header();
+    QDataStream out(&data, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << quint8(CheckpointRecord) << document->toPlainText();
+    emit rewriteRequested(data);
+    headerWritten = true;
+    bytesSinceCheckpoint = 0;
+}
+
+void EditJournal::discard()
+{
+    flushTimer.stop();
+    buffer.clear();
+    headerWritten = false;
+    bytesSinceCheckpoint = 0;
+    length = document->characterCount() - 1;
+    lastRevision = document->revision();
+    emit removeRequested();
+}
+
+QByteArray EditJournal::header() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << JournalMagic << JournalVersion << basePath << baseSize << baseModified;
+    return data;
+}
+
+void EditJournal::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    int revision = document->revision();
+    if (charsRemoved == charsAdded && revision == lastRevision)
+        return;  // 只有格式变化（如语法高亮），文本没有改变
+    lastRevision = revision;
+
+    // 整篇替换时 contentsChange 会把末尾的段落分隔符也计算在内，这里按实际长度修正
+    int newLength = document->characterCount() - 1;
+    int removed = qMax(0, qMin(charsRemoved, length - position));
+    int added = qMax(0, qMin(charsAdded, newLength - position));
+    length = newLength;
+
+    QString text;
+    if (added > 0) {
+        QTextCursor cursor(document);
+        cursor.setPosition(position);
+        cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+        text = cursor.selectedText();
+        text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    }
+
+    QDataStream out(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << quint8(DeltaRecord) << qint32(position) << qint32(removed) << text;
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void EditJournal::flush()
+{
+    if (buffer.isEmpty())
+        return;
+    QByteArray data = buffer;
+    if (!headerWritten) {
+        data.prepend(header());
+        headerWritten = true;
+    }
+    buffer.clear();
+    bytesSinceCheckpoint += data.size();
+    emit appendRequested(data);
+
+    // 增量累计超过文档大小的两倍时压缩成检查点，全文写入的开销被编辑量摊平
+    if (bytesSinceCheckpoint > qMax(MinCompactBytes, qint64(length) * 4))
+        checkpoint();
+}
+
+QStringList EditJournal::pendingJournals()
+{
+    QStringList result;
+    QDir dir(journalDirectory());
+    foreach (const QString &name, dir.entryList(QStringList() << QLatin1String("*.journal"), QDir::Files, QDir::Time)) {
+        QString journal = dir.filePath(name);
+        QLockFile probe(journal + QLatin1String(".lock"));
+        probe.setStaleLockTime(0);
+        if (probe.tryLock(0)) {
+            result << journal;
+            probe.unlock();
+        }
+    }
+    return result;
+}
+
+bool EditJournal::replay(const QString &journal, QString *basePath, QString *text)
+{
+    QFile in(journal);
+    if (!in.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&in);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic, version;
+    qint64 baseSize, baseModified;
+    stream >> magic >> version >> *basePath >> baseSize >> baseModified;
+    if (stream.status() != QDataStream::Ok || magic != JournalMagic || version != JournalVersion)
+        return false;
+
+    // 基准文件在日志开始后被外部修改过，则只能从检查点开始重放
+    bool baseValid = true;
+    text->clear();
+    if (!basePath->isEmpty()) {
+        QFileInfo info(*basePath);
+        QFile base(*basePath);
+        baseValid = info.exists() && info.size() == baseSize
+                && info.lastModified().toMSecsSinceEpoch() == baseModified
+                && base.open(QIODevice::ReadOnly | QIODevice::Text);
+        if (baseValid)
+            *text = QString::fromLocal8Bit(base.readAll());
+    }
+
+    int records = 0;
+    while (!stream.atEnd()) {
+        quint8 type;
+        stream >> type;
+        if (type == DeltaRecord) {
+            qint32 position, removed;
+            QString added;
+            stream >> position >> removed >> added;
+            // 崩溃时最后一条记录可能只写了一半
+            if (stream.status() != QDataStream::Ok || !baseValid)
+                break;
+            position = qBound(0, int(position), text->size());
+            text->replace(position, removed, added);
+        } else if (type == CheckpointRecord) {
+            QString snapshot;
+            stream >> snapshot;
+            if (stream.status() != QDataStream::Ok)
+                break;
+            *text = snapshot;
+            baseValid = true;
+        } else {
+            break;
+        }
+        ++records;
+    }
+    return baseValid && records > 0;
+}
+
+void EditJournal::remove(const QString &journal)
+{
+    QFile::remove(journal);
+}
+
+JournalWriter::JournalWriter(const QString &path) : path(path)
+{
+}
+
+void JournalWriter::append(const QByteArray &data)
+{
+    if (!file.isOpen()) {
+        file.setFileName(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+            return;
+    }
+    file.write(data);
+    file.flush();
+#ifdef Q_OS_UNIX
+    ::fsync(file.handle());
+#endif
+}
+
+void JournalWriter::rewrite(const QByteArray &data)
+{
+    file.close();
+    QSaveFile out(path);
+    if (out.open(QIODevice::WriteOnly)) {
+        out.write(data);
+        out.commit();
+    }
+}
+
+void JournalWriter::remove()
+{
+    file.close();
+    QFile::remove(path);
+}
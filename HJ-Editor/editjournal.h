@@ -0,0 +1,90 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QTimer>
+#include <QFile>
+#include <QLockFile>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+class JournalWriter;
+
+// 编辑日志：把文档的 contentsChange 增量追加写入日志文件，用于自动保存与崩溃恢复。
+// 增量先在内存中攒批，再交给后台线程写盘；积累到一定量后压缩成一个全文检查点。
+// 日志开销与编辑量成正比，与文档大小无关（只有压缩时才写全文）。
+class EditJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditJournal(QTextDocument *document, QObject *parent = nullptr);
+    ~EditJournal();
+
+    // 以磁盘上的 basePath 为基准重新开始记录（未命名文件传空字符串，基准为空文档）
+    void reset(const QString &basePath);
+    // 立即把当前全文写成检查点（恢复内容、保存期间又有编辑时使用）
+    void checkpoint();
+    // 丢弃日志（文件已保存或用户放弃修改时）
+    void discard();
+
+    // 崩溃恢复：列出没有被运行中的实例持有的日志
+    static QStringList pendingJournals();
+    // 重放日志得到恢复后的文本；basePath 为日志对应的文件（未命名文件为空）
+    static bool replay(const QString &journal, QString *basePath, QString *text);
+    static void remove(const QString &journal);
+
+signals:
+    void appendRequested(const QByteArray &data);
+    void rewriteRequested(const QByteArray &data);
+    void removeRequested();
+
+private slots:
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+    void flush();
+
+private:
+    QByteArray header() const;
+    void connectWriter(Qt::ConnectionType type);
+
+    QTextDocument *document;
+    JournalWriter *writer;
+    QString path;
+    QLockFile lock;
+    QTimer flushTimer;
+
+    QString basePath;
+    qint64 baseSize;
+    qint64 baseModified;
+
+    QByteArray buffer;        // 尚未交给写线程的增量
+    bool headerWritten;
+    qint64 bytesSinceCheckpoint;
+    int length;               // 上一次变化后的文档长度，用于修正 contentsChange 的计数
+    int lastRevision;
+};
+
+// 运行在后台线程中的写入器，按投递顺序执行追加/重写/删除
+class JournalWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JournalWriter(const QString &path);
+
+public slots:
+    void append(const QByteArray &data);
+    void rewrite(const QByteArray &data);
+    void remove();
+
+private:
+    QString path;
+    QFile file;
+};
+
+#endif // EDITJOURNAL_H
@@ -0,0 +1,181 @@
+#include "editortab.h"
+#include "undohistory.h"
+#include "editjournal.h"
+#include "tokencache.h"
+#include <QTextDocument>
+#include <QPlainTextDocumentLayout>
+#include <QTemporaryFile>
+#include <QCryptographicHash>
+#include <QSettings>
+
+EditorTab::EditorTab(QObject *parent) : QObject(parent)
+{
+    fileName = tr("Untitled.cpp");
+    filePath = tr("~/Desktop/Untitled.cpp");
+    filePathKnown = false;
+    cursorPosition = 0;
+    scrollPosition = 0;
+    doc = nullptr;
+    highlighter = nullptr;
+    editJournal = nullptr;
+    historyPersisted = false;
+    hibernatedHistory = nullptr;
+    lang = Cpp;
+    saved = true;
+    lastRevision = 0;
+
+    // 撤销历史的内存预算，超出部分压缩后溢出到磁盘
+    history = new UndoHistory(nullptr, this);
+    history->setMemoryBudget(QSettings().value(QStringLiteral("undo/memoryBudgetMB"), 32).toLongLong() << 20);
+    materialize(QString());
+}
+
+EditorTab::~EditorTab()
+{
+    history->setDocument(nullptr);
+}
+
+bool EditorTab::isSaved() const
+{
+    return saved;
+}
+
+void EditorTab::setSaved(bool saved)
+{
+    if (saved == this->saved)
+        return;
+    this->saved = saved;
+    emit saveStateChanged();
+}
+
+LanguageType EditorTab::language() const
+{
+    return lang;
+}
+
+void EditorTab::setLanguage(LanguageType lang)
+{
+    this->lang = lang;
+    if (highlighter)
+        highlighter->setLanguage(lang);
+}
+
+QTextDocument *EditorTab::document()
+{
+    if (!doc) {
+        materialize(QString::fromUtf8(qUncompress(compressedText)));
+        compressedText.clear();
+        // 接着休眠前的撤销历史
+        if (hibernatedHistory) {
+            if (hibernatedHistory->seek(0))
+                history->load(hibernatedHistory, QByteArray());
+            delete hibernatedHistory;   // 同时删除临时文件
+            hibernatedHistory = nullptr;
+        } else if (historyPersisted) {
+            history->load(filePath, contentHash);
+        }
+        historyPersisted = false;
+    }
+    return doc;
+}
+
+UndoHistory *EditorTab::undoHistory() const
+{
+    return history;
+}
+
+Highlighter *EditorTab::syntaxHighlighter() const
+{
+    return highlighter;
+}
+
+EditJournal *EditorTab::journal()
+{
+    document();
+    return editJournal;
+}
+
+bool EditorTab::isHibernated() const
+{
+    return !doc;
+}
+
+bool EditorTab::hibernate()
+{
+    if (!doc || !saved)
+        return false;
+    saveHighlighting();
+    compressedText = qCompress(doc->toPlainText().toUtf8());
+    // 不能按文件持久化（设置关闭或与磁盘内容不一致）时，历史暂存到临时文件
+    historyPersisted = persistHistory();
+    if (!historyPersisted) {
+        hibernatedHistory = new QTemporaryFile(this);
+        if (!hibernatedHistory->open() || !history->save(hibernatedHistory, QByteArray())) {
+            delete hibernatedHistory;
+            hibernatedHistory = nullptr;
+        }
+    }
+    history->setDocument(nullptr);
+    editJournal->discard();
+    delete editJournal;
+    editJournal = nullptr;
+    delete doc;  // 高亮器是文档的子对象，一并释放
+    doc = nullptr;
+    highlighter = nullptr;
+    return true;
+}
+
+// 先照缓存着色（contentHash 须已是这段文本的哈希），词法分析在后台补上
+void EditorTab::loadText(const QString &text)
+{
+    document();
+    highlighter->deferLexing(TokenCache::load(contentHash, lang));
+    history->setEnabled(false);
+    doc->setPlainText(text);
+    history->setEnabled(true);
+}
+
+void EditorTab::materialize(const QString &text)
+{
+    doc = new QTextDocument(this);
+    doc->setDocumentLayout(new QPlainTextDocumentLayout(doc));
+    // 先放入文本，再挂上撤销历史、日志与高亮器，重建时不产生任何增量
+    doc->setPlainText(text);
+    history->setDocument(doc);
+    highlighter = new Highlighter(doc, lang);
+    if (!text.isEmpty())
+        highlighter->deferLexing(saved ? TokenCache::load(contentHash, lang) : QVector<BlockTokens>());
+    editJournal = new EditJournal(doc, this);
+    editJournal->reset(filePathKnown ? filePath : QString());
+    lastRevision = doc->revision();
+    connect(doc, &QTextDocument::contentsChange, this, &EditorTab::contentsChanged);
+}
+
+void EditorTab::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(position);
+    int revision = doc->revision();
+    if (charsRemoved == charsAdded && revision == lastRevision)
+        return;  // 只有格式变化（如语法高亮），文本没有改变
+    lastRevision = revision;
+    setSaved(false);
+}
+
+bool EditorTab::persistHistory()
+{
+    if (!doc || !saved || !filePathKnown || contentHash.isEmpty())
+        return false;
+    if (!QSettings().value(QStringLiteral("undo/persist"), true).toBool())
+        return false;
+    // 历史按磁盘内容的哈希保存，重新打开时直接套用；文档与磁盘只要有一点不同
+    // （例如退出时选择了不保存），套用后撤销就会改坏文本，所以按保存时的编码重新核对
+    const QByteArray hash = QCryptographicHash::hash(doc->toPlainText().toLocal8Bit(), QCryptographicHash::Sha1);
+    return hash == contentHash && history->save(filePath, contentHash);
+}
+
+void EditorTab::saveHighlighting()
+{
+    if (!doc || !saved || !filePathKnown || highlighter->isLexingDeferred())
+        return;
+    TokenCache::save(contentHash, lang, doc);
+}
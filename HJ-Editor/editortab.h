@@ -0,0 +1,80 @@
+#ifndef EDITORTAB_H
+#define EDITORTAB_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include "highlighter.h"
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+class QTemporaryFile;
+QT_END_NAMESPACE
+
+class UndoHistory;
+class EditJournal;
+
+// 工作区中的一个标签页：文件信息与文档状态。
+// 所有标签页共用一个编辑器控件，切换时只更换文档；后台已保存的标签页可以休眠，
+// 丢掉 QTextDocument（排版与高亮数据）只保留压缩后的文本，再次激活时重建。
+class EditorTab : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EditorTab(QObject *parent = nullptr);
+    ~EditorTab();
+
+    //---------记录文件信息----------
+    QString fileName;
+    QString filePath;
+    bool filePathKnown;      // filePath 是否已由用户选定（打开或另存为过）
+    QByteArray contentHash;  // 磁盘上文件内容的 SHA-1（与已保存时的文档一致）
+    //---------视图状态（切换标签页时保存）---
+    int cursorPosition;
+    int scrollPosition;
+    //-----------------------------
+
+    bool isSaved() const;
+    void setSaved(bool saved);
+    LanguageType language() const;
+    void setLanguage(LanguageType lang);
+
+    // 休眠中的标签页在这里重建文档
+    QTextDocument *document();
+    UndoHistory *undoHistory() const;
+    // 休眠中的标签页返回 nullptr
+    Highlighter *syntaxHighlighter() const;
+    EditJournal *journal();
+    bool isHibernated() const;
+    // 只有已保存的标签页可以休眠（未保存的需要文档继续写编辑日志），返回是否已休眠
+    bool hibernate();
+    void loadText(const QString &text);  // 整篇载入文本，不进入撤销历史
+    // 已保存且高亮完成时按内容哈希缓存高亮结果，下次打开同样的内容时直接着色
+    void saveHighlighting();
+    // 按文件持久化撤销历史（受 undo/persist 设置控制），只在文档与磁盘内容一致时保存；
+    // 关闭、退出与休眠共用，返回是否已保存
+    bool persistHistory();
+
+signals:
+    void saveStateChanged();
+
+private slots:
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+
+private:
+    void materialize(const QString &text);
+
+    QTextDocument *doc;
+    Highlighter *highlighter;
+    UndoHistory *history;
+    EditJournal *editJournal;
+    QByteArray compressedText;  // 休眠时的文本（UTF-8，qCompress）
+    bool historyPersisted;      // 休眠时撤销历史已按文件保存
+    QTemporaryFile *hibernatedHistory;  // 否则暂存在这里，重建时读回并删除
+    LanguageType lang;
+    bool saved;
+    int lastRevision;
+};
+
+#endif // EDITORTAB_H
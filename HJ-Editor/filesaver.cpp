@@ -0,0 +1,103 @@
+#include "filesaver.h"
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+FileSaver::FileSaver(QObject *parent) : QObject(parent)
+{
+    running = false;
+    connect(&watcher, &QFutureWatcher<Result>::finished, this, &FileSaver::writeFinished);
+}
+
+FileSaver::~FileSaver()
+{
+    // 退出前把排队的快照写完，避免丢失最后一次保存
+    waitForFinished();
+}
+
+void FileSaver::save(const QString &path, const QString &text, int revision)
+{
+    Job job = {path, text, revision};
+    if (running) {
+        // 正在写入：同一文件只保留最新的一次请求，其他文件排在后面
+        if (!pending.contains(path))
+            pendingOrder.append(path);
+        pending.insert(path, job);
+        return;
+    }
+    start(job);
+}
+
+bool FileSaver::isBusy() const
+{
+    return running;
+}
+
+void FileSaver::waitForFinished()
+{
+    while (running) {
+        watcher.waitForFinished();
+        writeFinished();
+    }
+}
+
+void FileSaver::start(const Job &job)
+{
+    current = job;
+    running = true;
+    // setFuture 会丢弃上一个 future 尚未投递的 finished 通知
+    watcher.setFuture(QtConcurrent::run(&FileSaver::write, job));
+}
+
+void FileSaver::writeFinished()
+{
+    // waitForFinished 已经同步处理过这次结果
+    if (!running)
+        return;
+    running = false;
+    Result result = watcher.result();
+    Job done = current;
+    if (!pendingOrder.isEmpty())
+        start(pending.take(pendingOrder.takeFirst()));
+    if (result.ok)
+        emit saved(done.path, done.revision, result.contentHash);
+    else
+        emit failed(done.path, result.errorString);
+}
+
+// 工作线程：编码并原子写入（QSaveFile 先写临时文件，commit 时 rename）
+FileSaver::Result FileSaver::write(const Job &job)
+{
+    Result result;
+    result.ok = false;
+
+    QSaveFile out(job.path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        result.errorString = out.errorString();
+        return result;
+    }
+    const QByteArray data = job.text.toLocal8Bit();
+    if (out.write(data) != data.size() || !out.flush()) {
+        result.errorString = out.errorString();
+        out.cancelWriting();
+        return result;
+    }
+#ifdef Q_OS_UNIX
+    // rename 之前确保数据已经落盘
+    if (::fsync(out.handle()) != 0) {
+        result.errorString = QObject::tr("fsync 失败");
+        out.cancelWriting();
+        return result;
+    }
+#endif
+    if (!out.commit()) {
+        result.errorString = out.errorString();
+        return result;
+    }
+    result.ok = true;
+    result.contentHash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    return result;
+}
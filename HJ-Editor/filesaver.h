@@ -0,0 +1,58 @@
+#ifndef FILESAVER_H
+#define FILESAVER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QFutureWatcher>
+
+// 后台保存：在工作线程中编码文本，写入临时文件后 fsync 并 rename 覆盖原文件，
+// 写入中途崩溃不会截断原文件。同一文件的连续多次保存会被合并，只写入最新的快照；
+// 不同文件的请求按提交顺序依次写入，每个文件最终都会收到 saved 或 failed。
+class FileSaver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileSaver(QObject *parent = nullptr);
+    ~FileSaver();
+
+    // 提交保存请求；revision 为快照对应的文档版本号，保存完成后原样带回，
+    // 同时带回写入内容的 SHA-1，用于按内容匹配撤销历史等缓存
+    void save(const QString &path, const QString &text, int revision);
+    bool isBusy() const;
+    // 阻塞直到所有排队的保存完成（运行程序、退出前需要文件已落盘时使用）
+    void waitForFinished();
+
+signals:
+    void saved(const QString &path, int revision, const QByteArray &contentHash);
+    void failed(const QString &path, const QString &errorString);
+
+private slots:
+    void writeFinished();
+
+private:
+    struct Job {
+        QString path;
+        QString text;
+        int revision;
+    };
+    struct Result {
+        bool ok;
+        QString errorString;
+        QByteArray contentHash;
+    };
+
+    static Result write(const Job &job);
+    void start(const Job &job);
+
+    QFutureWatcher<Result> watcher;
+    Job current;
+    QHash<QString, Job> pending;   // 按路径排队，同一路径只保留最新的快照
+    QStringList pendingOrder;
+    bool running;
+};
+
+#endif // FILESAVER_H
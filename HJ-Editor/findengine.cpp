@@ -0,0 +1,481 @@
+#include "findengine.h"
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const int BatchSize = 4096;       // 每批回传的匹配数
+const qint64 BatchInterval = 16;  // 或者每隔这么多毫秒回传一次
+const int LocalRescanLimit = 1 << 20;  // 改动涉及的行超过这么多字符时改为后台重新查找
+
+inline bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+inline bool atWordBoundary(const QChar *data, int length, int start, int matchLength)
+{
+    if (start > 0 && isWordChar(data[start - 1]))
+        return false;
+    int end = start + matchLength;
+    return end >= length || !isWordChar(data[end]);
+}
+
+// 校验候选位置；忽略大小写时 needle 已做大小写折叠
+inline bool verify(const QChar *text, const QChar *needle, int n, bool caseSensitive)
+{
+    if (caseSensitive)
+        return memcmp(text, needle, n * sizeof(QChar)) == 0;
+    for (int k = 0; k < n; ++k) {
+        if (text[k].toCaseFolded() != needle[k])
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+FindEngine::FindEngine(QObject *parent) : QObject(parent)
+{
+    currentQuery = FindQuery{QString(), false, false, false};
+    generation = 0;
+    searching = false;
+    active = false;
+    complete = false;
+    document = nullptr;
+    documentLength = 0;
+    lastRevision = 0;
+    snapshotStale = true;
+    rescanTimer.setSingleShot(true);
+    rescanTimer.setInterval(150);
+    connect(&rescanTimer, &QTimer::timeout, this, &FindEngine::rescan);
+}
+
+FindEngine::~FindEngine()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+QRegularExpression FindEngine::compile(const FindQuery &query)
+{
+    if (!query.regex)
+        return QRegularExpression();
+    QString pattern = query.wholeWords ? QStringLiteral("\\b(?:%1)\\b").arg(query.text) : query.text;
+    QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+    if (!query.caseSensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    QRegularExpression re(pattern, options);
+    re.optimize();  // 立即编译并启用 JIT，避免首次匹配时才编译
+    return re;
+}
+
+void FindEngine::scan(const QString &text, const FindQuery &query, const QRegularExpression &re, const MatchCallback &onMatch)
+{
+    if (query.text.isEmpty())
+        return;
+    if (!query.regex) {
+        scanLiteral(text, query, onMatch);
+        return;
+    }
+    QRegularExpressionMatchIterator it = re.globalMatch(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        if (match.capturedLength() == 0)
+            continue;
+        if (!onMatch(match.capturedStart(), match.capturedLength()))
+            return;
+    }
+}
+
+void FindEngine::scanLiteral(const QString &text, const FindQuery &query, const MatchCallback &onMatch)
+{
+    const QString needle = query.caseSensitive ? query.text : query.text.toCaseFolded();
+    const int n = needle.size();
+    const int length = text.size();
+    if (n == 0 || n > length)
+        return;
+    const QChar *data = text.constData();
+    const QChar *pattern = needle.constData();
+
+    // 首尾字符的候选形式：忽略大小写时同时比较小写和大写
+    ushort first0 = pattern[0].unicode(), first1 = first0;
+    ushort last0 = pattern[n - 1].unicode(), last1 = last0;
+    bool filterable = true;
+    if (!query.caseSensitive) {
+        first0 = pattern[0].toLower().unicode();
+        first1 = pattern[0].toUpper().unicode();
+        last0 = pattern[n - 1].toLower().unicode();
+        last1 = pattern[n - 1].toUpper().unicode();
+        // 非 ASCII 字符的大小写折叠不止两种形式，逐字比较
+        filterable = pattern[0].unicode() < 0x80 && pattern[n - 1].unicode() < 0x80;
+    }
+
+    int next = 0;  // 匹配互不重叠
+    auto candidate = [&](int position) -> bool {
+        if (position < next || !verify(data + position, pattern, n, query.caseSensitive))
+            return true;
+        if (query.wholeWords && !atWordBoundary(data, length, position, n))
+            return true;
+        next = position + n;
+        return onMatch(position, n);
+    };
+
+    int i = 0;
+#ifdef __SSE2__
+    if (filterable) {
+        // 一次比较 8 个 UTF-16 字符：首字符位置与尾字符位置同时命中才校验
+        const ushort *units = reinterpret_cast<const ushort *>(data);
+        const __m128i f0 = _mm_set1_epi16(short(first0));
+        const __m128i f1 = _mm_set1_epi16(short(first1));
+        const __m128i l0 = _mm_set1_epi16(short(last0));
+        const __m128i l1 = _mm_set1_epi16(short(last1));
+        for (; i + n + 7 <= length; i += 8) {
+            __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(units + i));
+            __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(units + i + n - 1));
+            __m128i hit = _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi16(head, f0), _mm_cmpeq_epi16(head, f1)),
+                                        _mm_or_si128(_mm_cmpeq_epi16(tail, l0), _mm_cmpeq_epi16(tail, l1)));
+            quint32 mask = quint32(_mm_movemask_epi8(hit));
+            while (mask) {
+                int bit = qCountTrailingZeroBits(mask);
+                if (!candidate(i + bit / 2))
+                    return;
+                mask &= ~(3u << bit);  // 每个字符占两位
+            }
+        }
+    }
+#endif
+    for (; i + n <= length; ++i) {
+        if (filterable) {
+            ushort head = data[i].unicode();
+            ushort tail = data[i + n - 1].unicode();
+            if ((head != first0 && head != first1) || (tail != last0 && tail != last1))
+                continue;
+        }
+        if (!candidate(i))
+            return;
+    }
+}
+
+// 只校验上一次的匹配位置。前提见 canRefine：旧查询自身不会重叠，
+// 因此旧结果就是旧文本的全部出现位置，新查询的每个出现位置都在其中
+void FindEngine::refine(const QString &text, const FindQuery &query, const QVector<FindMatch> &previous, const MatchCallback &onMatch)
+{
+    const QString needle = query.caseSensitive ? query.text : query.text.toCaseFolded();
+    const int n = needle.size();
+    const int length = text.size();
+    int next = 0;
+    for (const FindMatch &match : previous) {
+        if (match.start < next || match.start + n > length)
+            continue;
+        if (!verify(text.constData() + match.start, needle.constData(), n, query.caseSensitive))
+            continue;
+        next = match.start + n;
+        if (!onMatch(match.start, n))
+            return;
+    }
+}
+
+bool FindEngine::canRefine(const FindQuery &previous, const FindQuery &query)
+{
+    if (previous.regex || query.regex || previous.wholeWords || query.wholeWords
+            || previous.caseSensitive != query.caseSensitive || query.text.size() <= previous.text.size())
+        return false;
+    const QString oldNeedle = previous.caseSensitive ? previous.text : previous.text.toCaseFolded();
+    const QString newNeedle = query.caseSensitive ? query.text : query.text.toCaseFolded();
+    if (!newNeedle.startsWith(oldNeedle))
+        return false;
+    // 旧查询的真前缀等于真后缀时，互不重叠的旧结果会漏掉一些出现位置
+    QVector<int> border(oldNeedle.size(), 0);
+    for (int i = 1, k = 0; i < oldNeedle.size(); ++i) {
+        while (k > 0 && oldNeedle.at(i) != oldNeedle.at(k))
+            k = border.at(k - 1);
+        if (oldNeedle.at(i) == oldNeedle.at(k))
+            ++k;
+        border[i] = k;
+    }
+    return border.isEmpty() || border.last() == 0;
+}
+
+// 匹配可能跨行时不能只扫描改动的行
+bool FindEngine::mayCrossLines(const FindQuery &query)
+{
+    if (!query.regex)
+        return false;
+    static const char *const tokens[] = {"\\n", "\\s", "\\W", "\\D", "\\H", "\\V", "\\v", "\\R",
+                                         "\\x", "\\0", "\\c", "\\p", "\\P", "\\N", "[^", "(?s"};
+    for (const char *token : tokens) {
+        if (query.text.contains(QLatin1String(token)))
+            return true;
+    }
+    return false;
+}
+
+QVector<FindReplacement> FindEngine::replaceAll(const QString &text, const FindQuery &query, const QRegularExpression &re,
+                                                const QString &replacement)
+{
+    QVector<FindReplacement> result;
+    if (query.regex && !query.text.isEmpty()) {
+        QRegularExpressionMatchIterator it = re.globalMatch(text);
+        while (it.hasNext()) {
+            QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() > 0)
+                result.append(FindReplacement{match.capturedStart(), match.capturedLength(), expandReplacement(match, replacement)});
+        }
+    } else {
+        scan(text, query, re, [&](int start, int length) {
+            result.append(FindReplacement{start, length, replacement});
+            return true;
+        });
+    }
+    return result;
+}
+
+QString FindEngine::expandReplacement(const QRegularExpressionMatch &match, const QString &replacement)
+{
+    if (!replacement.contains(QLatin1Char('\\')))
+        return replacement;
+    QString result;
+    for (int i = 0; i < replacement.size(); ++i) {
+        QChar c = replacement.at(i);
+        if (c == QLatin1Char('\\') && i + 1 < replacement.size()) {
+            QChar next = replacement.at(i + 1);
+            if (next.isDigit()) {
+                result += match.captured(next.digitValue());
+                ++i;
+                continue;
+            }
+            if (next == QLatin1Char('\\')) {
+                result += next;
+                ++i;
+                continue;
+            }
+        }
+        result += c;
+    }
+    return result;
+}
+
+void FindEngine::setDocument(QTextDocument *document)
+{
+    if (this->document)
+        disconnect(this->document, nullptr, this, nullptr);
+    clear();
+    this->document = document;
+    snapshot.clear();
+    snapshotStale = true;
+    if (document) {
+        documentLength = document->characterCount() - 1;
+        lastRevision = document->revision();
+        connect(document, &QTextDocument::contentsChange, this, &FindEngine::contentsChanged);
+    }
+}
+
+// 文档内容变化时才重新复制；QString 隐式共享，交给查找线程不会复制
+QString FindEngine::documentSnapshot()
+{
+    if (snapshotStale) {
+        snapshot = document ? document->toPlainText() : QString();
+        snapshotStale = false;
+    }
+    return snapshot;
+}
+
+void FindEngine::search(const FindQuery &query)
+{
+    // 上一次查找已完整且与文档一致时，延长的查询只需校验旧的匹配
+    QVector<FindMatch> previous;
+    const bool refining = active && complete && !searching && canRefine(currentQuery, query);
+    if (refining)
+        previous = results;
+
+    cancel();
+    rescanTimer.stop();
+    currentQuery = query;
+    results.clear();
+    active = true;
+    complete = false;
+    quint64 gen = ++generation;
+
+    QRegularExpression re = compile(query);
+    currentRe = re;
+    if (query.regex && !re.isValid()) {
+        searching = false;
+        emit invalidQuery(re.errorString());
+        emit finished(0);
+        return;
+    }
+    searching = true;
+    QSharedPointer<QAtomicInt> stop(new QAtomicInt(0));
+    cancelFlag = stop;
+    const QString text = documentSnapshot();
+
+    QtConcurrent::run(&pool, [this, text, query, re, previous, refining, gen, stop]() {
+        QVector<FindMatch> batch;
+        QElapsedTimer timer;
+        timer.start();
+        auto collect = [&](int start, int length) {
+            if (stop->loadAcquire())
+                return false;
+            batch.append({start, length});
+            if (batch.size() >= BatchSize || timer.elapsed() >= BatchInterval) {
+                QVector<FindMatch> ready;
+                ready.swap(batch);
+                QMetaObject::invokeMethod(this, [this, gen, ready] { deliver(gen, ready, false); }, Qt::QueuedConnection);
+                timer.restart();
+            }
+            return true;
+        };
+        if (refining)
+            refine(text, query, previous, collect);
+        else
+            scan(text, query, re, collect);
+        if (!stop->loadAcquire())
+            QMetaObject::invokeMethod(this, [this, gen, batch] { deliver(gen, batch, true); }, Qt::QueuedConnection);
+    });
+}
+
+void FindEngine::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    int revision = document->revision();
+    if (charsRemoved == charsAdded && revision == lastRevision)
+        return;  // 只有格式变化（如语法高亮）
+    lastRevision = revision;
+    snapshotStale = true;
+
+    // 整篇替换时 contentsChange 的计数包含末尾的段落分隔符，按实际长度修正
+    int newLength = document->characterCount() - 1;
+    int removed = qMax(0, qMin(charsRemoved, documentLength - position));
+    int added = qMax(0, qMin(charsAdded, newLength - position));
+    documentLength = newLength;
+    if (!active || (currentQuery.regex && !currentRe.isValid()))
+        return;
+
+    if (complete && !mayCrossLines(currentQuery)) {
+        QTextBlock first = document->findBlock(position);
+        QTextBlock last = document->findBlock(position + added);
+        if (last.position() + last.length() - first.position() <= LocalRescanLimit) {
+            updateLines(position, removed, added);
+            return;
+        }
+    }
+    // 后台查找尚未结束、匹配可能跨行或改动太大：丢弃旧结果，稍后重新查找
+    cancel();
+    complete = false;
+    results.clear();
+    emit matchesChanged();
+    rescanTimer.start();
+}
+
+// 只重新扫描改动所在的整行，其后的匹配平移
+void FindEngine::updateLines(int position, int removed, int added)
+{
+    QTextBlock first = document->findBlock(position);
+    QTextBlock last = document->findBlock(position + added);
+    const int regionStart = first.position();
+    const int regionEnd = last.position() + last.length() - 1;  // 不含段落分隔符
+    const int delta = added - removed;
+    const int oldRegionEnd = regionEnd - delta;
+
+    // 匹配按起点排序且互不重叠，终点同样有序
+    auto lo = std::lower_bound(results.constBegin(), results.constEnd(), regionStart,
+                               [](const FindMatch &match, int value) { return match.start + match.length <= value; });
+    auto hi = std::lower_bound(lo, results.constEnd(), oldRegionEnd,
+                               [](const FindMatch &match, int value) { return match.start < value; });
+    const int from = int(lo - results.constBegin());
+    const int to = int(hi - results.constBegin());
+
+    QTextCursor cursor(document);
+    cursor.setPosition(regionStart);
+    cursor.setPosition(regionEnd, QTextCursor::KeepAnchor);
+    QString lines = cursor.selectedText();
+    lines.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+    QVector<FindMatch> updated;
+    updated.reserve(results.size() - (to - from) + 16);
+    updated += results.mid(0, from);
+    scan(lines, currentQuery, currentRe, [&](int start, int length) {
+        updated.append({regionStart + start, length});
+        return true;
+    });
+    for (int i = to; i < results.size(); ++i)
+        updated.append({results.at(i).start + delta, results.at(i).length});
+    results.swap(updated);
+    emit matchesChanged();
+}
+
+void FindEngine::rescan()
+{
+    if (active && document)
+        search(currentQuery);
+}
+
+void FindEngine::deliver(quint64 generation, const QVector<FindMatch> &batch, bool done)
+{
+    // 已被新的查找取代
+    if (generation != this->generation)
+        return;
+    if (!batch.isEmpty()) {
+        results += batch;
+        emit matchesFound();
+    }
+    if (done) {
+        searching = false;
+        complete = true;
+        emit finished(results.size());
+    }
+}
+
+void FindEngine::cancel()
+{
+    if (cancelFlag)
+        cancelFlag->storeRelease(1);
+    cancelFlag.clear();
+    ++generation;
+    searching = false;
+}
+
+void FindEngine::clear()
+{
+    cancel();
+    rescanTimer.stop();
+    results.clear();
+    active = false;
+    complete = false;
+}
+
+FindQuery FindEngine::query() const
+{
+    return currentQuery;
+}
+
+bool FindEngine::isSearching() const
+{
+    return searching;
+}
+
+bool FindEngine::hasQuery() const
+{
+    return active;
+}
+
+const QVector<FindMatch> &FindEngine::matches() const
+{
+    return results;
+}
+
+int FindEngine::matchIndexFrom(int position) const
+{
+    auto it = std::lower_bound(results.constBegin(), results.constEnd(), position,
+                               [](const FindMatch &match, int value) { return match.start < value; });
+    return it == results.constEnd() ? -1 : int(it - results.constBegin());
+}
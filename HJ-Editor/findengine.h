@@ -0,0 +1,121 @@
+#ifndef FINDENGINE_H
+#define FINDENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QRegularExpression>
+#include <QTimer>
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+// 查找条件
+struct FindQuery {
+    QString text;
+    bool caseSensitive;
+    bool wholeWords;
+    bool regex;
+
+    bool operator==(const FindQuery &other) const {
+        return text == other.text && caseSensitive == other.caseSensitive
+                && wholeWords == other.wholeWords && regex == other.regex;
+    }
+    bool operator!=(const FindQuery &other) const { return !(*this == other); }
+};
+
+// 一个匹配在文本中的位置（UTF-16 偏移）
+struct FindMatch {
+    int start;
+    int length;
+};
+Q_DECLARE_TYPEINFO(FindMatch, Q_PRIMITIVE_TYPE);
+
+// 全部替换中的一处：原文 [start, start + length) 替换为 text
+struct FindReplacement {
+    int start;
+    int length;
+    QString text;
+};
+
+// 查找引擎：在文档的连续 UTF-16 快照上查找全部匹配。
+// 普通文本用 SIMD 首尾字符过滤 + 逐字校验，正则表达式预先编译并 JIT；
+// 查找在工作线程中进行，匹配结果分批回传到 GUI 线程。
+// 新查询是上一个查询的延长时只校验上一次的匹配位置；文档编辑后只重新扫描改动所在的行。
+class FindEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 返回 false 时停止扫描
+    typedef std::function<bool(int start, int length)> MatchCallback;
+
+    explicit FindEngine(QObject *parent = nullptr);
+    ~FindEngine();
+
+    // 扫描内核，可在任意线程调用（替换、多文件查找共用）
+    static QRegularExpression compile(const FindQuery &query);
+    static void scan(const QString &text, const FindQuery &query, const QRegularExpression &re, const MatchCallback &onMatch);
+    // 一次扫描得到全部替换，按位置从前到后排列。
+    // 正则替换文本中的 \1 ~ \9 引用对应的捕获组
+    static QVector<FindReplacement> replaceAll(const QString &text, const FindQuery &query, const QRegularExpression &re,
+                                               const QString &replacement);
+
+    // 跟踪 document 的编辑，保持匹配位置与文档一致
+    void setDocument(QTextDocument *document);
+    // 在所跟踪文档的快照上后台查找，新的查找会取消正在进行的查找。
+    // 文档没有改动时复用上一次的快照，不再整篇复制
+    void search(const FindQuery &query);
+    void cancel();
+    void clear();
+
+    FindQuery query() const;
+    bool isSearching() const;
+    bool hasQuery() const;
+    const QVector<FindMatch> &matches() const;
+    // 第一个起点不小于 position 的匹配下标，没有时返回 -1
+    int matchIndexFrom(int position) const;
+
+signals:
+    void matchesFound();          // 收到一批新的匹配
+    void finished(int total);
+    void matchesChanged();        // 文档编辑后匹配集合已更新
+    void invalidQuery(const QString &errorString);
+
+private slots:
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+    void rescan();
+
+private:
+    static void scanLiteral(const QString &text, const FindQuery &query, const MatchCallback &onMatch);
+    static void refine(const QString &text, const FindQuery &query, const QVector<FindMatch> &previous, const MatchCallback &onMatch);
+    static bool canRefine(const FindQuery &previous, const FindQuery &query);
+    static bool mayCrossLines(const FindQuery &query);
+    void updateLines(int position, int removed, int added);
+    static QString expandReplacement(const QRegularExpressionMatch &match, const QString &replacement);
+    void deliver(quint64 generation, const QVector<FindMatch> &batch, bool done);
+    QString documentSnapshot();
+
+    FindQuery currentQuery;
+    QRegularExpression currentRe;
+    QVector<FindMatch> results;
+    quint64 generation;
+    bool searching;
+    bool active;
+    bool complete;     // results 是当前文档的全部匹配
+    QTextDocument *document;
+    int documentLength;
+    int lastRevision;
+    QString snapshot;
+    bool snapshotStale;
+    QTimer rescanTimer;
+    QThreadPool pool;  // 析构时等待所有（包括已取消的）查找线程结束
+    QSharedPointer<QAtomicInt> cancelFlag;
+};
+
+#endif // FINDENGINE_H
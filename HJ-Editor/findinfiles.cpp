@@ -0,0 +1,430 @@
+#include "findinfiles.h"
+#include "projectfiles.h"
+#include "trigramindex.h"
+#include <QtConcurrent>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+#include <QDir>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QListView>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFileDialog>
+#include <cstring>
+
+namespace {
+
+const qint64 MaxFileSize = 256 << 20;   // 更大的文件通常不是源码
+const int MaxMatchesPerFile = 10000;
+const int MaxResults = 200000;
+const int BatchSize = 256;
+const qint64 BatchInterval = 16;        // 毫秒
+const int FilesPerTake = 8;             // 每次从队列中取出的文件数，减少锁竞争
+
+} // namespace
+
+// 一次查找的共享状态：遍历线程生产文件路径，查找线程消费
+struct FindInFilesJob {
+    FindQuery query;
+    QRegularExpression re;
+    quint64 generation;
+    QAtomicInt cancelled;
+    QAtomicInt filesSearched;
+    QMutex mutex;
+    QWaitCondition ready;
+    QQueue<QString> files;
+    bool walkDone;
+};
+
+namespace {
+
+bool enqueueFile(FindInFilesJob *job, const QFileInfo &info)
+{
+    if (info.size() > 0 && info.size() <= MaxFileSize) {
+        QMutexLocker locker(&job->mutex);
+        job->files.enqueue(info.absoluteFilePath());
+        job->ready.wakeOne();
+    }
+    return !job->cancelled.loadAcquire();
+}
+
+void finishWalk(FindInFilesJob *job)
+{
+    QMutexLocker locker(&job->mutex);
+    job->walkDone = true;
+    job->ready.wakeAll();
+}
+
+} // namespace
+
+FindInFilesSearch::FindInFilesSearch(QObject *parent) : QObject(parent)
+{
+    index = nullptr;
+    generation = 0;
+    workersRunning = 0;
+    matchCount = 0;
+    // 一个遍历线程加每个核心一个查找线程
+    pool.setMaxThreadCount(QThread::idealThreadCount() + 1);
+}
+
+FindInFilesSearch::~FindInFilesSearch()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void FindInFilesSearch::setIndex(TrigramIndex *index)
+{
+    this->index = index;
+}
+
+void FindInFilesSearch::start(const QString &directory, const FindQuery &query)
+{
+    cancel();
+    QRegularExpression re = FindEngine::compile(query);
+    if (query.regex && !re.isValid()) {
+        emit invalidQuery(re.errorString());
+        return;
+    }
+
+    QSharedPointer<FindInFilesJob> job(new FindInFilesJob);
+    job->query = query;
+    job->re = re;
+    job->generation = ++generation;
+    job->walkDone = false;
+    current = job;
+    matchCount = 0;
+    timer.start();
+
+    // 索引可用时直接把候选文件放进队列，并在后台补查索引之后改过的文件；
+    // 否则边遍历边查找（同时为该目录建立索引）
+    QStringList candidates;
+    TrigramIndex::Check check;
+    bool narrowed = false;
+    if (index) {
+        if (index->covers(directory))
+            narrowed = index->candidates(query, directory, &candidates, &check);
+        else
+            index->open(directory);
+    }
+    if (narrowed) {
+        for (const QString &path : candidates)
+            job->files.enqueue(path);
+        QtConcurrent::run(&pool, [this, job, check] {
+            QStringList changed;
+            const bool complete = TrigramIndex::runCheck(check, [&job](const QFileInfo &info) {
+                return enqueueFile(job.data(), info);
+            }, &job->cancelled, &changed);
+            finishWalk(job.data());
+            if (check.restat) {
+                const QString root = check.root;
+                QMetaObject::invokeMethod(this, [this, root, changed, complete] {
+                    if (index)
+                        index->checkFinished(root, changed, complete);
+                }, Qt::QueuedConnection);
+            }
+        });
+    } else {
+        QtConcurrent::run(&pool, &FindInFilesSearch::walk, job, directory);
+    }
+    workersRunning = QThread::idealThreadCount();
+    for (int i = 0; i < workersRunning; ++i)
+        QtConcurrent::run(&pool, [this, job] { searchFiles(job); });
+}
+
+void FindInFilesSearch::cancel()
+{
+    if (current) {
+        current->cancelled.storeRelease(1);
+        QMutexLocker locker(&current->mutex);
+        current->ready.wakeAll();
+    }
+    current.clear();
+    ++generation;
+    workersRunning = 0;
+}
+
+bool FindInFilesSearch::isRunning() const
+{
+    return workersRunning > 0;
+}
+
+void FindInFilesSearch::walk(QSharedPointer<FindInFilesJob> job, const QString &directory)
+{
+    walkProject(directory, [&job](const QFileInfo &info) {
+        return enqueueFile(job.data(), info);
+    }, &job->cancelled);
+    finishWalk(job.data());
+}
+
+void FindInFilesSearch::searchFiles(QSharedPointer<FindInFilesJob> job)
+{
+    QVector<FileMatch> batch;
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    QStringList taken;
+
+    forever {
+        taken.clear();
+        {
+            QMutexLocker locker(&job->mutex);
+            while (job->files.isEmpty() && !job->walkDone && !job->cancelled.loadAcquire())
+                job->ready.wait(&job->mutex);
+            for (int i = 0; i < FilesPerTake && !job->files.isEmpty(); ++i)
+                taken << job->files.dequeue();
+        }
+        if (taken.isEmpty() || job->cancelled.loadAcquire())
+            break;
+
+        for (const QString &path : taken) {
+            searchFile(path, *job, &batch);
+            job->filesSearched.fetchAndAddRelaxed(1);
+            if (job->cancelled.loadAcquire())
+                break;
+            if (batch.size() >= BatchSize || (!batch.isEmpty() && batchTimer.elapsed() >= BatchInterval)) {
+                QVector<FileMatch> sending;
+                sending.swap(batch);
+                quint64 gen = job->generation;
+                QMetaObject::invokeMethod(this, [this, gen, sending] { deliver(gen, sending); }, Qt::QueuedConnection);
+                batchTimer.restart();
+            }
+        }
+    }
+
+    quint64 gen = job->generation;
+    QMetaObject::invokeMethod(this, [this, gen, batch] {
+        deliver(gen, batch);
+        workerDone(gen);
+    }, Qt::QueuedConnection);
+}
+
+void FindInFilesSearch::searchFile(const QString &path, const FindInFilesJob &job, QVector<FileMatch> *out)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const qint64 size = file.size();
+    if (size <= 0 || size > MaxFileSize)
+        return;
+    QByteArray fallback;
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        fallback = file.readAll();
+        data = reinterpret_cast<const uchar *>(fallback.constData());
+    }
+    // 开头含有 NUL 的视为二进制文件（映射在 file 析构时解除）
+    if (memchr(data, 0, size_t(qMin<qint64>(size, 8192))))
+        return;
+    const QString text = QString::fromUtf8(reinterpret_cast<const char *>(data), int(size));
+    if (fallback.isEmpty())
+        file.unmap(const_cast<uchar *>(data));
+
+    int line = 1;
+    int lineStart = 0;
+    int scanned = 0;
+    int found = 0;
+    const QChar *chars = text.constData();
+    FindEngine::scan(text, job.query, job.re, [&](int start, int length) {
+        if (job.cancelled.loadAcquire())
+            return false;
+        // 行号只向前增量计算
+        for (; scanned < start; ++scanned) {
+            if (chars[scanned] == QLatin1Char('\n')) {
+                ++line;
+                lineStart = scanned + 1;
+            }
+        }
+        int lineEnd = text.indexOf(QLatin1Char('\n'), start);
+        if (lineEnd < 0)
+            lineEnd = text.size();
+        out->append({path, line, start - lineStart, length, text.mid(lineStart, qMin(lineEnd - lineStart, 200))});
+        return ++found < MaxMatchesPerFile;
+    });
+}
+
+void FindInFilesSearch::deliver(quint64 generation, const QVector<FileMatch> &batch)
+{
+    if (generation != this->generation || batch.isEmpty())
+        return;
+    matchCount += batch.size();
+    emit matchesFound(batch);
+}
+
+void FindInFilesSearch::workerDone(quint64 generation)
+{
+    if (generation != this->generation || !current)
+        return;
+    if (--workersRunning == 0) {
+        emit finished(current->filesSearched.loadAcquire(), matchCount, timer.elapsed());
+        current.clear();
+    }
+}
+
+FindResultsModel::FindResultsModel(QObject *parent) : QAbstractListModel(parent)
+{
+}
+
+void FindResultsModel::setRoot(const QString &root)
+{
+    this->root = QDir(root).absolutePath() + QLatin1Char('/');
+}
+
+void FindResultsModel::clear()
+{
+    beginResetModel();
+    results.clear();
+    endResetModel();
+}
+
+void FindResultsModel::append(const QVector<FileMatch> &matches)
+{
+    int count = qMin(matches.size(), MaxResults - results.size());
+    if (count <= 0)
+        return;
+    beginInsertRows(QModelIndex(), results.size(), results.size() + count - 1);
+    results += matches.mid(0, count);
+    endInsertRows();
+}
+
+const FileMatch &FindResultsModel::matchAt(int row) const
+{
+    return results.at(row);
+}
+
+int FindResultsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : results.size();
+}
+
+QVariant FindResultsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= results.size())
+        return QVariant();
+    const FileMatch &match = results.at(index.row());
+    if (role == Qt::DisplayRole) {
+        QString path = match.path.startsWith(root) ? match.path.mid(root.size()) : match.path;
+        return QStringLiteral("%1:%2: %3").arg(path).arg(match.line).arg(match.preview.trimmed());
+    }
+    if (role == Qt::ToolTipRole)
+        return match.path;
+    return QVariant();
+}
+
+FindInFilesPanel::FindInFilesPanel(QWidget *parent) : QWidget(parent)
+{
+    directoryEdit = new QLineEdit(this);
+    queryEdit = new QLineEdit(this);
+    browseButton = new QPushButton("浏览...", this);
+    searchButton = new QPushButton("查找", this);
+    caseSensitiveCheckBox = new QCheckBox("区分大小写", this);
+    wholeWordsCheckBox = new QCheckBox("全词匹配", this);
+    regexCheckBox = new QCheckBox("使用正则表达式", this);
+    statusLabel = new QLabel(this);
+    resultView = new QListView(this);
+    model = new FindResultsModel(this);
+    search = new FindInFilesSearch(this);
+
+    // 统一行高 + 批量布局：视图只为可见行计算布局，结果再多也不卡
+    resultView->setModel(model);
+    resultView->setUniformItemSizes(true);
+    resultView->setLayoutMode(QListView::Batched);
+    resultView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    QHBoxLayout *directoryLayout = new QHBoxLayout;
+    QHBoxLayout *queryLayout = new QHBoxLayout;
+    QHBoxLayout *optionsLayout = new QHBoxLayout;
+
+    directoryLayout->addWidget(new QLabel("目录:", this));
+    directoryLayout->addWidget(directoryEdit);
+    directoryLayout->addWidget(browseButton);
+    queryLayout->addWidget(new QLabel("查找:", this));
+    queryLayout->addWidget(queryEdit);
+    queryLayout->addWidget(searchButton);
+    optionsLayout->addWidget(caseSensitiveCheckBox);
+    optionsLayout->addWidget(wholeWordsCheckBox);
+    optionsLayout->addWidget(regexCheckBox);
+    optionsLayout->addStretch();
+    optionsLayout->addWidget(statusLabel);
+
+    mainLayout->addLayout(directoryLayout);
+    mainLayout->addLayout(queryLayout);
+    mainLayout->addLayout(optionsLayout);
+    mainLayout->addWidget(resultView);
+    setLayout(mainLayout);
+
+    connect(browseButton, &QPushButton::clicked, this, &FindInFilesPanel::chooseDirectory);
+    connect(searchButton, &QPushButton::clicked, this, &FindInFilesPanel::startSearch);
+    connect(queryEdit, &QLineEdit::returnPressed, this, &FindInFilesPanel::startSearch);
+    connect(resultView, &QListView::activated, this, &FindInFilesPanel::activateResult);
+    connect(search, &FindInFilesSearch::matchesFound, this, &FindInFilesPanel::appendMatches);
+    connect(search, &FindInFilesSearch::finished, this, &FindInFilesPanel::searchFinished);
+    connect(search, &FindInFilesSearch::invalidQuery, this, [this](const QString &errorString) {
+        statusLabel->setText(tr("正则表达式错误：") + errorString);
+    });
+}
+
+void FindInFilesPanel::setIndex(TrigramIndex *index)
+{
+    search->setIndex(index);
+}
+
+void FindInFilesPanel::setDirectory(const QString &directory)
+{
+    directoryEdit->setText(directory);
+}
+
+QString FindInFilesPanel::directory() const
+{
+    return directoryEdit->text();
+}
+
+void FindInFilesPanel::focusQuery()
+{
+    queryEdit->setFocus();
+    queryEdit->selectAll();
+}
+
+void FindInFilesPanel::chooseDirectory()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, tr("选择查找目录"), directoryEdit->text());
+    if (!directory.isEmpty())
+        directoryEdit->setText(directory);
+}
+
+void FindInFilesPanel::startSearch()
+{
+    QString text = queryEdit->text();
+    QString directory = directoryEdit->text();
+    if (text.isEmpty() || !QDir(directory).exists())
+        return;
+    FindQuery query = {text, caseSensitiveCheckBox->isChecked(), wholeWordsCheckBox->isChecked(), regexCheckBox->isChecked()};
+    model->clear();
+    model->setRoot(directory);
+    statusLabel->setText(tr("正在查找..."));
+    search->start(directory, query);
+}
+
+void FindInFilesPanel::appendMatches(const QVector<FileMatch> &matches)
+{
+    model->append(matches);
+    statusLabel->setText(tr("正在查找... %1 个匹配").arg(model->rowCount()));
+}
+
+void FindInFilesPanel::searchFinished(int files, int matches, qint64 elapsed)
+{
+    statusLabel->setText(tr("%1 个文件，%2 个匹配，用时 %3 ms").arg(files).arg(matches).arg(elapsed));
+}
+
+void FindInFilesPanel::activateResult(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return;
+    const FileMatch &match = model->matchAt(index.row());
+    emit openRequested(match.path, match.line, match.column, match.length);
+}
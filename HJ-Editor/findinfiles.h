@@ -0,0 +1,126 @@
+#ifndef FINDINFILES_H
+#define FINDINFILES_H
+
+#include <QObject>
+#include <QWidget>
+#include <QAbstractListModel>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include "findengine.h"
+
+QT_BEGIN_NAMESPACE
+class QLineEdit;
+class QCheckBox;
+class QPushButton;
+class QLabel;
+class QListView;
+QT_END_NAMESPACE
+
+struct FindInFilesJob;
+class TrigramIndex;
+
+// 多文件查找的一条结果
+struct FileMatch {
+    QString path;
+    int line;      // 从 1 开始
+    int column;    // 从 0 开始
+    int length;
+    QString preview;
+};
+
+// 在目录树中并行查找：一个线程遍历目录（遵守忽略文件），其余线程从共享队列中取文件，
+// 内存映射后用与单文件查找相同的内核扫描，结果分批流式回传。新的查找会取消正在进行的查找。
+class FindInFilesSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FindInFilesSearch(QObject *parent = nullptr);
+    ~FindInFilesSearch();
+
+    // 设置索引后，目录在索引范围内且查询能缩小候选时只查找候选文件
+    void setIndex(TrigramIndex *index);
+    void start(const QString &directory, const FindQuery &query);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void matchesFound(const QVector<FileMatch> &matches);
+    void finished(int files, int matches, qint64 elapsed);
+    void invalidQuery(const QString &errorString);
+
+private:
+    static void walk(QSharedPointer<FindInFilesJob> job, const QString &directory);
+    void searchFiles(QSharedPointer<FindInFilesJob> job);
+    static void searchFile(const QString &path, const FindInFilesJob &job, QVector<FileMatch> *out);
+    void deliver(quint64 generation, const QVector<FileMatch> &batch);
+    void workerDone(quint64 generation);
+
+    QThreadPool pool;
+    TrigramIndex *index;
+    QSharedPointer<FindInFilesJob> current;
+    quint64 generation;
+    int workersRunning;
+    int matchCount;
+    QElapsedTimer timer;
+};
+
+// 结果列表模型：只保存数据，视图按需绘制可见行
+class FindResultsModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit FindResultsModel(QObject *parent = nullptr);
+
+    void setRoot(const QString &root);
+    void clear();
+    void append(const QVector<FileMatch> &matches);
+    const FileMatch &matchAt(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    QVector<FileMatch> results;
+    QString root;
+};
+
+// “在文件中查找”面板
+class FindInFilesPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FindInFilesPanel(QWidget *parent = nullptr);
+    void setIndex(TrigramIndex *index);
+    void setDirectory(const QString &directory);
+    QString directory() const;
+    void focusQuery();
+
+signals:
+    void openRequested(const QString &path, int line, int column, int length);
+
+private slots:
+    void chooseDirectory();
+    void startSearch();
+    void appendMatches(const QVector<FileMatch> &matches);
+    void searchFinished(int files, int matches, qint64 elapsed);
+    void activateResult(const QModelIndex &index);
+
+private:
+    QLineEdit *directoryEdit;
+    QLineEdit *queryEdit;
+    QPushButton *browseButton;
+    QPushButton *searchButton;
+    QCheckBox *caseSensitiveCheckBox;
+    QCheckBox *wholeWordsCheckBox;
+    QCheckBox *regexCheckBox;
+    QLabel *statusLabel;
+    QListView *resultView;
+    FindResultsModel *model;
+    FindInFilesSearch *search;
+};
+
+#endif // FINDINFILES_H
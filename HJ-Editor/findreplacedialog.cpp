@@ -13,6 +13,7 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent) : QDialog(parent)
     replaceButton = new QPushButton("替换", this);
     replaceAllButton = new QPushButton("全部替换", this);
     closeButton = new QPushButton("关闭", this);
+    matchLabel = new QLabel(this);
 
     QVBoxLayout *mainLayout = new QVBoxLayout;
     QHBoxLayout *findLayout = new QHBoxLayout;
@@ -27,6 +28,8 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent) : QDialog(parent)
     optionsLayout->addWidget(caseSensitiveCheckBox);
     optionsLayout->addWidget(wholeWordsCheckBox);
     optionsLayout->addWidget(regexCheckBox);
+    optionsLayout->addStretch();
+    optionsLayout->addWidget(matchLabel);
     buttonLayout->addWidget(findButton);
     buttonLayout->addWidget(replaceButton);
     buttonLayout->addWidget(replaceAllButton);
@@ -43,12 +46,21 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent) : QDialog(parent)
     connect(replaceButton, &QPushButton::clicked, this, &FindReplaceDialog::onReplaceClicked);
     connect(replaceAllButton, &QPushButton::clicked, this, &FindReplaceDialog::onReplaceAllClicked);
     connect(closeButton, &QPushButton::clicked, this, &FindReplaceDialog::close);
+    connect(findLineEdit, &QLineEdit::textChanged, this, &FindReplaceDialog::onQueryChanged);
+    connect(caseSensitiveCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onQueryChanged);
+    connect(wholeWordsCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onQueryChanged);
+    connect(regexCheckBox, &QCheckBox::toggled, this, &FindReplaceDialog::onQueryChanged);
 }
 
 FindReplaceDialog::~FindReplaceDialog()
 {
 }
 
+void FindReplaceDialog::setMatchInfo(const QString &info)
+{
+    matchLabel->setText(info);
+}
+
 void FindReplaceDialog::onFindClicked()
 {
     QString findText = findLineEdit->text();
@@ -59,6 +71,16 @@ void FindReplaceDialog::onFindClicked()
     emit find(findText, caseSensitive, wholeWords, regex);
 }
 
+void FindReplaceDialog::onQueryChanged()
+{
+    QString findText = findLineEdit->text();
+    bool caseSensitive = caseSensitiveCheckBox->isChecked();
+    bool wholeWords = wholeWordsCheckBox->isChecked();
+    bool regex = regexCheckBox->isChecked();
+
+    emit queryChanged(findText, caseSensitive, wholeWords, regex);
+}
+
 void FindReplaceDialog::onReplaceClicked()
 {
     QString findText = findLineEdit->text();
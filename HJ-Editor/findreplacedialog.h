@@ -7,6 +7,7 @@
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QLabel>
 
 class FindReplaceDialog : public QDialog
 {
@@ -15,14 +16,17 @@ class FindReplaceDialog : public QDialog
 public:
     FindReplaceDialog(QWidget *parent = nullptr);
     ~FindReplaceDialog();
+    void setMatchInfo(const QString &info);  // 显示“第 n 个，共 N 个”等查找状态
 
 signals:
     void find(const QString &text, bool caseSensitive, bool wholeWords, bool regex);
+    void queryChanged(const QString &text, bool caseSensitive, bool wholeWords, bool regex);  // 边输入边查找
     void replace(const QString &findText, const QString &replaceText, bool caseSensitive, bool wholeWords, bool regex);
     void replaceAll(const QString &findText, const QString &replaceText, bool caseSensitive, bool wholeWords, bool regex);
 
 private slots:
     void onFindClicked();
+    void onQueryChanged();
     void onReplaceClicked();
     void onReplaceAllClicked();
 
@@ -36,6 +40,7 @@ private:
     QPushButton *replaceButton;
     QPushButton *replaceAllButton;
     QPushButton *closeButton;
+    QLabel *matchLabel;
 };
 
 #endif // FINDREPLACEDIALOG_H
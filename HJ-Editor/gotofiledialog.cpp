@@ -0,0 +1,122 @@
+#include "gotofiledialog.h"
+#include <QKeyEvent>
+#include <algorithm>
+
+namespace {
+
+const int MaxShown = 100;
+
+} // namespace
+
+GoToFileDialog::GoToFileDialog(QWidget *parent) : QDialog(parent)
+{
+    setWindowTitle("转到文件");
+    resize(560, 360);
+
+    patternEdit = new QLineEdit(this);
+    resultList = new QListWidget(this);
+    statusLabel = new QLabel(this);
+    resultList->setUniformItemSizes(true);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(patternEdit);
+    mainLayout->addWidget(resultList);
+    mainLayout->addWidget(statusLabel);
+    setLayout(mainLayout);
+
+    connect(patternEdit, &QLineEdit::textChanged, this, &GoToFileDialog::filter);
+    connect(patternEdit, &QLineEdit::returnPressed, this, &GoToFileDialog::choose);
+    connect(resultList, &QListWidget::itemActivated, this, &GoToFileDialog::choose);
+}
+
+void GoToFileDialog::setFiles(const QString &root, const QStringList &files)
+{
+    this->root = root;
+    this->files.clear();
+    this->files.reserve(files.size());
+    for (const QString &path : files)
+        this->files.append(path.startsWith(root) ? path.mid(root.size()) : path);
+    filter();
+}
+
+void GoToFileDialog::setStatus(const QString &status)
+{
+    statusLabel->setText(status);
+}
+
+// 上下键在输入框中移动结果列表的选中行
+void GoToFileDialog::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Down || event->key() == Qt::Key_Up) {
+        int row = resultList->currentRow() + (event->key() == Qt::Key_Down ? 1 : -1);
+        if (row >= 0 && row < resultList->count())
+            resultList->setCurrentRow(row);
+        return;
+    }
+    QDialog::keyPressEvent(event);
+}
+
+void GoToFileDialog::filter()
+{
+    struct Scored {
+        int score;
+        int index;
+    };
+    const QString pattern = patternEdit->text().remove(QLatin1Char(' '));
+    QVector<Scored> scored;
+    for (int i = 0; i < files.size(); ++i) {
+        int s = pattern.isEmpty() ? 0 : score(pattern, files.at(i));
+        if (s >= 0)
+            scored.append({s, i});
+    }
+    // 分数高的在前，同分时路径短的在前
+    auto better = [this](const Scored &a, const Scored &b) {
+        if (a.score != b.score)
+            return a.score > b.score;
+        return files.at(a.index).size() < files.at(b.index).size();
+    };
+    const int shown = qMin(scored.size(), MaxShown);
+    std::partial_sort(scored.begin(), scored.begin() + shown, scored.end(), better);
+
+    resultList->clear();
+    for (int i = 0; i < shown; ++i)
+        resultList->addItem(files.at(scored.at(i).index));
+    if (shown > 0)
+        resultList->setCurrentRow(0);
+    statusLabel->setText(tr("%1 / %2 个文件").arg(scored.size()).arg(files.size()));
+}
+
+void GoToFileDialog::choose()
+{
+    QListWidgetItem *item = resultList->currentItem();
+    if (!item)
+        return;
+    emit fileChosen(root + item->text());
+    accept();
+}
+
+// pattern 按顺序出现在 candidate 中（忽略大小写）时返回分数，否则返回 -1。
+// 连续匹配、匹配在文件名内、匹配在单词开头都加分
+int GoToFileDialog::score(const QString &pattern, const QString &candidate)
+{
+    const int nameStart = candidate.lastIndexOf(QLatin1Char('/')) + 1;
+    int total = 0;
+    int last = -2;
+    int j = 0;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i).toLower();
+        while (j < candidate.size() && candidate.at(j).toLower() != c)
+            ++j;
+        if (j >= candidate.size())
+            return -1;
+        total += 1;
+        if (j == last + 1)
+            total += 5;
+        if (j >= nameStart)
+            total += 2;
+        if (j == 0 || !candidate.at(j - 1).isLetterOrNumber())
+            total += 3;
+        last = j++;
+    }
+    return total;
+}
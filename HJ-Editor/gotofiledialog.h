@@ -0,0 +1,40 @@
+#ifndef GOTOFILEDIALOG_H
+#define GOTOFILEDIALOG_H
+
+#include <QDialog>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLabel>
+#include <QVBoxLayout>
+
+// “转到文件”：在项目索引的文件表中按子序列模糊匹配相对路径
+class GoToFileDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    GoToFileDialog(QWidget *parent = nullptr);
+    void setFiles(const QString &root, const QStringList &files);
+    void setStatus(const QString &status);
+
+signals:
+    void fileChosen(const QString &path);
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+    void filter();
+    void choose();
+
+private:
+    static int score(const QString &pattern, const QString &candidate);
+
+    QLineEdit *patternEdit;
+    QListWidget *resultList;
+    QLabel *statusLabel;
+    QString root;
+    QStringList files;   // 相对 root 的路径
+};
+
+#endif // GOTOFILEDIALOG_H
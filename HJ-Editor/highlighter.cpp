@@ -2,23 +2,197 @@
 #include <QFont>
 #include <QColor>
 #include <QFileInfo>
+#include <QHash>
+#include <QTextDocument>
+#include <QElapsedTimer>
 
+namespace {
+
+// 后台词法分析每段的时间上限
+const int LexChunkMilliseconds = 8;
+
+} // namespace
+
+// 基类先不挂文档（以 QObject 为父对象的构造函数只认 QTextEdit），仍由文档持有
 Highlighter::Highlighter(QTextDocument *parent, LanguageType lang)
-    : QSyntaxHighlighter(parent)
+    : QSyntaxHighlighter(static_cast<QObject *>(parent)), lang(lang)
+{
+    // 规则在第一次遇到非空的行时才编译，空白的新文件不必为此付出启动时间
+    deferred = false;
+    cacheRevision = -1;
+    cachedLineCount = 0;
+    lexTimer.setInterval(0);
+    connect(&lexTimer, &QTimer::timeout, this, &Highlighter::lexNextChunk);
+    // 要先于 QSyntaxHighlighter 收到文档变化：尚未分析的行重新着色之前，缓存已经随行号移动。
+    // 槽按连接顺序调用，所以先连接，再由 setDocument 连接基类的重新着色
+    if (parent) {
+        connect(parent, &QTextDocument::contentsChange, this, &Highlighter::shiftCachedTokens);
+        setDocument(parent);
+    }
+}
+
+LanguageType Highlighter::language() const
+{
+    return lang;
+}
+
+void Highlighter::setLanguage(LanguageType lang)
+{
+    if (lang == this->lang)
+        return;
+    this->lang = lang;
+    grammar.reset();
+    cachedBlocks.clear();   // 缓存是按原来的语言分析的
+    rehighlight();
+}
+
+// 每种语言的规则只编译一次，打开再多文档也共用同一份
+QSharedPointer<const Highlighter::Grammar> Highlighter::grammarFor(LanguageType lang)
+{
+    static QHash<int, QSharedPointer<const Grammar>> grammars;
+    QSharedPointer<const Grammar> &cached = grammars[lang];
+    if (!cached) {
+        Grammar *grammar = new Grammar;
+        // 根据语言类型初始化规则
+        switch (lang) {
+            case Cpp: initCppRules(grammar); break;
+            case Python: initPythonRules(grammar); break;
+            case JSON: initJsonRules(grammar); break;
+        }
+        // 立即编译并启用 JIT
+        for (HighlightingRule &rule : grammar->highlightingRules)
+            rule.pattern.optimize();
+        grammar->commentStartExpression.optimize();
+        grammar->commentEndExpression.optimize();
+        cached.reset(grammar);
+    }
+    return cached;
+}
+
+void Highlighter::deferLexing(const QVector<BlockTokens> &cached)
+{
+    deferred = true;
+    cacheRevision = -1;
+    cachedBlocks = cached;
+    lexTimer.start();
+}
+
+bool Highlighter::isLexingDeferred() const
+{
+    return deferred;
+}
+
+// QSyntaxHighlighter 在 setDocument 中以这个私有槽跟随文档变化
+void Highlighter::suspend()
+{
+    if (document())
+        disconnect(document(), SIGNAL(contentsChange(int,int,int)), this, SLOT(_q_reformatBlocks(int,int,int)));
+}
+
+void Highlighter::resume(const QVector<QTextBlock> &touched)
+{
+    if (!document())
+        return;
+    connect(document(), SIGNAL(contentsChange(int,int,int)), this, SLOT(_q_reformatBlocks(int,int,int)));
+    for (const QTextBlock &block : touched)
+        rehighlightBlock(block);
+}
+
+// 从 frontier 起逐行分析；某行分析后状态改变时 QSyntaxHighlighter 会接着分析下一行，
+// 下一行仍在 frontier 之后，按缓存给出同样的状态，连锁到此为止
+void Highlighter::lexNextChunk()
+{
+    QTextDocument *doc = document();
+    if (!deferred || !doc) {
+        lexTimer.stop();
+        return;
+    }
+    // 第一次进入时载入已经完成（载入时插入文本会把光标推到末尾，所以这时才放下 frontier）
+    if (cacheRevision < 0) {
+        cacheRevision = doc->revision();
+        cachedLineCount = doc->blockCount();
+        frontier = QTextCursor(doc);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    QTextBlock block = frontier.block();
+    while (block.isValid() && timer.elapsed() < LexChunkMilliseconds) {
+        QTextBlock next = block.next();
+        if (next.isValid())
+            frontier.setPosition(next.position());
+        else
+            deferred = false;
+        rehighlightBlock(block);
+        block = next;
+    }
+    if (!deferred || !block.isValid()) {
+        deferred = false;
+        cachedBlocks.clear();
+        frontier = QTextCursor();
+        lexTimer.stop();
+    }
+}
+
+// 载入完成后的编辑：改动所在的行缓存作废，其后的行按增减的行数移动，
+// 编辑 frontier 之后的行不会让其余的缓存失效。只有格式变化（高亮本身）时文档版本不变
+void Highlighter::shiftCachedTokens(int position, int removed, int added)
 {
-    // 根据语言类型初始化规则
-    switch (lang) {
-        case Cpp: initCppRules(); break;
-        case Python: initPythonRules(); break;
-        case JSON: initJsonRules(); break;
+    QTextDocument *doc = document();
+    if (!deferred || cacheRevision < 0 || !doc || (removed == added && doc->revision() == cacheRevision))
+        return;
+    cacheRevision = doc->revision();
+    const int first = doc->findBlock(position).blockNumber();
+    const int last = doc->findBlock(position + added).blockNumber();
+    const int delta = doc->blockCount() - cachedLineCount;
+    cachedLineCount = doc->blockCount();
+    if (first < 0 || first >= cachedBlocks.size())
+        return;
+    const int oldLast = qMin(last - delta, cachedBlocks.size() - 1);
+    if (oldLast >= first)
+        cachedBlocks.remove(first, oldLast - first + 1);
+    BlockTokens stale;
+    stale.state = -1;
+    stale.length = -1;
+    cachedBlocks.insert(first, qMax(0, last - first + 1), stale);
+}
+
+// 尚未分析的行：缓存与文本对应时照缓存着色。没有对应的缓存（刚编辑过的行）时保留原来的颜色与状态，
+// 状态不变，QSyntaxHighlighter 的连锁到此为止，后面的行保持缓存的颜色，等后台分析到这里再更新
+void Highlighter::applyCachedTokens(const QString &text)
+{
+    const int number = currentBlock().blockNumber();
+    if (number < cachedBlocks.size() && cachedBlocks.at(number).length == text.length()) {
+        const BlockTokens &tokens = cachedBlocks.at(number);
+        for (const QTextLayout::FormatRange &range : tokens.formats)
+            setFormat(range.start, range.length, range.format);
+        setCurrentBlockState(tokens.state);
+        return;
+    }
+    const QTextBlock block = currentBlock();
+    if (block.layout()) {
+        for (const QTextLayout::FormatRange &range : block.layout()->formats())
+            setFormat(range.start, range.length, range.format);
     }
+    setCurrentBlockState(block.userState());
 }
 
 // 核心高亮逻辑
 void Highlighter::highlightBlock(const QString &text)
 {
+    if (deferred && (cacheRevision < 0 || currentBlock().position() >= frontier.position())) {
+        applyCachedTokens(text);
+        return;
+    }
+    // 空行没有可匹配的内容，只需延续多行注释的状态
+    if (text.isEmpty()) {
+        setCurrentBlockState(previousBlockState() == 1 ? 1 : 0);
+        return;
+    }
+    if (!grammar)
+        grammar = grammarFor(lang);
+
     // 应用所有单行规则
-    for (const HighlightingRule &rule : highlightingRules) {
+    for (const HighlightingRule &rule : grammar->highlightingRules) {
         QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
         while (matchIterator.hasNext()) {
             QRegularExpressionMatch match = matchIterator.next();
@@ -28,6 +202,10 @@ void Highlighter::highlightBlock(const QString &text)
 
     // 处理多行注释
     setCurrentBlockState(0);
+    const QRegularExpression &commentStartExpression = grammar->commentStartExpression;
+    const QRegularExpression &commentEndExpression = grammar->commentEndExpression;
+    if (commentStartExpression.pattern().isEmpty())
+        return;  // 没有多行注释的语言（空模式会在原地反复匹配）
     int startIndex = 0;
     if (previousBlockState() != 1)
         startIndex = text.indexOf(commentStartExpression);
@@ -45,14 +223,15 @@ void Highlighter::highlightBlock(const QString &text)
             commentLength = endIndex - startIndex + match.capturedLength();
         }
 
-        setFormat(startIndex, commentLength, multiLineCommentFormat);
+        setFormat(startIndex, commentLength, grammar->multiLineCommentFormat);
         startIndex = text.indexOf(commentStartExpression, startIndex + commentLength);
     }
 }
 
 // 初始化C++高亮规则
-void Highlighter::initCppRules()
+void Highlighter::initCppRules(Grammar *grammar)
 {
+    QTextCharFormat keywordFormat, classFormat, singleLineCommentFormat, quotationFormat, functionFormat;
     // 关键字格式（加粗、粉红色）
     keywordFormat.setForeground(QColor(201, 81, 116));
     keywordFormat.setFontWeight(QFont::Bold);
@@ -71,38 +250,39 @@ void Highlighter::initCppRules()
     };
     // 添加关键字规则
     for (const QString &pattern : keywordPatterns) {
-        highlightingRules.append({QRegularExpression(pattern), keywordFormat});
+        grammar->highlightingRules.append({QRegularExpression(pattern), keywordFormat});
     }
 
     // 类名格式（深洋红色、加粗）
     classFormat.setForeground(Qt::darkMagenta);
     classFormat.setFontWeight(QFont::Bold);
-    highlightingRules.append({QRegularExpression("(?<=class\\s)\\w+"), classFormat});
+    grammar->highlightingRules.append({QRegularExpression("(?<=class\\s)\\w+"), classFormat});
 
     // 单行注释格式（绿色）
     singleLineCommentFormat.setForeground(Qt::green);
-    highlightingRules.append({QRegularExpression("//[^\n]*"), singleLineCommentFormat});
+    grammar->highlightingRules.append({QRegularExpression("//[^\n]*"), singleLineCommentFormat});
 
     // 多行注释格式（绿色）
-    multiLineCommentFormat.setForeground(Qt::green);
-    commentStartExpression = QRegularExpression("/\\*");
-    commentEndExpression = QRegularExpression("\\*/");
+    grammar->multiLineCommentFormat.setForeground(Qt::green);
+    grammar->commentStartExpression = QRegularExpression("/\\*");
+    grammar->commentEndExpression = QRegularExpression("\\*/");
 
     // 字符串和头文件包含格式（深绿色）
     quotationFormat.setForeground(Qt::darkGreen);
-    highlightingRules.append({QRegularExpression("\"[^\"]*\""), quotationFormat});  // 字符串
-    highlightingRules.append({QRegularExpression("<[^\>]*>"), quotationFormat});   // 头文件
-    highlightingRules.append({QRegularExpression("#include\\s+[<\"].*[>\"]"), quotationFormat});  // #include
+    grammar->highlightingRules.append({QRegularExpression("\"[^\"]*\""), quotationFormat});  // 字符串
+    grammar->highlightingRules.append({QRegularExpression("<[^\>]*>"), quotationFormat});   // 头文件
+    grammar->highlightingRules.append({QRegularExpression("#include\\s+[<\"].*[>\"]"), quotationFormat});  // #include
 
     // 函数名格式（浅蓝色、斜体）
     functionFormat.setForeground(QColor(115, 182, 209));
     functionFormat.setFontItalic(true);
-    highlightingRules.append({QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()"), functionFormat});
+    grammar->highlightingRules.append({QRegularExpression("\\b[A-Za-z0-9_]+(?=\\()"), functionFormat});
 }
 
 // 初始化Python高亮规则
-void Highlighter::initPythonRules()
+void Highlighter::initPythonRules(Grammar *grammar)
 {
+    QTextCharFormat keywordFormat, singleLineCommentFormat, quotationFormat, functionFormat, numberFormat;
     // 关键字格式（蓝色、加粗）
     keywordFormat.setForeground(Qt::blue);
     keywordFormat.setFontWeight(QFont::Bold);
@@ -114,65 +294,66 @@ void Highlighter::initPythonRules()
         "\\braise\\b", "\\bfinally\\b", "\\bwith\\b", "\\blambda\\b"
     };
     for (const QString &pattern : keywordPatterns) {
-        highlightingRules.append({QRegularExpression(pattern), keywordFormat});
+        grammar->highlightingRules.append({QRegularExpression(pattern), keywordFormat});
     }
 
     // 单行注释格式（绿色）
     singleLineCommentFormat.setForeground(Qt::green);
-    highlightingRules.append({QRegularExpression("#[^\n]*"), singleLineCommentFormat});
+    grammar->highlightingRules.append({QRegularExpression("#[^\n]*"), singleLineCommentFormat});
 
     // 字符串格式（深绿色，支持单引号和双引号）
     quotationFormat.setForeground(Qt::darkGreen);
-    highlightingRules.append({QRegularExpression("'[^']*'"), quotationFormat});
-    highlightingRules.append({QRegularExpression("\"[^\"]*\""), quotationFormat});
+    grammar->highlightingRules.append({QRegularExpression("'[^']*'"), quotationFormat});
+    grammar->highlightingRules.append({QRegularExpression("\"[^\"]*\""), quotationFormat});
 
     // 函数名格式（深洋红色、斜体）
     functionFormat.setForeground(Qt::darkMagenta);
     functionFormat.setFontItalic(true);
-    highlightingRules.append({QRegularExpression("(?<=def\\s)\\w+"), functionFormat});
+    grammar->highlightingRules.append({QRegularExpression("(?<=def\\s)\\w+"), functionFormat});
 
     // 数字格式（红色）
     numberFormat.setForeground(Qt::red);
-    highlightingRules.append({QRegularExpression("\\b\\d+\\b"), numberFormat});  // 整数
-    highlightingRules.append({QRegularExpression("\\b\\d+\\.\\d+\\b"), numberFormat});  // 浮点数
+    grammar->highlightingRules.append({QRegularExpression("\\b\\d+\\b"), numberFormat});  // 整数
+    grammar->highlightingRules.append({QRegularExpression("\\b\\d+\\.\\d+\\b"), numberFormat});  // 浮点数
 
     // Python无多行注释（用三引号实现，此处简化处理）
-    commentStartExpression = QRegularExpression("'''");
-    commentEndExpression = QRegularExpression("'''");
-    multiLineCommentFormat.setForeground(Qt::green);
+    grammar->commentStartExpression = QRegularExpression("'''");
+    grammar->commentEndExpression = QRegularExpression("'''");
+    grammar->multiLineCommentFormat.setForeground(Qt::green);
 }
 
 // 初始化JSON高亮规则
-void Highlighter::initJsonRules()
+void Highlighter::initJsonRules(Grammar *grammar)
 {
+    QTextCharFormat jsonKeyFormat, quotationFormat, numberFormat, keywordFormat, jsonSeparatorFormat;
     // JSON键格式（蓝色、加粗）
     jsonKeyFormat.setForeground(Qt::blue);
     jsonKeyFormat.setFontWeight(QFont::Bold);
-    highlightingRules.append({QRegularExpression("\"[^\"]+\":"), jsonKeyFormat});
+    grammar->highlightingRules.append({QRegularExpression("\"[^\"]+\":"), jsonKeyFormat});
 
     // 字符串值格式（深绿色）
     quotationFormat.setForeground(Qt::darkGreen);
-    highlightingRules.append({QRegularExpression("\"[^\"]*\""), quotationFormat});
+    grammar->highlightingRules.append({QRegularExpression("\"[^\"]*\""), quotationFormat});
 
     // 数字格式（红色）
     numberFormat.setForeground(Qt::red);
-    highlightingRules.append({QRegularExpression("-?\\d+"), numberFormat});  // 整数
-    highlightingRules.append({QRegularExpression("-?\\d+\\.\\d+"), numberFormat});  // 浮点数
-    highlightingRules.append({QRegularExpression("-?\\d+[eE][+-]?\\d+"), numberFormat});  // 科学计数法
+    grammar->highlightingRules.append({QRegularExpression("-?\\d+"), numberFormat});  // 整数
+    grammar->highlightingRules.append({QRegularExpression("-?\\d+\\.\\d+"), numberFormat});  // 浮点数
+    grammar->highlightingRules.append({QRegularExpression("-?\\d+[eE][+-]?\\d+"), numberFormat});  // 科学计数法
 
     // 布尔值和null（紫色）
     keywordFormat.setForeground(QColor(128, 0, 128));
-    highlightingRules.append({QRegularExpression("\\btrue\\b"), keywordFormat});
-    highlightingRules.append({QRegularExpression("\\bfalse\\b"), keywordFormat});
-    highlightingRules.append({QRegularExpression("\\bnull\\b"), keywordFormat});
+    grammar->highlightingRules.append({QRegularExpression("\\btrue\\b"), keywordFormat});
+    grammar->highlightingRules.append({QRegularExpression("\\bfalse\\b"), keywordFormat});
+    grammar->highlightingRules.append({QRegularExpression("\\bnull\\b"), keywordFormat});
 
     // 分隔符格式（灰色）
     jsonSeparatorFormat.setForeground(Qt::gray);
-    highlightingRules.append({QRegularExpression("[\\{\\}\\[\\],:]"), jsonSeparatorFormat});
+    grammar->highlightingRules.append({QRegularExpression("[\\{\\}\\[\\],:]"), jsonSeparatorFormat});
 
     // JSON无注释，禁用多行注释处理
-    commentStartExpression = QRegularExpression("");
-    commentEndExpression = QRegularExpression("");
+    grammar->commentStartExpression = QRegularExpression("");
+    grammar->commentEndExpression = QRegularExpression("");
 }
 
 // 基于文件扩展名或内容识别语言类型
@@ -5,6 +5,10 @@
 #include <QTextCharFormat>
 #include <QRegularExpression>
 #include <QStringList>
+#include <QSharedPointer>
+#include <QTextLayout>
+#include <QTextCursor>
+#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 class QTextDocument;
@@ -17,6 +21,13 @@ enum LanguageType {
     JSON
 };
 
+// 一行的高亮结果，用于缓存（见 TokenCache）
+struct BlockTokens {
+    int state;    // 多行注释状态，即该行的 userState
+    int length;   // 行的长度，用来确认缓存与文本对应
+    QVector<QTextLayout::FormatRange> formats;
+};
+
 class Highlighter : public QSyntaxHighlighter
 {
     Q_OBJECT
@@ -24,12 +35,31 @@ class Highlighter : public QSyntaxHighlighter
 public:
     Highlighter(QTextDocument *parent = nullptr, LanguageType lang = Cpp);
 
+    LanguageType language() const;
+    void setLanguage(LanguageType lang);
+
     // 根据文件名或内容自动检测语言类型
     static LanguageType detectLanguage(const QString &fileName, const QString &content = "");
 
+    // 整篇载入文本前后调用：载入时只按 cached 着色（没有缓存的行暂不着色），
+    // 词法分析随后从文档开头起在后台分段补上，每段只占用几毫秒
+    void deferLexing(const QVector<BlockTokens> &cached);
+    // 后台词法分析还没有完成
+    bool isLexingDeferred() const;
+
+    // 批量编辑（全部替换）期间不跟随文档变化：一个编辑块结束时文档只报告一个
+    // 从第一处到最后一处改动的区间，照常处理会重新分析中间所有的行。
+    // resume 后只重新分析 touched 中的行，状态改变时照常向后连锁
+    void suspend();
+    void resume(const QVector<QTextBlock> &touched);
+
 protected:
     void highlightBlock(const QString &text) override;
 
+private slots:
+    void lexNextChunk();
+    void shiftCachedTokens(int position, int removed, int added);
+
 private:
     // 高亮规则结构体
     struct HighlightingRule {
@@ -37,27 +67,32 @@ private:
         QTextCharFormat format;      // 格式（颜色、字体等）
     };
 
-    QVector<HighlightingRule> highlightingRules;  // 规则列表
+    // 一种语言编译好的规则集，所有文档共用
+    struct Grammar {
+        QVector<HighlightingRule> highlightingRules;  // 规则列表
+        // 多行注释相关
+        QRegularExpression commentStartExpression;
+        QRegularExpression commentEndExpression;
+        QTextCharFormat multiLineCommentFormat;
+    };
 
-    // 多行注释相关
-    QRegularExpression commentStartExpression;
-    QRegularExpression commentEndExpression;
-    QTextCharFormat multiLineCommentFormat;
+    static QSharedPointer<const Grammar> grammarFor(LanguageType lang);
+    // 初始化指定语言的规则
+    static void initCppRules(Grammar *grammar);
+    static void initPythonRules(Grammar *grammar);
+    static void initJsonRules(Grammar *grammar);
 
-    // 不同语言的格式定义
-    QTextCharFormat keywordFormat;       // 关键字
-    QTextCharFormat classFormat;         // 类名
-    QTextCharFormat singleLineCommentFormat;  // 单行注释
-    QTextCharFormat quotationFormat;     // 字符串/引号内容
-    QTextCharFormat functionFormat;      // 函数名
-    QTextCharFormat numberFormat;        // 数字（JSON/Python）
-    QTextCharFormat jsonKeyFormat;       // JSON键
-    QTextCharFormat jsonSeparatorFormat; // JSON分隔符
+    void applyCachedTokens(const QString &text);
 
-    // 初始化指定语言的规则
-    void initCppRules();
-    void initPythonRules();
-    void initJsonRules();
+    LanguageType lang;
+    QSharedPointer<const Grammar> grammar;   // 第一次高亮非空行时取得
+    //---------后台词法分析------------
+    bool deferred;
+    QTextCursor frontier;             // 此处之后的行尚未分析；随编辑移动
+    int cacheRevision;                // 最近一次内容变化后的文档版本，-1 表示还在载入
+    int cachedLineCount;              // 同一时刻的行数，用来算出编辑增减的行
+    QVector<BlockTokens> cachedBlocks;
+    QTimer lexTimer;
 };
 
 #endif // HIGHLIGHTER_H
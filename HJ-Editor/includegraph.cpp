@@ -0,0 +1,151 @@
+#include "includegraph.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <algorithm>
+
+namespace {
+
+const qint64 MaxScannedFileSize = 4 << 20;   // 更大的文件不会是手写的源文件，不找其中的 #include
+
+} // namespace
+
+QStringList IncludeGraph::searchPathsOf(const QStringList &flags, const QString &root)
+{
+    QStringList paths;
+    for (int i = 0; i < flags.size(); ++i) {
+        QString path;
+        if (flags.at(i) == QLatin1String("-I") && i + 1 < flags.size())
+            path = flags.at(++i);
+        else if (flags.at(i).startsWith(QLatin1String("-I")))
+            path = flags.at(i).mid(2);
+        if (!path.isEmpty())
+            paths.append(QDir::cleanPath(QDir(root).absoluteFilePath(path)));
+    }
+    return paths;
+}
+
+void IncludeGraph::setSearchPaths(const QStringList &paths)
+{
+    if (paths == searchPaths)
+        return;
+    searchPaths = paths;
+    resolved.clear();
+}
+
+void IncludeGraph::startPass()
+{
+    checked.clear();
+    resolved.clear();
+}
+
+void IncludeGraph::clear()
+{
+    nodes.clear();
+    startPass();
+}
+
+QStringList IncludeGraph::closure(const QString &file)
+{
+    QSet<QString> seen;
+    QStringList stack;
+    QStringList result;
+    stack.append(file);
+    while (!stack.isEmpty()) {
+        QString current = stack.takeLast();
+        if (seen.contains(current))
+            continue;
+        seen.insert(current);
+        result.append(current);
+        const Node node = refresh(current);
+        const QString directory = QFileInfo(current).absolutePath();
+        for (const Include &include : node.includes) {
+            QString target = resolve(include, directory);
+            if (!target.isEmpty() && !seen.contains(target))
+                stack.append(target);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+QByteArray IncludeGraph::signature(const QString &file)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QString &path : closure(file)) {
+        const Node node = refresh(path);
+        hash.addData(path.toUtf8());
+        hash.addData(reinterpret_cast<const char *>(&node.size), sizeof(node.size));
+        hash.addData(reinterpret_cast<const char *>(&node.modified), sizeof(node.modified));
+    }
+    return hash.result();
+}
+
+IncludeGraph::Node IncludeGraph::refresh(const QString &file)
+{
+    auto it = nodes.constFind(file);
+    if (it != nodes.constEnd() && checked.contains(file))
+        return it.value();
+    checked.insert(file);
+
+    QFileInfo info(file);
+    Node node;
+    node.exists = info.exists();
+    node.size = node.exists ? info.size() : -1;
+    node.modified = node.exists ? info.lastModified().toMSecsSinceEpoch() : 0;
+    // 大小与修改时间都没变，沿用上次扫描的结果
+    if (it != nodes.constEnd() && it->exists == node.exists && it->size == node.size && it->modified == node.modified)
+        return it.value();
+    if (node.exists)
+        node.includes = scan(file);
+    nodes.insert(file, node);
+    return node;
+}
+
+QVector<IncludeGraph::Include> IncludeGraph::scan(const QString &file)
+{
+    static const QRegularExpression directive(QStringLiteral("^[ \\t]*#[ \\t]*include[ \\t]*([<\"])([^>\"\\n]+)[>\"]"),
+                                              QRegularExpression::MultilineOption);
+    QVector<Include> includes;
+    QFile in(file);
+    if (in.size() > MaxScannedFileSize || !in.open(QIODevice::ReadOnly))
+        return includes;
+    const QString text = QString::fromLocal8Bit(in.readAll());
+    QRegularExpressionMatchIterator matches = directive.globalMatch(text);
+    while (matches.hasNext()) {
+        QRegularExpressionMatch match = matches.next();
+        Include include;
+        include.name = match.captured(2).trimmed();
+        include.quoted = match.capturedRef(1) == QLatin1String("\"");
+        includes.append(include);
+    }
+    return includes;
+}
+
+// "..." 先找所在目录再找 -I 目录，<...> 只找 -I 目录；找不到的视为系统头文件
+QString IncludeGraph::resolve(const Include &include, const QString &directory)
+{
+    QString key = (include.quoted ? directory : QString()) + QLatin1Char('\0') + include.name;
+    auto it = resolved.constFind(key);
+    if (it != resolved.constEnd())
+        return it.value();
+
+    QString result;
+    if (include.quoted) {
+        QFileInfo local(QDir(directory).filePath(include.name));
+        if (local.isFile())
+            result = local.absoluteFilePath();
+    }
+    for (int i = 0; result.isEmpty() && i < searchPaths.size(); ++i) {
+        QFileInfo candidate(QDir(searchPaths.at(i)).filePath(include.name));
+        if (candidate.isFile())
+            result = candidate.absoluteFilePath();
+    }
+    if (!result.isEmpty())
+        result = QDir::cleanPath(result);
+    resolved.insert(key, result);
+    return result;
+}
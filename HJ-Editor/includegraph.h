@@ -0,0 +1,51 @@
+#ifndef INCLUDEGRAPH_H
+#define INCLUDEGRAPH_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+// 项目内的 #include 依赖图。每个文件记录大小、修改时间以及它引入的项目内文件；
+// 查询时只重新扫描大小或修改时间变化了的文件，其余沿用上次的结果。
+// 找不到的头文件（系统头文件等）不记录，它们的变化由编译器版本与选项覆盖。
+// 不是线程安全的，由项目构建线程独占使用。
+class IncludeGraph
+{
+public:
+    // -I 指定的目录，用于解析 <...> 与找不到的 "..."
+    void setSearchPaths(const QStringList &paths);
+    // 编译选项中的 -I 目录，相对路径按 root 解析
+    static QStringList searchPathsOf(const QStringList &flags, const QString &root);
+    // 开始一次新的构建；此后每个文件只检查一次是否变化
+    void startPass();
+    // file 及其直接、间接引入的全部项目内文件（已排序，含 file 自身）
+    QStringList closure(const QString &file);
+    // closure 中全部文件的路径、大小与修改时间的哈希，任何一个文件变化都会改变它
+    QByteArray signature(const QString &file);
+    void clear();
+
+private:
+    struct Include {
+        QString name;
+        bool quoted;
+    };
+    struct Node {
+        qint64 size;
+        qint64 modified;
+        bool exists;
+        QVector<Include> includes;   // 原样保存，每次构建重新解析（新建的头文件可能改变解析结果）
+    };
+    Node refresh(const QString &file);
+    static QVector<Include> scan(const QString &file);
+    QString resolve(const Include &include, const QString &directory);
+
+    QStringList searchPaths;
+    QHash<QString, Node> nodes;
+    QSet<QString> checked;              // 本次构建中已经检查过的文件
+    QHash<QString, QString> resolved;   // 本次构建中的解析结果
+};
+
+#endif // INCLUDEGRAPH_H
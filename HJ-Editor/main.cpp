@@ -1,11 +1,30 @@
 #include "mainwindow.h"
+#include "console.h"
+#include "runprofiler.h"
+#include "startupprofiler.h"
 #include <QApplication>
+#include <cstdlib>
 
 int main(int argc, char *argv[])
 {
+  // 性能分析运行时作为包装进程启动，不创建任何界面
+  if (argc > 1 && qstrcmp(argv[1], RunProfiler::WrapperOption) == 0)
+    return RunProfiler::runWrapper(argc, argv);
+  // --startup-profile：第一次绘制后报告启动时间线
+  StartupProfiler::start(argc, argv);
   QApplication a(argc, argv);
+  a.setOrganizationName("HJ");
+  a.setApplicationName("HJ-Editor");
+  StartupProfiler::mark("创建 QApplication");
+  // --console-benchmark [MB]：只测输出区的吞吐量
+  for (int i = 1; i < argc; ++i) {
+    if (qstrcmp(argv[i], Console::BenchmarkOption) == 0)
+      return Console::runBenchmark(i + 1 < argc ? atoi(argv[i + 1]) : 64);
+  }
   MainWindow w;
+  StartupProfiler::mark("构造主窗口");
   w.show();
+  StartupProfiler::mark("显示主窗口");
 
   return a.exec();
 }
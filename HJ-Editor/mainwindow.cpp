@@ -1,24 +1,50 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include <QDebug>
+#include "benchmarkdialog.h"
+#include "runconfigurationdialog.h"
+#include "runlimitsdialog.h"
+#include "startupprofiler.h"
 #include <QFileDialog>
 #include <QFile>
 #include <QTextStream>
+#include <QFileInfo>
+#include <QTimer>
+#include <QSettings>
+#include <QCryptographicHash>
+#include <QDockWidget>
+#include <QDir>
+#include <QTextBlock>
+#include <QTabBar>
+#include <QScrollBar>
+#include <QComboBox>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
-    firstLoad = true;
     ui->setupUi(this);
-    setUpHighlighter();
+    setUpEditor();
+    StartupProfiler::mark("setupUi：创建界面");
     //init status bar
     ui->outputText->parentWindow = this;
     ui->statusBar->showMessage(tr("Ready"));
     //--------init toolbar------------
     //ui->statusBar->setStyleSheet("QStatusBar{background:rgb(50,50,50);}");
     ui->mainToolBar->setMovable(false);
-    ui->mainToolBar->setStyleSheet("QToolButton:hover {background-color:darkgray} QToolBar {background: rgb(82,82,82);border: none;}");
+    // 工具栏样式表由主题设置，这里不再先解析一份随即被替换的
+    // 运行配置：切换后语法检查与下一次运行都使用新配置的选项
+    configurationBox = new QComboBox(this);
+    configurationBox->setSizeAdjustPolicy(QComboBox::AdjustToContents);
+    configurationBox->setToolTip(tr("运行配置"));
+    ui->mainToolBar->addSeparator();
+    ui->mainToolBar->addWidget(configurationBox);
+    reloadConfigurations();
+    connect(configurationBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [this](int index) {
+        if (index < 0)
+            return;
+        RunConfiguration::setCurrentId(configurationBox->itemData(index).toString());
+        syntaxTimer.start();
+    });
     //--------------------------------
 
     runIcon.addPixmap(QPixmap(":/image/Run.png"));
@@ -26,41 +52,139 @@ MainWindow::MainWindow(QWidget *parent) :
 
     //---------窗口背景颜色-------------
     applyLightTheme();  // 默认应用明亮主题
+    StartupProfiler::mark("工具栏、图标与主题");
 
     // 连接菜单项
     connect(ui->actionDarkTheme, &QAction::triggered, this, &MainWindow::applyDarkTheme);
     connect(ui->actionLightTheme, &QAction::triggered, this, &MainWindow::applyLightTheme);
 
     // 添加查找/替换菜单项
-    ui->menuEdit->addAction("查找/替换", this, &MainWindow::openFindReplaceDialog);
+    ui->menuEdit->addAction(tr("查找/替换"), this, &MainWindow::openFindReplaceDialog);
+    ui->menuEdit->addAction(tr("在文件中查找..."), this, &MainWindow::openFindInFiles, QKeySequence(tr("Ctrl+Shift+F")));
+    ui->menuEdit->addAction(tr("转到文件..."), this, &MainWindow::openGoToFile, QKeySequence(tr("Ctrl+P")));
+    findInFilesDock = nullptr;
+    findInFilesPanel = nullptr;
+    projectIndex = nullptr;
+    goToFileDialog = nullptr;
 
     //--------------------------------
     initFileData();
     connect(ui->actionNewFile, SIGNAL(triggered(bool)), this, SLOT(newFile()));
     connect(ui->actionOpen, SIGNAL(triggered(bool)), this, SLOT(openFile()));
     connect(ui->actionSave_File, SIGNAL(triggered(bool)), this, SLOT(saveFile()));
+    connect(ui->actionSave_As, SIGNAL(triggered(bool)), this, SLOT(saveFileAs()));
     connect(ui->actionUndo, SIGNAL(triggered(bool)), this, SLOT(undo()));
     connect(ui->actionRedo, SIGNAL(triggered(bool)), this, SLOT(redo()));
-    connect(ui->editor, SIGNAL(textChanged()), this, SLOT(changeSaveState()));
     connect(ui->actionRun, SIGNAL(triggered(bool)), this, SLOT(run()));
+    builder = new Builder(this);
+    connect(builder, &Builder::finished, this, &MainWindow::buildFinished);
+    ui->actionProjectMode->setChecked(QSettings().value(QStringLiteral("build/projectMode"), false).toBool());
+    connect(ui->actionProjectMode, &QAction::toggled, this, [](bool checked) {
+        QSettings().setValue(QStringLiteral("build/projectMode"), checked);
+    });
+    // 输入时在后台检查语法，结果与编译诊断一样标在编辑器中
+    syntaxChecker = new SyntaxChecker(this);
+    connect(syntaxChecker, &SyntaxChecker::checked, this, &MainWindow::syntaxChecked);
+    syntaxTimer.setSingleShot(true);
+    syntaxTimer.setInterval(300);
+    connect(&syntaxTimer, &QTimer::timeout, this, &MainWindow::checkSyntax);
+    connect(ui->editor, &QPlainTextEdit::textChanged, &syntaxTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    runMode = NormalRun;
+    profileDock = nullptr;
+    profilePanel = nullptr;
+    QAction *profileAction = ui->menuRun->addAction(tr("性能分析运行"), this, &MainWindow::runWithProfiling, QKeySequence(tr("Ctrl+Shift+R")));
+    profileAction->setEnabled(RunProfiler::isSupported());
+    benchmark = new Benchmark(this);
+    connect(benchmark, &Benchmark::finished, this, &MainWindow::benchmarkFinished);
+    connect(benchmark, &Benchmark::progress, this, [this](int done, int total) {
+        if (benchmark->isRunning())
+            ui->statusBar->showMessage(tr("基准测试中... %1/%2").arg(done).arg(total));
+    });
+    ui->menuRun->addAction(tr("基准测试运行"), this, &MainWindow::runBenchmark, QKeySequence(tr("Ctrl+Shift+B")));
+    ui->menuRun->addAction(tr("基准测试设置..."), this, &MainWindow::configureBenchmark);
+    ui->menuRun->addAction(tr("比较所有运行配置"), this, &MainWindow::compareConfigurations);
+    ui->menuRun->addAction(tr("编辑运行配置..."), this, &MainWindow::editRunConfigurations);
+    ui->menuRun->addAction(tr("运行限制..."), this, &MainWindow::configureLimits);
+    ui->menuRun->addAction(tr("测试用例..."), this, &MainWindow::showTests);
+    ui->menuRun->addAction(tr("运行测试用例"), this, &MainWindow::runTests, QKeySequence(tr("Ctrl+Shift+T")));
+    testDock = nullptr;
+    testPanel = nullptr;
+    ui->menuRun->addSeparator();
+    ui->menuRun->addAction(tr("下一个问题"), this, [this] { gotoDiagnostic(true); }, QKeySequence(tr("F8")));
+    ui->menuRun->addAction(tr("上一个问题"), this, [this] { gotoDiagnostic(false); }, QKeySequence(tr("Shift+F8")));
+    pythonRunner = new PythonRunner(this);
+    connect(pythonRunner, &PythonRunner::standardOutput, this, [this](const QByteArray &data) {
+        ui->outputText->appendOutput(Console::StandardOutput, outputDecoder.decode(data), data.size());
+    });
+    connect(pythonRunner, &PythonRunner::standardError, this, [this](const QByteArray &data) {
+        ui->outputText->appendOutput(Console::StandardError, errorDecoder.decode(data), data.size());
+    });
+    connect(pythonRunner, &PythonRunner::finished, this, &MainWindow::pythonFinished);
     connect(&process, SIGNAL(finished(int)), this, SLOT(runFinished(int)));
     connect(&process, SIGNAL(readyReadStandardOutput()), this, SLOT(updateOutput()));
     connect(&process, SIGNAL(readyReadStandardError()), this, SLOT(updateError()));
     connect(ui->actionAbout, SIGNAL(triggered(bool)), this, SLOT(about()));
-    fileSaved = true;
+    StartupProfiler::mark("构建、运行与测试");
 
-    findReplaceDialog = new FindReplaceDialog(this);
-    connect(findReplaceDialog, &FindReplaceDialog::find, this, &MainWindow::findText);
-    connect(findReplaceDialog, &FindReplaceDialog::replace, this, &MainWindow::replaceText);
-    connect(findReplaceDialog, &FindReplaceDialog::replaceAll, this, &MainWindow::replaceAllText);
+    fileSaver = new FileSaver(this);
+    connect(fileSaver, &FileSaver::saved, this, &MainWindow::fileWritten);
+    connect(fileSaver, &FileSaver::failed, this, &MainWindow::fileWriteFailed);
+
+    // 上次的文件在进入事件循环后再重新打开，不拖慢主窗口的构造；随后检查编辑日志，
+    // 日志对应的文件若已重新打开，恢复的内容放进同一个标签页
+    QTimer::singleShot(0, this, &MainWindow::restoreSession);
+    // 编辑日志：每个标签页自动保存增量，启动时检查上次异常退出留下的日志
+    QTimer::singleShot(0, this, &MainWindow::recoverJournals);
+
+    // 查找/替换对话框在第一次打开时才创建
+    findReplaceDialog = nullptr;
+
+    findEngine = new FindEngine(this);
+    pendingSelectFrom = -1;
+    findTimer.setSingleShot(true);
+    findTimer.setInterval(120);
+    connect(&findTimer, &QTimer::timeout, this, &MainWindow::findTypedQuery);
+    currentMatch = -1;
+    connect(findEngine, &FindEngine::matchesFound, this, &MainWindow::searchMatchesFound);
+    connect(findEngine, &FindEngine::finished, this, &MainWindow::searchFinished);
+    connect(findEngine, &FindEngine::matchesChanged, this, &MainWindow::searchMatchesChanged);
+    connect(findEngine, &FindEngine::invalidQuery, this, [this](const QString &errorString) {
+        showMatchInfo(tr("正则表达式错误：") + errorString);
+    });
+
+    // 标签页共用一个编辑器，切换时只更换文档
+    tabBar = new QTabBar(this);
+    tabBar->setTabsClosable(true);
+    tabBar->setMovable(true);
+    tabBar->setDocumentMode(true);
+    tabBar->setExpanding(false);
+    tabBar->setUsesScrollButtons(true);
+    ui->centralLayout->insertWidget(0, tabBar);
+    current = nullptr;
+    connect(tabBar, &QTabBar::currentChanged, this, &MainWindow::activateTab);
+    connect(tabBar, &QTabBar::tabCloseRequested, this, &MainWindow::closeTab);
+    connect(tabBar, &QTabBar::tabMoved, this, [this](int from, int to) { tabs.move(from, to); });
+    newTab();
+    StartupProfiler::mark("查找引擎与标签页");
+
+    // 启动计时：第一次绘制完成后把时间线显示在输出区
+    connect(StartupProfiler::instance(), &StartupProfiler::reported, this, [this](const QString &report, qint64 total) {
+        ui->outputText->appendOutput(Console::CompilerOutput, report);
+        ui->outputText->flushOutput();
+        ui->statusBar->showMessage(tr("启动用时 %1 ms").arg(total));
+    });
+    StartupProfiler::watchFirstPaint(ui->editor->viewport());
 }
 
 MainWindow::~MainWindow()
 {
+    // 先断开通知再等待写盘完成，避免回调访问已销毁的界面
+    fileSaver->disconnect(this);
+    fileSaver->waitForFinished();
     delete ui;
 }
 
-void MainWindow::setUpHighlighter()
+void MainWindow::setUpEditor()
 {
     QFont font;
     font.setFamily("Courier");
@@ -68,22 +192,150 @@ void MainWindow::setUpHighlighter()
     //font.setPointSize(20);
     ui->editor->setFont(font);
     ui->editor->setTabStopWidth(fontMetrics().width(QLatin1Char('9')) * 4);
-    highlighter = new Highlighter(ui->editor->document());
 }
 
-void MainWindow::resizeEvent(QResizeEvent *event)
+void MainWindow::initFileData()
 {
-    QMainWindow::resizeEvent(event);
-    ui->editor->setGeometry(10, 0, width() - 20, height() - ui->statusBar->height() - ui->mainToolBar->height() - 80 - 15);
-    ui->outputText->setGeometry(10, ui->editor->height() + 10, this->width() - 20, 80);
+    isRunning = false;
 }
 
-void MainWindow::initFileData()
+EditorTab *MainWindow::newTab()
 {
-    fileName = tr("Untitled.cpp");
-    filePath = tr("~/Desktop/Untitled.cpp");
-    fileSaved = true;
-    isRunning = false;
+    EditorTab *tab = new EditorTab(this);
+    connect(tab, &EditorTab::saveStateChanged, this, &MainWindow::tabSaveStateChanged);
+    tabs.append(tab);
+    recentTabs.append(tab);
+    int index = tabBar->addTab(tab->fileName);  // 第一个标签页会在这里激活
+    updateTabTitle(tab);
+    tabBar->setCurrentIndex(index);
+    return tab;
+}
+
+int MainWindow::tabIndexOf(const QString &path) const
+{
+    QFileInfo info(path);
+    for (int i = 0; i < tabs.size(); ++i) {
+        if (tabs.at(i)->filePathKnown && QFileInfo(tabs.at(i)->filePath) == info)
+            return i;
+    }
+    return -1;
+}
+
+void MainWindow::activateTab(int index)
+{
+    if (index < 0 || index >= tabs.size())
+        return;
+    EditorTab *tab = tabs.at(index);
+    if (tab == current)  // 移除前面的标签页时序号变化，也会发出 currentChanged
+        return;
+    if (current) {
+        current->cursorPosition = ui->editor->textCursor().position();
+        current->scrollPosition = ui->editor->verticalScrollBar()->value();
+    }
+    current = tab;
+
+    // 休眠的标签页在这里重建文档；查找引擎要先于编辑器切换，旧文档可能随后被释放
+    QTextDocument *document = tab->document();
+    bool hadQuery = findEngine->hasQuery();
+    FindQuery query = findEngine->query();
+    findEngine->setDocument(document);
+    ui->editor->showDocument(document, tab->undoHistory());
+    QTextCursor cursor(document);
+    cursor.setPosition(qMin(tab->cursorPosition, document->characterCount() - 1));
+    ui->editor->setTextCursor(cursor);
+    ui->editor->verticalScrollBar()->setValue(tab->scrollPosition);
+    showDiagnostics();
+
+    currentMatch = -1;
+    pendingSelectFrom = -1;
+    showMatchInfo(QString());
+    if (hadQuery)
+        findEngine->search(query);
+
+    recentTabs.removeOne(tab);
+    recentTabs.prepend(tab);
+    hibernateIdleTabs();
+    updateTabTitle(tab);
+    if (testPanel)
+        testPanel->setSource(tab->filePathKnown ? tab->filePath : QString());
+    // 切换到 Python 文件时就启动解释器，第一次运行也不必等待
+    if (tab->language() == Python)
+        pythonRunner->warmUp();
+}
+
+// 最近用过的若干个标签页保留文档，其余已保存的标签页休眠
+void MainWindow::hibernateIdleTabs()
+{
+    int live = QSettings().value(QStringLiteral("workspace/liveTabs"), 8).toInt();
+    int materialized = 0;
+    for (EditorTab *tab : recentTabs) {
+        if (tab->isHibernated())
+            continue;
+        if (++materialized > live && tab != current)
+            tab->hibernate();
+    }
+}
+
+void MainWindow::updateTabTitle(EditorTab *tab)
+{
+    int index = tabs.indexOf(tab);
+    if (index < 0)
+        return;
+    QString title = tab->fileName + (tab->isSaved() ? QString() : tr("*"));
+    tabBar->setTabText(index, title);
+    tabBar->setTabToolTip(index, tab->filePathKnown ? tab->filePath : tab->fileName);
+    if (tab == current)
+        this->setWindowTitle(tr("HJ Editor - ") + title);
+}
+
+void MainWindow::tabSaveStateChanged()
+{
+    updateTabTitle(qobject_cast<EditorTab *>(sender()));
+}
+
+// 未保存时询问是否保存，返回 false 表示用户取消
+bool MainWindow::confirmSave(EditorTab *tab, const QString &title, const QString &text)
+{
+    if (tab->isSaved())
+        return true;
+    tabBar->setCurrentIndex(tabs.indexOf(tab));
+    QMessageBox::StandardButton button = QMessageBox::question(this, title, text, QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
+    if (button == QMessageBox::Cancel)
+        return false;
+    if (button == QMessageBox::Save) {
+        saveFile();
+        fileSaver->waitForFinished();
+        QCoreApplication::processEvents();  // 处理保存完成的通知
+        return tab->isSaved();
+    }
+    return true;
+}
+
+bool MainWindow::closeTab(int index)
+{
+    if (index < 0 || index >= tabs.size())
+        return false;
+    EditorTab *tab = tabs.at(index);
+    if (!confirmSave(tab, tr("文件未保存"), tab->fileName + tr(" 没有保存，是否保存？")))
+        return false;
+    tab->persistHistory();
+    tab->saveHighlighting();
+    if (!tab->isHibernated())
+        tab->journal()->discard();
+
+    // 编辑器必须先切换到别的文档，才能释放这个标签页的文档
+    if (tabs.size() == 1)
+        newTab();
+    if (tab == current) {
+        int next = index + 1 < tabs.size() ? index + 1 : index - 1;
+        tabBar->setCurrentIndex(next);
+    }
+    index = tabs.indexOf(tab);
+    tabs.removeAt(index);
+    recentTabs.removeOne(tab);
+    tabBar->removeTab(index);
+    delete tab;
+    return true;
 }
 
 void MainWindow::undo()
@@ -98,114 +350,862 @@ void MainWindow::redo()
 
 void MainWindow::saveFile()
 {
-    QString savePath = QFileDialog::getSaveFileName(this, tr("选择保存路径与文件名"), fileName, tr("Cpp File(*.cpp *.c *.h)"));
+    // 已有保存路径时直接保存，不再弹出对话框
+    if (!current->filePathKnown) {
+        saveFileAs();
+        return;
+    }
+    writeFile(current->filePath);
+}
+
+void MainWindow::saveFileAs()
+{
+    QString savePath = QFileDialog::getSaveFileName(this, tr("选择保存路径与文件名"), current->fileName, tr("Cpp File(*.cpp *.c *.h)"));
     if (!savePath.isEmpty()) {
-        QFile out(savePath);
-        out.open(QIODevice::WriteOnly | QIODevice::Text);
-        QTextStream str(&out);
-        str << ui->editor->toPlainText();
-        out.close();
-        fileSaved = true;
-        QRegularExpression re(tr("(?<=\\/)\\w+\\.cpp|(?<=\\/)\\w+\\.c|(?<=\\/)\\w+\\.h"));
-        fileName = re.match(savePath).captured();
-        filePath = savePath;
-        this->setWindowTitle(tr("HJ Editor - ") + fileName);
+        current->fileName = QFileInfo(savePath).fileName();
+        current->filePath = savePath;
+        current->filePathKnown = true;
+        updateTabTitle(current);
+        writeFile(savePath);
+    }
+}
+
+// 在 GUI 线程只取文本快照，编码与写盘都交给后台线程
+void MainWindow::writeFile(const QString &path)
+{
+    ui->statusBar->showMessage(tr("正在保存..."));
+    fileSaver->save(path, ui->editor->toPlainText(), ui->editor->document()->revision());
+}
+
+void MainWindow::fileWritten(const QString &path, int revision, const QByteArray &hash)
+{
+    if (projectIndex)
+        projectIndex->markDirty(path);
+    int index = tabIndexOf(path);
+    if (index < 0)
+        return;
+    EditorTab *tab = tabs.at(index);
+    if (tab->isHibernated()) {
+        tab->contentHash = hash;
+        ui->statusBar->showMessage(tr("已保存 ") + path, 2000);
+        return;
+    }
+    // 保存期间若又有编辑，文件仍处于未保存状态（未保存的标签页不会休眠）
+    if (revision == tab->document()->revision()) {
+        tab->contentHash = hash;
+        tab->setSaved(true);
+        tab->journal()->reset(path);
+        warmUpBuild(tab);
+    } else {
+        // 日志中的增量是相对旧基准的，重新写一个检查点
+        tab->journal()->checkpoint();
+    }
+    ui->statusBar->showMessage(tr("已保存 ") + path, 2000);
+}
+
+void MainWindow::fileWriteFailed(const QString &path, const QString &errorString)
+{
+    ui->statusBar->showMessage(tr("Ready"));
+    QMessageBox::warning(this, tr("保存失败"), tr("无法保存文件 ") + path + tr("：\n") + errorString, QMessageBox::Ok);
+}
+
+void MainWindow::recoverJournals()
+{
+    foreach (const QString &pending, EditJournal::pendingJournals()) {
+        QString basePath;
+        QString text;
+        if (!EditJournal::replay(pending, &basePath, &text)) {
+            EditJournal::remove(pending);
+            continue;
+        }
+        QString name = basePath.isEmpty() ? tr("未命名文件") : basePath;
+        if (QMessageBox::Yes == QMessageBox::question(this, tr("恢复未保存的内容"), tr("检测到上次异常退出时未保存的内容：\n") + name + tr("\n是否恢复？"), QMessageBox::Yes, QMessageBox::No))
+            restoreBuffer(basePath, text);
+        EditJournal::remove(pending);
     }
 }
 
+void MainWindow::restoreBuffer(const QString &basePath, const QString &text)
+{
+    bool blank = !current->filePathKnown && current->isSaved() && current->document()->isEmpty();
+    int existing = basePath.isEmpty() ? -1 : tabIndexOf(basePath);
+    if (existing >= 0)
+        tabBar->setCurrentIndex(existing);
+    EditorTab *tab = existing >= 0 ? tabs.at(existing) : blank ? current : newTab();
+    tab->contentHash.clear();  // 恢复的内容与磁盘上的不同，不能套用按内容缓存的高亮
+    if (!basePath.isEmpty()) {
+        tab->filePath = basePath;
+        tab->fileName = QFileInfo(basePath).fileName();
+        tab->filePathKnown = true;
+        tab->setLanguage(Highlighter::detectLanguage(tab->fileName, text.left(4096)));
+    }
+    tab->loadText(text);
+    tab->setSaved(false);
+    updateTabTitle(tab);
+    // 恢复出的内容立即写入新日志，避免再次崩溃时丢失
+    tab->journal()->reset(basePath);
+    tab->journal()->checkpoint();
+}
+
 void MainWindow::newFile()
 {
-    MainWindow *newWindow = new MainWindow();
-    QRect newPos = this->geometry();
-    newWindow->setGeometry(newPos.x() + 10, newPos.y() + 10, newPos.width(), newPos.height());
-    newWindow->show();
+    newTab();
 }
 
 void MainWindow::openFile()
 {
-    if (!fileSaved) {
-        if (QMessageBox::Save == QMessageBox::question(this, tr("文件未保存"), tr("当前文件没有保存，是否保存？"), QMessageBox::Save, QMessageBox::Cancel))
-            saveFile();
+    QString openPath = QFileDialog::getOpenFileName(this, tr("选择要打开的文件"), current->filePath, tr("Cpp File(*.cpp *.c *.h)"));
+    if (!openPath.isEmpty())
+        loadFile(openPath);
+}
+
+// 在新标签页中打开文件；已经打开时切换过去，当前是空白的未命名标签页时直接使用它
+bool MainWindow::loadFile(const QString &openPath)
+{
+    int existing = tabIndexOf(openPath);
+    if (existing >= 0) {
+        tabBar->setCurrentIndex(existing);
+        return true;
+    }
+    QFile in(openPath);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, tr("打开失败"), in.errorString());
+        return false;
     }
-    QString openPath = QFileDialog::getOpenFileName(this, tr("选择要打开的文件"), filePath, tr("Cpp File(*.cpp *.c *.h)"));
-    if (!openPath.isEmpty()) {
-        QFile in(openPath);
-        in.open(QIODevice::ReadOnly | QIODevice::Text);
-        QTextStream str(&in);
-        ui->editor->setPlainText(str.readAll());
-        QRegularExpression re(tr("(?<=\\/)\\w+\\.cpp|(?<=\\/)\\w+\\.c|(?<=\\/)\\w+\\.h"));
-        fileName = re.match(openPath).captured();
-        this->setWindowTitle(tr("HJ Editor - ") + fileName);
-        filePath = openPath;
-        fileSaved = true;
+    QByteArray bytes = in.readAll();
+    QString text = QString::fromLocal8Bit(bytes);
+    bool blank = !current->filePathKnown && current->isSaved() && current->document()->isEmpty();
+    EditorTab *tab = blank ? current : newTab();
+    tab->fileName = QFileInfo(openPath).fileName();
+    tab->filePath = openPath;
+    tab->filePathKnown = true;
+    tab->contentHash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+    tab->setLanguage(Highlighter::detectLanguage(tab->fileName, text.left(4096)));
+    tab->loadText(text);
+    tab->setSaved(true);
+    tab->journal()->reset(openPath);
+    // 文件内容与上次保存时一致，则接着上次的撤销历史
+    if (QSettings().value(QStringLiteral("undo/persist"), true).toBool())
+        tab->undoHistory()->load(openPath, tab->contentHash);
+    updateTabTitle(tab);
+    warmUpBuild(tab);
+    return true;
+}
+
+// 选中第 line 行（从 1 开始）column 列起的 length 个字符
+void MainWindow::jumpTo(int line, int column, int length)
+{
+    QTextBlock block = ui->editor->document()->findBlockByNumber(line - 1);
+    if (!block.isValid())
+        return;
+    int start = block.position() + qMin(column, block.length() - 1);
+    QTextCursor cursor(ui->editor->document());
+    cursor.setPosition(start);
+    cursor.setPosition(qMin(start + length, block.position() + block.length() - 1), QTextCursor::KeepAnchor);
+    ui->editor->setTextCursor(cursor);
+    ui->editor->centerCursor();
+    ui->editor->setFocus();
+}
+
+void MainWindow::openFindInFiles()
+{
+    // 面板在第一次使用时才创建
+    if (!findInFilesDock) {
+        findInFilesPanel = new FindInFilesPanel(this);
+        findInFilesDock = new QDockWidget(tr("在文件中查找"), this);
+        findInFilesDock->setObjectName(QStringLiteral("findInFilesDock"));
+        findInFilesDock->setWidget(findInFilesPanel);
+        addDockWidget(Qt::BottomDockWidgetArea, findInFilesDock);
+        findInFilesPanel->setDirectory(current->filePathKnown ? QFileInfo(current->filePath).absolutePath() : QDir::homePath());
+        findInFilesPanel->setIndex(ensureProjectIndex());
+        connect(findInFilesPanel, &FindInFilesPanel::openRequested, this, &MainWindow::openSearchResult);
     }
+    findInFilesDock->show();
+    findInFilesDock->raise();
+    findInFilesPanel->focusQuery();
+}
+
+// 切换到 path 所在的标签页，没有打开时在新标签页中打开；返回是否已切换成功
+bool MainWindow::switchToFile(const QString &path)
+{
+    return loadFile(path);
+}
+
+void MainWindow::openSearchResult(const QString &path, int line, int column, int length)
+{
+    if (switchToFile(path))
+        jumpTo(line, column, length);
+}
+
+TrigramIndex *MainWindow::ensureProjectIndex()
+{
+    if (!projectIndex) {
+        projectIndex = new TrigramIndex(this);
+        connect(projectIndex, &TrigramIndex::ready, this, [this](int files, qint64 elapsed) {
+            ui->statusBar->showMessage(tr("文件索引已就绪：%1 个文件，用时 %2 ms").arg(files).arg(elapsed), 3000);
+            if (goToFileDialog && goToFileDialog->isVisible())
+                refreshGoToFile();
+        });
+    }
+    return projectIndex;
+}
+
+void MainWindow::openGoToFile()
+{
+    // 项目目录取“在文件中查找”的目录，没有时取当前文件所在目录
+    QString root = findInFilesPanel ? findInFilesPanel->directory()
+                                    : (current->filePathKnown ? QFileInfo(current->filePath).absolutePath() : QString());
+    if (root.isEmpty()) {
+        ui->statusBar->showMessage(tr("请先打开文件或选择查找目录"), 3000);
+        return;
+    }
+    TrigramIndex *index = ensureProjectIndex();
+    if (!index->covers(root))
+        index->open(root);
+    if (!goToFileDialog) {
+        goToFileDialog = new GoToFileDialog(this);
+        connect(goToFileDialog, &GoToFileDialog::fileChosen, this, &MainWindow::switchToFile);
+    }
+    refreshGoToFile();
+    goToFileDialog->show();
+    goToFileDialog->raise();
+    goToFileDialog->activateWindow();
+}
+
+void MainWindow::refreshGoToFile()
+{
+    if (projectIndex->isReady()) {
+        goToFileDialog->setFiles(projectIndex->root(), projectIndex->files());
+    } else {
+        goToFileDialog->setFiles(projectIndex->root(), QStringList());
+        goToFileDialog->setStatus(tr("正在建立文件索引..."));
+    }
+}
+
+// 会话：打开的文件（按标签页顺序）、各自的光标与滚动位置，以及当前标签页
+void MainWindow::saveSession()
+{
+    current->cursorPosition = ui->editor->textCursor().position();
+    current->scrollPosition = ui->editor->verticalScrollBar()->value();
+    QSettings settings;
+    settings.remove(QStringLiteral("session/files"));
+    settings.beginWriteArray(QStringLiteral("session/files"));
+    int index = 0;
+    int currentIndex = -1;
+    for (EditorTab *tab : tabs) {
+        if (!tab->filePathKnown)
+            continue;
+        if (tab == current)
+            currentIndex = index;
+        settings.setArrayIndex(index++);
+        settings.setValue(QStringLiteral("path"), tab->filePath);
+        settings.setValue(QStringLiteral("cursor"), tab->cursorPosition);
+        settings.setValue(QStringLiteral("scroll"), tab->scrollPosition);
+    }
+    settings.endArray();
+    settings.setValue(QStringLiteral("session/current"), currentIndex);
+}
+
+// 重新打开上次的文件，已不存在的跳过。文件依次在当前标签页中载入，
+// 载入后立即还原光标与滚动位置，切走时由 activateTab 记下，切回来时再还原
+void MainWindow::restoreSession()
+{
+    QSettings settings;
+    if (!settings.value(QStringLiteral("session/restore"), true).toBool())
+        return;
+    int count = settings.beginReadArray(QStringLiteral("session/files"));
+    QStringList paths;
+    QVector<int> cursors;
+    QVector<int> scrolls;
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        paths.append(settings.value(QStringLiteral("path")).toString());
+        cursors.append(settings.value(QStringLiteral("cursor"), 0).toInt());
+        scrolls.append(settings.value(QStringLiteral("scroll"), 0).toInt());
+    }
+    settings.endArray();
+    int currentIndex = settings.value(QStringLiteral("session/current"), -1).toInt();
+
+    EditorTab *active = nullptr;
+    for (int i = 0; i < paths.size(); ++i) {
+        if (!QFileInfo(paths.at(i)).isFile() || !loadFile(paths.at(i)))
+            continue;
+        QTextDocument *document = current->document();
+        QTextCursor cursor(document);
+        cursor.setPosition(qBound(0, cursors.at(i), document->characterCount() - 1));
+        ui->editor->setTextCursor(cursor);
+        ui->editor->verticalScrollBar()->setValue(scrolls.at(i));
+        if (i == currentIndex)
+            active = current;
+    }
+    if (active)
+        tabBar->setCurrentIndex(tabs.indexOf(active));
+    StartupProfiler::mark("恢复会话");
 }
 
 void MainWindow::run()
+{
+    startRun(NormalRun);
+}
+
+// 经包装进程运行，结束后在“性能分析”面板中给出 CPU 时间、峰值内存与硬件计数器
+void MainWindow::runWithProfiling()
+{
+    startRun(ProfileRun);
+}
+
+// 按设置重复运行，结果与同一文件上一个版本的结果比较
+void MainWindow::runBenchmark()
+{
+    startRun(BenchmarkRun);
+}
+
+void MainWindow::configureBenchmark()
+{
+    BenchmarkDialog dialog(this);
+    dialog.setOptions(BenchmarkOptions::load());
+    if (dialog.exec() == QDialog::Accepted)
+        dialog.options().save();
+}
+
+void MainWindow::configureLimits()
+{
+    RunLimitsDialog dialog(this);
+    dialog.setLimits(RunLimits::load());
+    if (dialog.exec() == QDialog::Accepted)
+        dialog.limits().save();
+}
+
+// ASan 程序启动时就要保留极大的虚拟地址空间，不能用 RLIMIT_AS 代替内存限制
+bool MainWindow::addressSpaceLimit() const
+{
+    for (const QString &flag : buildRequest(runningSource, runningConfiguration).flags) {
+        if (flag.startsWith(QLatin1String("-fsanitize=")) && flag.contains(QLatin1String("address")))
+            return false;
+    }
+    return true;
+}
+
+void MainWindow::reloadConfigurations()
+{
+    const QString currentId = RunConfiguration::currentId();
+    configurationBox->blockSignals(true);
+    configurationBox->clear();
+    for (const RunConfiguration &configuration : RunConfiguration::all()) {
+        configurationBox->addItem(configuration.name, configuration.id);
+        configurationBox->setItemData(configurationBox->count() - 1, configuration.compilerFlags().join(QLatin1Char(' ')),
+                                      Qt::ToolTipRole);
+    }
+    // 选中的配置被删除时回到 Debug
+    int index = configurationBox->findData(currentId);
+    configurationBox->setCurrentIndex(qMax(0, index));
+    configurationBox->blockSignals(false);
+    if (index < 0)
+        RunConfiguration::setCurrentId(configurationBox->currentData().toString());
+}
+
+void MainWindow::editRunConfigurations()
+{
+    RunConfigurationDialog dialog(this);
+    if (dialog.exec() == QDialog::Accepted) {
+        reloadConfigurations();
+        syntaxTimer.start();
+    }
+}
+
+// 依次以每个运行配置构建同一个文件并做基准测试，最后在输出区列出对比
+void MainWindow::compareConfigurations()
+{
+    if (!isRunning) {
+        comparisonQueue.clear();
+        for (const RunConfiguration &configuration : RunConfiguration::all())
+            comparisonQueue.append(configuration.id);
+        comparedConfigurations.clear();
+    }
+    startRun(CompareRun);
+}
+
+// 构建队列中的下一个配置，队列为空时给出对比结果并结束
+void MainWindow::continueComparison()
+{
+    if (comparisonQueue.isEmpty()) {
+        isRunning = false;
+        ui->actionRun->setIcon(runIcon);
+        reportComparison();
+        return;
+    }
+    runningConfiguration = comparisonQueue.takeFirst();
+    const int total = comparedConfigurations.size() + comparisonQueue.size() + 1;
+    ui->statusBar->showMessage(tr("比较运行配置 %1/%2：正在编译...").arg(comparedConfigurations.size() + 1).arg(total));
+    ui->outputText->beginPhase(tr("编译：%1").arg(RunConfiguration::find(runningConfiguration).name));
+    builder->start(buildRequest(runningSource, runningConfiguration));
+}
+
+// 加速比相对第一个成功的配置；两个中位数的置信区间不重叠时才标为可信
+void MainWindow::reportComparison()
+{
+    const ComparisonEntry *baseline = nullptr;
+    for (const ComparisonEntry &entry : comparedConfigurations) {
+        if (entry.error.isEmpty() && entry.stats.median > 0) {
+            baseline = &entry;
+            break;
+        }
+    }
+    QString report = tr("运行配置对比（中位数 [95% 置信区间]，p95，相对 %1 的加速比）\n")
+                         .arg(baseline ? baseline->name : tr("—"));
+    for (const ComparisonEntry &entry : comparedConfigurations) {
+        report += QStringLiteral("  %1  ").arg(entry.name, -20);
+        if (!entry.error.isEmpty()) {
+            report += entry.error + tr("\n");
+            continue;
+        }
+        const BenchmarkStats &stats = entry.stats;
+        report += tr("%1 ms [%2, %3]  p95 %4 ms").arg(stats.median, 10, 'f', 3)
+                      .arg(stats.medianLow, 0, 'f', 3).arg(stats.medianHigh, 0, 'f', 3).arg(stats.p95, 0, 'f', 3);
+        if (baseline && &entry != baseline && stats.median > 0) {
+            bool significant = stats.medianHigh < baseline->stats.medianLow || stats.medianLow > baseline->stats.medianHigh;
+            report += tr("  %1x%2").arg(baseline->stats.median / stats.median, 0, 'f', 2)
+                          .arg(significant ? QString() : tr("（误差范围内）"));
+        }
+        report += tr("\n");
+    }
+    ui->outputText->beginPhase(tr("运行配置对比"));
+    ui->outputText->appendOutput(Console::CompilerOutput, report);
+    ui->outputText->flushOutput();
+    ui->statusBar->showMessage(tr("已比较 %1 个运行配置").arg(comparedConfigurations.size()));
+}
+
+// 运行中再次触发时停止运行
+void MainWindow::startRun(RunMode mode)
 {
     if (isRunning) {
-        process.terminate();
+        comparisonQueue.clear();
+        if (builder->isBuilding()) {
+            builder->cancel();
+            isRunning = false;
+            ui->statusBar->showMessage(tr("已取消编译"), 2000);
+        } else if (benchmark->isRunning()) {
+            benchmark->cancel();
+            isRunning = false;
+            ui->statusBar->showMessage(tr("已停止基准测试"), 2000);
+        } else if (testPanel && testPanel->isRunning()) {
+            testPanel->cancel();
+            isRunning = false;
+            ui->statusBar->showMessage(tr("已停止测试"), 2000);
+        } else if (pythonRunner->isRunning()) {
+            pythonRunner->stop();
+            isRunning = false;
+            ui->outputText->beginPhase(tr("已停止"));
+            ui->outputText->flushOutput();
+            ui->statusBar->showMessage(tr("已停止运行"), 2000);
+        } else {
+            // 程序可能忽略 SIGTERM，过一会儿仍未结束就强行结束
+            process.terminate();
+            const qint64 pid = process.processId();
+            QTimer::singleShot(2000, this, [this, pid] {
+                if (process.state() != QProcess::NotRunning && process.processId() == pid)
+                    process.kill();
+            });
+        }
         ui->actionRun->setIcon(runIcon);
         return;
     }
-    if (!fileSaved) {
+    if (current->language() == Python) {
+        if (mode != NormalRun)
+            ui->statusBar->showMessage(tr("Python 文件只支持直接运行"), 3000);
+        else
+            startPythonRun();
+        return;
+    }
+    if (!current->isSaved()) {
         if (QMessageBox::Save == QMessageBox::question(this, tr("文件未保存"), tr("文件保存后才能运行，是否保存？"), QMessageBox::Save, QMessageBox::Cancel))
             saveFile();
+        // 编译需要读取磁盘上的文件，这里必须等待后台保存完成并处理完成通知
+        fileSaver->waitForFinished();
+        QCoreApplication::processEvents();
     }
-    if (fileSaved) {
-        //if(process!=nullptr)delete process;
+    if (current->isSaved()) {
         isRunning = true;
-        ui->statusBar->showMessage(tr("程序运行中..."));
-        ui->outputText->clear();
-        output.clear();
-        error.clear();
-        QString buildPath;
-        QRegularExpression re(tr(".*(?=\\.cpp)|.*(?=\\.c)|.*(?=\\.h)"));
-        buildPath = re.match(filePath).captured();
-        //qDebug()<<buildPath;
-        process.start("bash", QStringList() << "-c" << QString(tr("g++ ") + filePath + tr(" -o ") + buildPath + tr(";") + buildPath));
-        process.waitForStarted();
-        ui->outputText->setFocus();
+        runMode = mode;
+        runLimits = RunLimits::load();
+        benchmarkRevision = QString::fromLatin1(current->contentHash.toHex());
+        ui->outputText->reset();
+        outputDecoder.reset();
+        errorDecoder.reset();
+        runningSource = current->filePath;
         ui->actionRun->setIcon(stopIcon);
+        if (mode == CompareRun) {
+            continueComparison();
+            return;
+        }
+        ui->statusBar->showMessage(tr("正在编译..."));
+        ui->outputText->beginPhase(tr("编译"));
+        // 编译在后台进行，内容没有变化时直接取编译缓存中的程序
+        runningConfiguration = RunConfiguration::currentId();
+        builder->start(buildRequest(current->filePath, runningConfiguration));
     }
 }
 
+// 直接运行编辑器中的内容，不需要先保存；未命名的文件在临时目录下运行
+void MainWindow::startPythonRun()
+{
+    isRunning = true;
+    runMode = NormalRun;
+    ui->outputText->reset();
+    outputDecoder.reset();
+    errorDecoder.reset();
+    runningSource = current->filePathKnown ? current->filePath : QDir::temp().filePath(QStringLiteral("untitled.py"));
+    ui->actionRun->setIcon(stopIcon);
+    ui->statusBar->showMessage(tr("程序运行中..."));
+    ui->outputText->beginPhase(tr("运行"));
+    runLimits = RunLimits::load();
+    pythonRunner->run(runningSource, ui->editor->document()->toPlainText(), runLimits);
+    ui->outputText->setFocus();
+}
+
+// 编译选项为运行配置的选项加上 build/flags 中对所有配置都生效的选项
+BuildRequest MainWindow::buildRequest(const QString &source, const QString &configuration) const
+{
+    QSettings settings;
+    RunConfiguration runConfiguration = RunConfiguration::find(configuration.isEmpty() ? RunConfiguration::currentId()
+                                                                                       : configuration);
+    BuildRequest request;
+    request.source = source;
+    request.compiler = settings.value(QStringLiteral("build/compiler"), QStringLiteral("g++")).toString();
+    request.flags = runConfiguration.compilerFlags() + settings.value(QStringLiteral("build/flags")).toStringList();
+    request.project = ui->actionProjectMode->isChecked();
+    request.configuration = runConfiguration.id;
+    return request;
+}
+
+// 打开或保存 C++ 文件后提前准备预编译头，第一次运行时就能用上
+void MainWindow::warmUpBuild(EditorTab *tab)
+{
+    if (tab->filePathKnown && tab->language() == Cpp && !ui->actionProjectMode->isChecked())
+        builder->warmUp(buildRequest(tab->filePath));
+}
+
+void MainWindow::buildFinished(const BuildResult &result)
+{
+    QString report = result.output;
+    // 项目模式：列出每个翻译单元的编译耗时
+    int compiled = 0;
+    for (const UnitTiming &unit : result.units) {
+        if (unit.elapsed < 0) {
+            report += tr("  [最新]        ") + unit.file + tr("\n");
+            continue;
+        }
+        ++compiled;
+        report += QString(tr("  [%1] %2 ms  ")).arg(unit.ok ? tr("编译") : tr("失败")).arg(unit.elapsed, 6) + unit.file + tr("\n");
+    }
+    if (result.linkElapsed >= 0)
+        report += QString(tr("  [链接] %1 ms\n")).arg(result.linkElapsed, 6);
+    ui->outputText->appendOutput(Console::CompilerOutput, report);
+
+    // 诊断中的相对路径相对于源文件所在目录
+    diagnostics.clear();
+    const QDir sourceDirectory = QFileInfo(runningSource).absoluteDir();
+    for (const Diagnostic &diagnostic : result.diagnostics) {
+        if (!diagnostic.file.isEmpty())
+            diagnostics[QDir::cleanPath(sourceDirectory.absoluteFilePath(diagnostic.file))].append(diagnostic);
+    }
+    showDiagnostics();
+    if (!result.ok && runMode == CompareRun) {
+        ComparisonEntry entry;
+        entry.name = RunConfiguration::find(runningConfiguration).name;
+        entry.error = tr("编译失败");
+        comparedConfigurations.append(entry);
+        continueComparison();
+        return;
+    }
+    if (!result.ok) {
+        isRunning = false;
+        ui->actionRun->setIcon(runIcon);
+        ui->statusBar->showMessage(tr("编译失败"));
+        return;
+    }
+    if (!result.units.isEmpty())
+        buildInfo = tr("项目构建：重新编译 %1/%2 个文件%3（%4 ms）").arg(compiled).arg(result.units.size())
+                    .arg(result.linkElapsed >= 0 ? tr("，已重新链接") : QString()).arg(result.elapsed);
+    else if (result.cacheHit)
+        buildInfo = tr("编译缓存命中（%1 ms）").arg(result.elapsed);
+    else
+        buildInfo = tr("缓存未命中，已编译（%1 ms）").arg(result.elapsed);
+    ui->statusBar->showMessage(buildInfo + tr("，程序运行中..."));
+    ui->outputText->beginPhase(tr("运行"));
+    process.setWorkingDirectory(QFileInfo(runningSource).absolutePath());
+    if (runMode == TestRun) {
+        ui->statusBar->showMessage(buildInfo + tr("，正在运行测试用例..."));
+        testPanel->run(result.binary, QFileInfo(runningSource).absolutePath(), runLimits, addressSpaceLimit());
+        return;
+    }
+    if (runMode == BenchmarkRun || runMode == CompareRun) {
+        benchmarkOptions = BenchmarkOptions::load();
+        ui->statusBar->showMessage(buildInfo + tr("，基准测试中..."));
+        ui->outputText->beginPhase(tr("基准测试"));
+        benchmark->start(result.binary, QFileInfo(runningSource).absolutePath(), benchmarkOptions,
+                         runLimits, addressSpaceLimit());
+        return;
+    }
+    // 性能分析运行与受限制的运行都经包装进程
+    const QStringList limitOptions = RunProfiler::isSupported() ? RunProfiler::limitOptions(runLimits, addressSpaceLimit())
+                                                                : QStringList();
+    profileReport.clear();
+    if (runMode == ProfileRun || !limitOptions.isEmpty()) {
+        profileReport = RunProfiler::reportPath(QStringLiteral("profile.txt"));
+        QFile::remove(profileReport);
+        process.start(QCoreApplication::applicationFilePath(),
+                      RunProfiler::wrapperArguments(profileReport, result.binary, QStringList(), limitOptions));
+    } else {
+        process.start(result.binary, QStringList());
+    }
+    if (!process.waitForStarted()) {
+        ui->outputText->appendOutput(Console::StandardError, process.errorString() + tr("\n"));
+        isRunning = false;
+        ui->actionRun->setIcon(runIcon);
+        ui->statusBar->showMessage(tr("程序启动失败"));
+        return;
+    }
+    ui->outputText->setFocus();
+}
+
+void MainWindow::showDiagnostics()
+{
+    if (current->filePathKnown)
+        ui->editor->setDiagnostics(diagnostics.value(QDir::cleanPath(QFileInfo(current->filePath).absoluteFilePath())));
+    else
+        ui->editor->setDiagnostics(QVector<Diagnostic>());
+}
+
+// 只检查已有路径的 C++ 文件：相对的 #include 需要知道文件所在目录
+void MainWindow::checkSyntax()
+{
+    if (!current->filePathKnown || current->language() != Cpp
+        || !QSettings().value(QStringLiteral("build/syntaxCheck"), true).toBool())
+        return;
+    BuildRequest request = buildRequest(current->filePath);
+    syntaxChecker->check(current->filePath, ui->editor->document()->toPlainText().toLocal8Bit(),
+                         request.compiler, request.flags);
+}
+
+// 检查结果替换该文件上一次的诊断（包括运行时编译给出的）
+void MainWindow::syntaxChecked(const QString &path, const QVector<Diagnostic> &result)
+{
+    diagnostics.insert(QDir::cleanPath(QFileInfo(path).absoluteFilePath()), result);
+    if (current->filePathKnown && QFileInfo(current->filePath) == QFileInfo(path))
+        showDiagnostics();
+}
+
+void MainWindow::gotoDiagnostic(bool forward)
+{
+    QString message;
+    if (ui->editor->gotoDiagnostic(forward, &message))
+        ui->statusBar->showMessage(message, 5000);
+    else
+        ui->statusBar->showMessage(tr("当前文件没有编译问题"), 2000);
+}
+
 void MainWindow::runFinished(int code)
 {
     ui->actionRun->setIcon(runIcon);
     isRunning = false;
-    qDebug() << tr("exit code=") << code;
-    ui->statusBar->showMessage(tr("Ready"));
+    RunProfile profile;
+    profile.valid = false;
+    if (!profileReport.isEmpty()) {
+        profile = RunProfiler::readReport(profileReport);
+        QFile::remove(profileReport);
+        profileReport.clear();
+    }
+    // 超出限制时给出判定与实际用量
+    QString verdict;
+    if (profile.valid && profile.verdict != RunProfile::Finished) {
+        verdict = profile.verdictText();
+        if (profile.verdict != RunProfile::RuntimeError)
+            verdict += tr("，限制：") + runLimits.describe();
+        ui->outputText->appendOutput(Console::StandardError, verdict + tr("\n"));
+    }
+    ui->outputText->beginPhase(tr("结束，退出码 %1").arg(code));
+    ui->outputText->flushOutput();
+    QString message = tr("运行结束，退出码 %1；").arg(code) + buildInfo;
+    // 输出量较大时给出输出区承受的吞吐量
+    qint64 bytes = ui->outputText->receivedBytes();
+    if (bytes >= (1 << 20))
+        message += tr("；输出 %1 MB，%2 MB/s").arg(bytes / 1048576.0, 0, 'f', 1).arg(ui->outputText->throughput(), 0, 'f', 1);
+    if (profile.valid && runMode == ProfileRun) {
+        showProfile(profile);
+        message = tr("运行结束，退出码 %1；").arg(code) + ProfilePanel::summary(profile);
+    }
+    if (!verdict.isEmpty())
+        message = verdict;
+    runMode = NormalRun;
+    ui->statusBar->showMessage(message);
+}
+
+void MainWindow::pythonFinished(int exitCode, qint64 elapsed, bool warm, RunProfile::Verdict verdict)
+{
+    ui->actionRun->setIcon(runIcon);
+    isRunning = false;
+    if (verdict == RunProfile::TimeLimitExceeded || verdict == RunProfile::OutputLimitExceeded) {
+        const QString text = RunProfile::verdictName(verdict) + tr("，限制：") + runLimits.describe();
+        ui->outputText->beginPhase(text);
+        ui->outputText->flushOutput();
+        ui->statusBar->showMessage(tr("%1；%2 ms").arg(text).arg(elapsed));
+        return;
+    }
+    ui->outputText->beginPhase(tr("结束，退出码 %1").arg(exitCode));
+    ui->outputText->flushOutput();
+    ui->statusBar->showMessage(tr("运行结束，退出码 %1；%2 ms（%3）").arg(exitCode).arg(elapsed)
+                               .arg(warm ? tr("解释器已预热") : tr("解释器冷启动")));
+}
+
+void MainWindow::benchmarkFinished(const BenchmarkResult &result)
+{
+    ComparisonEntry entry;
+    entry.name = RunConfiguration::find(runningConfiguration).name;
+    if (runMode != CompareRun) {
+        isRunning = false;
+        ui->actionRun->setIcon(runIcon);
+    }
+    if (!result.ok) {
+        ui->outputText->appendOutput(Console::StandardError, tr("基准测试中止：") + result.error + tr("\n"));
+        if (runMode == CompareRun) {
+            entry.error = tr("基准测试中止：") + result.error;
+            comparedConfigurations.append(entry);
+            continueComparison();
+            return;
+        }
+        ui->statusBar->showMessage(tr("基准测试中止"));
+        return;
+    }
+    BenchmarkRecord record;
+    record.revision = benchmarkRevision;
+    record.configuration = runningConfiguration;
+    record.time = QDateTime::currentDateTime();
+    record.options = benchmarkOptions;
+    record.stats = BenchmarkStats::compute(result.samples);
+    QString report = Benchmark::describe(record) + tr("\n");
+    QString comparison = Benchmark::compare(record, Benchmark::history(runningSource));
+    if (!comparison.isEmpty())
+        report += comparison + tr("\n");
+    if (!record.options.input.isEmpty())
+        report += tr("标准输入：") + record.options.input + tr("\n");
+    Benchmark::record(runningSource, record);
+    ui->outputText->appendOutput(Console::CompilerOutput, report);
+    ui->outputText->flushOutput();
+    if (runMode == CompareRun) {
+        entry.stats = record.stats;
+        comparedConfigurations.append(entry);
+        continueComparison();
+        return;
+    }
+    ui->statusBar->showMessage(comparison.isEmpty() ? tr("基准测试：中位数 %1 ms").arg(record.stats.median, 0, 'f', 3)
+                                                    : comparison);
+}
+
+// 面板在第一次打开时才创建，显示当前文件的用例
+void MainWindow::showTests()
+{
+    if (!testDock) {
+        testPanel = new TestPanel(this);
+        testDock = new QDockWidget(tr("测试用例"), this);
+        testDock->setObjectName(QStringLiteral("testDock"));
+        testDock->setWidget(testPanel);
+        addDockWidget(Qt::BottomDockWidgetArea, testDock);
+        connect(testPanel, &TestPanel::runRequested, this, &MainWindow::runTests);
+        connect(testPanel, &TestPanel::finished, this, &MainWindow::testsFinished);
+    }
+    testPanel->setSource(current->filePathKnown ? current->filePath : QString());
+    testDock->show();
+    testDock->raise();
+}
+
+// 先编译（可能直接命中缓存），再由面板并行运行全部用例
+void MainWindow::runTests()
+{
+    if (isRunning) {
+        startRun(TestRun);
+        return;
+    }
+    showTests();
+    if (!current->filePathKnown || !testPanel->hasCases()) {
+        ui->statusBar->showMessage(tr("请先在测试用例面板中添加用例"), 3000);
+        return;
+    }
+    startRun(TestRun);
+}
+
+void MainWindow::testsFinished(int passed, int total)
+{
+    if (runMode != TestRun || !isRunning)
+        return;
+    isRunning = false;
+    ui->actionRun->setIcon(runIcon);
+    ui->statusBar->showMessage(tr("测试用例：通过 %1/%2；").arg(passed).arg(total) + buildInfo);
+}
+
+// 面板在第一次性能分析运行时才创建
+void MainWindow::showProfile(const RunProfile &profile)
+{
+    if (!profileDock) {
+        profilePanel = new ProfilePanel(this);
+        profileDock = new QDockWidget(tr("性能分析"), this);
+        profileDock->setObjectName(QStringLiteral("profileDock"));
+        profileDock->setWidget(profilePanel);
+        addDockWidget(Qt::BottomDockWidgetArea, profileDock);
+    }
+    profilePanel->addRun(runningSource, profile);
+    profileDock->show();
+    profileDock->raise();
 }
 
 void MainWindow::updateOutput()
 {
-    output = QString::fromLocal8Bit(process.readAllStandardOutput());
-    //ui->outputText->setPlainText(output+tr("\n")+error);
-    ui->outputText->setPlainText(ui->outputText->toPlainText() + output);//+tr("\n"));
+    // 流式解码后只追加，由输出区按帧合并刷新
+    QByteArray data = process.readAllStandardOutput();
+    ui->outputText->appendOutput(Console::StandardOutput, outputDecoder.decode(data), data.size());
 }
 
 void MainWindow::updateError()
 {
-    error = QString::fromLocal8Bit(process.readAllStandardError());
-    //ui->outputText->setPlainText(output+tr("\n")+error);
-    ui->outputText->setPlainText(ui->outputText->toPlainText() + error);//+tr("\n"));
-    process.terminate();
-    isRunning = false;
+    QByteArray data = process.readAllStandardError();
+    // 标准错误只是另一路输出（警告、日志），不影响程序继续运行
+    ui->outputText->appendOutput(Console::StandardError, errorDecoder.decode(data), data.size());
 }
 
 void MainWindow::inputData(QString data)
 {
-    if (isRunning)
+    if (pythonRunner->isRunning())
+        pythonRunner->write(data.toUtf8());
+    else if (isRunning)
         process.write(data.toLocal8Bit());
 }
 
+// 输出区中双击的 file:line:col，相对路径相对于正在运行的源文件；文件不存在时返回 false
+bool MainWindow::openDiagnosticLocation(const QString &file, int line, int column)
+{
+    const QString path = QDir::cleanPath(QFileInfo(runningSource).absoluteDir().absoluteFilePath(file));
+    if (!QFileInfo(path).isFile())
+        return false;
+    openSearchResult(path, line, qMax(column - 1, 0), 0);
+    return true;
+}
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    if (!fileSaved) {
-        if (QMessageBox::Save == QMessageBox::question(this, tr("未保存就要退出？"), tr("当前文件没有保存，是否保存？不保存文件改动将会丢失"), QMessageBox::Save, QMessageBox::Cancel))
-            saveFile();
-        fileSaved = true;
+    for (EditorTab *tab : tabs) {
+        if (!confirmSave(tab, tr("未保存就要退出？"), tab->fileName + tr(" 没有保存，是否保存？不保存文件改动将会丢失"))) {
+            event->ignore();
+            return;
+        }
+    }
+    fileSaver->waitForFinished();
+    saveSession();
+    for (EditorTab *tab : tabs) {
+        tab->persistHistory();
+        tab->saveHighlighting();
+        // 正常关闭：无论是否保存，日志都不再需要
+        if (!tab->isHibernated())
+            tab->journal()->discard();
     }
 }
 
@@ -244,29 +1244,145 @@ void MainWindow::applyDarkTheme()
 
 void MainWindow::openFindReplaceDialog()
 {
+    if (!findReplaceDialog) {
+        findReplaceDialog = new FindReplaceDialog(this);
+        connect(findReplaceDialog, &FindReplaceDialog::find, this, &MainWindow::findText);
+        connect(findReplaceDialog, &FindReplaceDialog::queryChanged, this, &MainWindow::incrementalFind);
+        connect(findReplaceDialog, &FindReplaceDialog::replace, this, &MainWindow::replaceText);
+        connect(findReplaceDialog, &FindReplaceDialog::replaceAll, this, &MainWindow::replaceAllText);
+    }
     findReplaceDialog->show();
 }
 
+// 对话框还没有创建时没有地方显示，也就不需要记下
+void MainWindow::showMatchInfo(const QString &info)
+{
+    if (findReplaceDialog)
+        findReplaceDialog->setMatchInfo(info);
+}
+
 void MainWindow::findText(const QString &text, bool caseSensitive, bool wholeWords, bool regex)
 {
-    QTextDocument::FindFlags flags;
-    if (caseSensitive)
-        flags |= QTextDocument::FindCaseSensitively;
-    if (wholeWords)
-        flags |= QTextDocument::FindWholeWords;
+    if (text.isEmpty())
+        return;
+    findTimer.stop();
+    FindQuery query = {text, caseSensitive, wholeWords, regex};
+    if (findEngine->hasQuery() && findEngine->query() == query) {
+        selectNextMatch();
+        return;
+    }
+    // 新的查找条件：在文档快照上后台查找全部匹配，第一批结果到达后选中光标之后的匹配
+    startSearch(query, ui->editor->textCursor().position());
+}
 
-    if (regex) {
-        QRegularExpression re(text);
-        if (caseSensitive)
-            re.setPatternOptions(re.patternOptions() | QRegularExpression::CaseInsensitiveOption);
-        QTextCursor cursor = ui->editor->document()->find(re, ui->editor->textCursor(), flags);
-        if (!cursor.isNull())
-            ui->editor->setTextCursor(cursor);
-    } else {
-        QTextCursor cursor = ui->editor->document()->find(text, ui->editor->textCursor(), flags);
-        if (!cursor.isNull())
-            ui->editor->setTextCursor(cursor);
+// 边输入边查找：从当前选中内容的起点开始找，延长查询时仍停在同一个匹配上
+void MainWindow::incrementalFind(const QString &text, bool caseSensitive, bool wholeWords, bool regex)
+{
+    if (text.isEmpty()) {
+        findTimer.stop();
+        findEngine->clear();
+        pendingSelectFrom = -1;
+        currentMatch = -1;
+        ui->editor->setSearchMatches(QVector<FindMatch>());
+        showMatchInfo(QString());
+        return;
     }
+    typedQuery = {text, caseSensitive, wholeWords, regex};
+    findTimer.start();
+}
+
+void MainWindow::findTypedQuery()
+{
+    if (findEngine->hasQuery() && findEngine->query() == typedQuery)
+        return;
+    startSearch(typedQuery, ui->editor->textCursor().selectionStart());
+}
+
+void MainWindow::startSearch(const FindQuery &query, int selectFrom)
+{
+    pendingSelectFrom = selectFrom;
+    currentMatch = -1;
+    showMatchInfo(tr("正在查找..."));
+    findEngine->search(query);
+}
+
+void MainWindow::searchMatchesFound()
+{
+    ui->editor->setSearchMatches(findEngine->matches());
+    if (pendingSelectFrom >= 0) {
+        int index = findEngine->matchIndexFrom(pendingSelectFrom);
+        if (index >= 0) {
+            pendingSelectFrom = -1;
+            selectMatch(index);
+            return;
+        }
+    }
+    updateMatchInfo();
+}
+
+void MainWindow::searchFinished(int total)
+{
+    ui->editor->setSearchMatches(findEngine->matches());
+    // 起点之后没有匹配时回到文档开头
+    if (pendingSelectFrom >= 0 && total > 0) {
+        pendingSelectFrom = -1;
+        selectMatch(0);
+        return;
+    }
+    pendingSelectFrom = -1;
+    updateMatchInfo();
+}
+
+// 编辑后匹配集合已就地更新，当前选中的若仍是一个匹配则保持其序号
+void MainWindow::searchMatchesChanged()
+{
+    ui->editor->setSearchMatches(findEngine->matches());
+    QTextCursor cursor = ui->editor->textCursor();
+    currentMatch = findEngine->matchIndexFrom(cursor.selectionStart());
+    if (currentMatch >= 0) {
+        const FindMatch &match = findEngine->matches().at(currentMatch);
+        if (match.start != cursor.selectionStart() || match.start + match.length != cursor.selectionEnd())
+            currentMatch = -1;
+    }
+    updateMatchInfo();
+}
+
+void MainWindow::selectNextMatch()
+{
+    const QVector<FindMatch> &matches = findEngine->matches();
+    int position = ui->editor->textCursor().position();
+    int index = findEngine->matchIndexFrom(position);
+    if (index < 0) {
+        if (findEngine->isSearching() || matches.isEmpty()) {
+            pendingSelectFrom = position;
+            return;
+        }
+        index = 0;
+    }
+    selectMatch(index);
+}
+
+void MainWindow::selectMatch(int index)
+{
+    const FindMatch &match = findEngine->matches().at(index);
+    QTextCursor cursor = ui->editor->textCursor();
+    cursor.setPosition(match.start);
+    cursor.setPosition(match.start + match.length, QTextCursor::KeepAnchor);
+    ui->editor->setTextCursor(cursor);
+    currentMatch = index;
+    updateMatchInfo();
+}
+
+void MainWindow::updateMatchInfo()
+{
+    int total = findEngine->matches().size();
+    QString suffix = findEngine->isSearching() ? tr("+") : QString();
+    if (total == 0)
+        showMatchInfo(findEngine->isSearching() ? tr("正在查找...") : tr("没有找到匹配"));
+    else if (currentMatch < 0)
+        showMatchInfo(tr("共 %1%2 个").arg(total).arg(suffix));
+    else
+        showMatchInfo(tr("第 %1 个，共 %2%3 个").arg(currentMatch + 1).arg(total).arg(suffix));
 }
 
 void MainWindow::replaceText(const QString &findText, const QString &replaceText, bool caseSensitive, bool wholeWords, bool regex)
@@ -280,7 +1396,7 @@ void MainWindow::replaceText(const QString &findText, const QString &replaceText
     QTextCursor cursor = ui->editor->textCursor();
     if (regex) {
         QRegularExpression re(findText);
-        if (caseSensitive)
+        if (!caseSensitive)
             re.setPatternOptions(re.patternOptions() | QRegularExpression::CaseInsensitiveOption);
         cursor = ui->editor->document()->find(re, cursor, flags);
     } else {
@@ -295,39 +1411,59 @@ void MainWindow::replaceText(const QString &findText, const QString &replaceText
 
 void MainWindow::replaceAllText(const QString &findText, const QString &replaceText, bool caseSensitive, bool wholeWords, bool regex)
 {
-    QTextDocument::FindFlags flags;
-    if (caseSensitive)
-        flags |= QTextDocument::FindCaseSensitively;
-    if (wholeWords)
-        flags |= QTextDocument::FindWholeWords;
-
-    QTextCursor cursor = ui->editor->textCursor();
-    cursor.movePosition(QTextCursor::Start);
-
-    while (true) {
-        if (regex) {
-            QRegularExpression re(findText);
-            if (caseSensitive)
-                re.setPatternOptions(re.patternOptions() | QRegularExpression::CaseInsensitiveOption);
-            cursor = ui->editor->document()->find(re, cursor, flags);
-        } else {
-            cursor = ui->editor->document()->find(findText, cursor, flags);
-        }
+    if (findText.isEmpty())
+        return;
+    FindQuery query = {findText, caseSensitive, wholeWords, regex};
+    QRegularExpression re = FindEngine::compile(query);
+    if (regex && !re.isValid()) {
+        showMatchInfo(tr("正则表达式错误：") + re.errorString());
+        return;
+    }
 
-        if (cursor.isNull())
-            break;
+    // 在快照上一次扫描得到全部匹配
+    const QVector<FindReplacement> replacements = FindEngine::replaceAll(ui->editor->toPlainText(), query, re, replaceText);
+    const int count = replacements.size();
+    if (count == 0) {
+        showMatchInfo(tr("没有找到匹配"));
+        return;
+    }
 
-        cursor.insertText(replaceText);
+    // 逐处替换，从后往前改，前面匹配的位置不受影响；整体作为一个编辑块提交，撤销只需一步。
+    // 编辑期间暂停语法高亮，结束后只重新分析有匹配的行，匹配之间未改动的行不必重新分析
+    QTextDocument *document = ui->editor->document();
+    Highlighter *highlighter = current->syntaxHighlighter();
+    if (highlighter)
+        highlighter->suspend();
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    for (int i = count - 1; i >= 0; --i) {
+        const FindReplacement &replacement = replacements.at(i);
+        cursor.setPosition(replacement.start);
+        cursor.setPosition(replacement.start + replacement.length, QTextCursor::KeepAnchor);
+        if (replacement.text.isEmpty())
+            cursor.removeSelectedText();
+        else
+            cursor.insertText(replacement.text);
     }
-}
-void MainWindow::changeSaveState()
-{
-    // 函数具体实现
-    if(firstLoad&&fileSaved){
-        this->setWindowTitle(tr("HJ Editor - ")+fileName);
-        firstLoad=false;
-        return;
+    cursor.endEditBlock();
+    if (highlighter) {
+        // 替换后第 i 处的起点要加上前面各处的长度变化；替换文本可能跨行
+        QVector<QTextBlock> touched;
+        int shift = 0;
+        for (const FindReplacement &replacement : replacements) {
+            const int start = replacement.start + shift;
+            shift += replacement.text.size() - replacement.length;
+            QTextBlock last = document->findBlock(start + replacement.text.size());
+            for (QTextBlock block = document->findBlock(start); block.isValid(); block = block.next()) {
+                if (touched.isEmpty() || touched.last() != block)
+                    touched.append(block);
+                if (block == last)
+                    break;
+            }
+        }
+        highlighter->resume(touched);
     }
-    fileSaved=false;
-    this->setWindowTitle(tr("HJ Editor - ")+fileName+tr("*"));
+
+    showMatchInfo(tr("已替换 %1 处").arg(count));
 }
+
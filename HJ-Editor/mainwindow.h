@@ -8,6 +8,26 @@
 #include <QProcess>
 #include <QDebug>
 #include "findreplacedialog.h"
+#include "filesaver.h"
+#include "editjournal.h"
+#include "findengine.h"
+#include "findinfiles.h"
+#include "trigramindex.h"
+#include "gotofiledialog.h"
+#include "editortab.h"
+#include "builder.h"
+#include "outputdecoder.h"
+#include "syntaxchecker.h"
+#include "profilepanel.h"
+#include "benchmark.h"
+#include "runconfiguration.h"
+#include "testpanel.h"
+#include "pythonrunner.h"
+#include <QTimer>
+
+class QDockWidget;
+class QTabBar;
+class QComboBox;
 
 namespace Ui {
     class MainWindow;
@@ -25,51 +45,153 @@ private:
     QIcon runIcon;
     QIcon stopIcon;
     Ui::MainWindow *ui;
-    Highlighter *highlighter;
     QProcess process;
-    void setUpHighlighter();
-    //---------记录文件信息----------
-    QString fileName;
-    QString filePath;
-    bool fileSaved;
+    void setUpEditor();
     bool isRunning;
-    //bool fileEdited;
     void initFileData();
-    bool firstLoad;
+    //---------标签页---------------
+    QTabBar *tabBar;
+    QList<EditorTab *> tabs;        // 与 tabBar 中的顺序一致
+    QList<EditorTab *> recentTabs;  // 最近激活的在前，用于决定休眠哪些标签页
+    EditorTab *current;
+    EditorTab *newTab();
+    int tabIndexOf(const QString &path) const;
+    bool closeTab(int index);
+    bool confirmSave(EditorTab *tab, const QString &title, const QString &text);
+    void updateTabTitle(EditorTab *tab);
+    void hibernateIdleTabs();
     //-----------------------------
 
     //---------code running data---
-    QString output;
-    QString error;
+    Builder *builder;
+    QString runningSource;
+    // configuration 为空时使用工具栏上选中的运行配置
+    BuildRequest buildRequest(const QString &source, const QString &configuration = QString()) const;
+    void warmUpBuild(EditorTab *tab);
+    QString buildInfo;   // 最近一次构建的缓存命中情况，运行结束后仍显示在状态栏
+    enum RunMode {
+        NormalRun,
+        ProfileRun,      // 经包装进程统计资源使用
+        BenchmarkRun,    // 在后台重复运行并计时
+        CompareRun,      // 依次以每个运行配置构建并做基准测试
+        TestRun          // 用测试用例面板中的全部用例并行运行
+    };
+    void startRun(RunMode mode);
+    RunMode runMode;
+    QString profileReport;   // 包装进程写入的报告文件，没有经包装进程运行时为空
+    RunLimits runLimits;     // 运行开始时的运行限制
+    bool addressSpaceLimit() const;
+    QDockWidget *profileDock;
+    ProfilePanel *profilePanel;
+    void showProfile(const RunProfile &profile);
+    Benchmark *benchmark;
+    QString benchmarkRevision;   // 基准测试开始时源文件内容的 SHA-1
+    BenchmarkOptions benchmarkOptions;
+    QComboBox *configurationBox;
+    void reloadConfigurations();
+    QString runningConfiguration;   // 本次构建所用运行配置的 id
+    struct ComparisonEntry {
+        QString name;
+        QString error;   // 为空表示成功
+        BenchmarkStats stats;
+    };
+    QStringList comparisonQueue;   // 还未测试的运行配置
+    QVector<ComparisonEntry> comparedConfigurations;
+    void continueComparison();
+    void reportComparison();
+    QDockWidget *testDock;
+    TestPanel *testPanel;
+    PythonRunner *pythonRunner;   // Python 文件不经编译，交给常驻解释器运行
+    void startPythonRun();
+    OutputDecoder outputDecoder;   // 标准输出与标准错误各用一个，跨块保留残留的半个字符
+    OutputDecoder errorDecoder;
+    QHash<QString, QVector<Diagnostic>> diagnostics;   // 最近一次构建的诊断，按文件的绝对路径分组
+    void showDiagnostics();
+    void gotoDiagnostic(bool forward);
+    SyntaxChecker *syntaxChecker;
+    QTimer syntaxTimer;   // 防抖：停止输入一小段时间后才检查
+    void checkSyntax();
+    //-----------------------------
+    FindReplaceDialog *findReplaceDialog;   // 第一次打开时创建
+    void showMatchInfo(const QString &info);
+    //---------查找状态-------------
+    FindEngine *findEngine;
+    int pendingSelectFrom;  // 结果到达后选中此位置之后的第一个匹配，-1 表示不需要
+    int currentMatch;
+    QTimer findTimer;           // 防抖：边输入边查找时停顿片刻才开始查找
+    FindQuery typedQuery;
+    void startSearch(const FindQuery &query, int selectFrom);
+    void findTypedQuery();
+    void selectNextMatch();
+    void selectMatch(int index);
+    void updateMatchInfo();
     //-----------------------------
-    FindReplaceDialog *findReplaceDialog;
+    QDockWidget *findInFilesDock;
+    FindInFilesPanel *findInFilesPanel;
+    bool loadFile(const QString &openPath);
+    void jumpTo(int line, int column, int length);
+    TrigramIndex *projectIndex;
+    GoToFileDialog *goToFileDialog;
+    TrigramIndex *ensureProjectIndex();
+    void refreshGoToFile();
+    FileSaver *fileSaver;
+    void writeFile(const QString &path);
+    void restoreBuffer(const QString &basePath, const QString &text);
+    void saveSession();
 
 public slots:
-    void changeSaveState();
+    void activateTab(int index);
+    void tabSaveStateChanged();
     //---------工具栏响应函数---------
     void newFile();
     void saveFile();
+    void saveFileAs();
     void openFile();
     void undo();
     void redo();
     void run();
+    void runWithProfiling();
+    void runBenchmark();
+    void configureBenchmark();
+    void configureLimits();
+    void editRunConfigurations();
+    void compareConfigurations();
+    void showTests();
+    void runTests();
+    void testsFinished(int passed, int total);
+    void benchmarkFinished(const BenchmarkResult &result);
     void applyLightTheme();
     void applyDarkTheme();
     //------------------------------
+    void buildFinished(const BuildResult &result);
+    void syntaxChecked(const QString &path, const QVector<Diagnostic> &result);
     void runFinished(int code);
+    void pythonFinished(int exitCode, qint64 elapsed, bool warm, RunProfile::Verdict verdict);
     void updateOutput();
     void updateError();
     void about();
+    void fileWritten(const QString &path, int revision, const QByteArray &hash);
+    void fileWriteFailed(const QString &path, const QString &errorString);
+    void recoverJournals();
+    void restoreSession();
+    void searchMatchesFound();
+    void searchFinished(int total);
+    void searchMatchesChanged();
     void openFindReplaceDialog();
+    void openFindInFiles();
+    void openSearchResult(const QString &path, int line, int column, int length);
+    void openGoToFile();
+    bool switchToFile(const QString &path);
     void findText(const QString &text, bool caseSensitive, bool wholeWords, bool regex);
+    void incrementalFind(const QString &text, bool caseSensitive, bool wholeWords, bool regex);
     void replaceText(const QString &findText, const QString &replaceText, bool caseSensitive, bool wholeWords, bool regex);
     void replaceAllText(const QString &findText, const QString &replaceText, bool caseSensitive, bool wholeWords, bool regex);
 
 public:
     void inputData(QString data);
+    bool openDiagnosticLocation(const QString &file, int line, int column);
 
 protected:
-    void resizeEvent(QResizeEvent* event) override;
     void closeEvent(QCloseEvent* event) override;
 };
 
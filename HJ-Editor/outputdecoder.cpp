@@ -0,0 +1,192 @@
+#include "outputdecoder.h"
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <QVector>
+
+namespace {
+
+const ushort Escape = 0x1b;
+const ushort Bell = 0x07;
+const int MaxEscapeLength = 256;   // 更长的“转义序列”视为乱码直接丢弃，避免无限积攒
+
+// 16 色调色板（与常见终端的默认配色一致，明暗背景下都能看清）
+const QRgb AnsiPalette[16] = {
+    0x000000, 0xcd3131, 0x0dbc79, 0xe5e510, 0x2472c8, 0xbc3fbc, 0x11a8cd, 0xe5e5e5,
+    0x666666, 0xf14c4c, 0x23d18b, 0xf5f543, 0x3b8eea, 0xd670d6, 0x29b8db, 0xffffff
+};
+
+} // namespace
+
+OutputDecoder::OutputDecoder()
+{
+    reset();
+}
+
+OutputDecoder::~OutputDecoder()
+{
+}
+
+void OutputDecoder::reset()
+{
+    decoder.reset(QTextCodec::codecForLocale()->makeDecoder());
+    partialEscape.clear();
+    format = QTextCharFormat();
+}
+
+QVector<OutputSpan> OutputDecoder::decode(const QByteArray &chunk)
+{
+    QVector<OutputSpan> spans;
+    QString text = decoder->toUnicode(chunk);
+    if (!partialEscape.isEmpty()) {
+        text.prepend(partialEscape);
+        partialEscape.clear();
+    }
+    // 大多数输出既没有转义序列也没有 \r，整块作为一段
+    if (text.indexOf(QChar(Escape)) < 0 && text.indexOf(QLatin1Char('\r')) < 0) {
+        append(&spans, text, 0, text.size());
+        return spans;
+    }
+
+    const int n = text.size();
+    int runStart = 0;
+    int i = 0;
+    while (i < n) {
+        const ushort c = text.at(i).unicode();
+        if (c == '\r') {
+            // \r\n 与单独的 \r（进度条）都不另起一行
+            append(&spans, text, runStart, i);
+            runStart = ++i;
+            continue;
+        }
+        if (c != Escape) {
+            ++i;
+            continue;
+        }
+        append(&spans, text, runStart, i);
+        int end = -1;   // 转义序列之后的位置，-1 表示序列尚未完整
+        if (i + 1 < n) {
+            const ushort kind = text.at(i + 1).unicode();
+            if (kind == '[') {
+                // CSI：参数与中间字节，直到 0x40-0x7e 的结束字节
+                int j = i + 2;
+                while (j < n && (text.at(j).unicode() < 0x40 || text.at(j).unicode() > 0x7e))
+                    ++j;
+                if (j < n) {
+                    if (text.at(j) == QLatin1Char('m'))
+                        applySgr(text.mid(i + 2, j - i - 2));
+                    end = j + 1;
+                }
+            } else if (kind == ']') {
+                // OSC（窗口标题、超链接等）：以 BEL 或 ESC \ 结束
+                for (int j = i + 2; j < n; ++j) {
+                    if (text.at(j).unicode() == Bell) {
+                        end = j + 1;
+                        break;
+                    }
+                    if (text.at(j).unicode() == Escape && j + 1 < n && text.at(j + 1) == QLatin1Char('\\')) {
+                        end = j + 2;
+                        break;
+                    }
+                }
+            } else {
+                end = i + 2;
+            }
+        }
+        if (end < 0) {
+            // 序列被读取边界截断，留到下一块
+            if (n - i <= MaxEscapeLength)
+                partialEscape = text.mid(i);
+            return spans;
+        }
+        i = end;
+        runStart = i;
+    }
+    append(&spans, text, runStart, n);
+    return spans;
+}
+
+void OutputDecoder::append(QVector<OutputSpan> *spans, const QString &text, int from, int to) const
+{
+    if (from >= to)
+        return;
+    if (!spans->isEmpty() && spans->last().format == format) {
+        spans->last().text += text.midRef(from, to - from);
+        return;
+    }
+    OutputSpan span;
+    span.text = text.mid(from, to - from);
+    span.format = format;
+    spans->append(span);
+}
+
+QColor OutputDecoder::paletteColor(int index)
+{
+    if (index < 16)
+        return QColor(AnsiPalette[index]);
+    if (index < 232) {
+        // 6x6x6 颜色立方体
+        index -= 16;
+        auto level = [](int v) { return v ? 55 + v * 40 : 0; };
+        return QColor(level(index / 36), level(index / 6 % 6), level(index % 6));
+    }
+    int gray = 8 + (qMin(index, 255) - 232) * 10;
+    return QColor(gray, gray, gray);
+}
+
+void OutputDecoder::applySgr(const QString &parameters)
+{
+    QVector<int> codes;
+    QString normalized = parameters;
+    normalized.replace(QLatin1Char(':'), QLatin1Char(';'));   // 38:2:r:g:b 的写法
+    for (const QStringRef &part : normalized.splitRef(QLatin1Char(';')))
+        codes.append(part.isEmpty() ? 0 : part.toInt());
+    if (codes.isEmpty())
+        codes.append(0);
+
+    for (int i = 0; i < codes.size(); ++i) {
+        const int code = codes.at(i);
+        if (code == 0) {
+            format = QTextCharFormat();
+        } else if (code == 1) {
+            format.setFontWeight(QFont::Bold);
+        } else if (code == 22) {
+            format.setFontWeight(QFont::Normal);
+        } else if (code == 3) {
+            format.setFontItalic(true);
+        } else if (code == 23) {
+            format.setFontItalic(false);
+        } else if (code == 4) {
+            format.setFontUnderline(true);
+        } else if (code == 24) {
+            format.setFontUnderline(false);
+        } else if (code >= 30 && code <= 37) {
+            format.setForeground(paletteColor(code - 30));
+        } else if (code >= 90 && code <= 97) {
+            format.setForeground(paletteColor(code - 90 + 8));
+        } else if (code == 39) {
+            format.clearForeground();
+        } else if (code >= 40 && code <= 47) {
+            format.setBackground(paletteColor(code - 40));
+        } else if (code >= 100 && code <= 107) {
+            format.setBackground(paletteColor(code - 100 + 8));
+        } else if (code == 49) {
+            format.clearBackground();
+        } else if (code == 38 || code == 48) {
+            // 扩展颜色：5;n 为 256 色，2;r;g;b 为真彩色
+            QColor color;
+            if (i + 2 < codes.size() && codes.at(i + 1) == 5) {
+                color = paletteColor(qBound(0, codes.at(i + 2), 255));
+                i += 2;
+            } else if (i + 4 < codes.size() && codes.at(i + 1) == 2) {
+                color = QColor(qBound(0, codes.at(i + 2), 255), qBound(0, codes.at(i + 3), 255), qBound(0, codes.at(i + 4), 255));
+                i += 4;
+            } else {
+                break;
+            }
+            if (code == 38)
+                format.setForeground(color);
+            else
+                format.setBackground(color);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef OUTPUTDECODER_H
+#define OUTPUTDECODER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QTextCharFormat>
+#include <QScopedPointer>
+
+QT_BEGIN_NAMESPACE
+class QTextDecoder;
+QT_END_NAMESPACE
+
+// 一段使用同一格式的输出文本
+struct OutputSpan {
+    QString text;
+    QTextCharFormat format;
+};
+
+// 子进程输出流的解码器，每个流一个。QTextDecoder 保存被读取边界截断的多字节字符，
+// 下一块到达时接着解码；同一趟扫描中解析 ANSI 转义序列：SGR（颜色、粗体等）转为字符格式，
+// 其余控制序列与 \r 丢弃。被截断的转义序列同样留到下一块。
+class OutputDecoder
+{
+public:
+    OutputDecoder();
+    ~OutputDecoder();
+
+    QVector<OutputSpan> decode(const QByteArray &chunk);
+    // 新的一次运行：丢弃残留的半个字符与转义序列，格式恢复默认
+    void reset();
+
+private:
+    void applySgr(const QString &parameters);
+    void append(QVector<OutputSpan> *spans, const QString &text, int from, int to) const;
+    static QColor paletteColor(int index);
+
+    QScopedPointer<QTextDecoder> decoder;
+    QString partialEscape;
+    QTextCharFormat format;
+};
+
+#endif // OUTPUTDECODER_H
@@ -0,0 +1,175 @@
+#include "precompiledheader.h"
+#include "builder.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+
+const QLatin1String HeaderName("hj-pch.h");
+const int ScanLimit = 64 << 10;   // 只看文件开头
+
+// 解析代价明显的标准头文件，只含 <cstdio> 之类的文件不值得预编译
+const char *const HeavyHeaders[] = {
+    "bits/stdc++.h", "iostream", "string", "vector", "map", "set", "unordered_map", "unordered_set",
+    "algorithm", "functional", "sstream", "fstream", "iomanip", "regex", "random", "chrono", "thread",
+    "queue", "deque", "list", "stack", "bitset", "numeric", "memory", "complex", "valarray", "tuple",
+    "iterator", "future", "mutex", "locale"
+};
+
+QMutex buildingMutex;
+QSet<QString> building;   // 正在建立的头文件，避免重复编译
+
+QString cacheRoot()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/pch");
+}
+
+} // namespace
+
+QByteArray PrecompiledHeader::leadingIncludes(const QString &source)
+{
+    QFile in(source);
+    if (!in.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return leadingIncludesOf(in.read(ScanLimit));
+}
+
+QByteArray PrecompiledHeader::leadingIncludesOf(const QByteArray &text)
+{
+    const QList<QByteArray> lines = text.left(ScanLimit).split('\n');
+
+    QByteArray includes;
+    bool heavy = false;
+    bool inComment = false;
+    for (const QByteArray &raw : lines) {
+        QByteArray line = raw.trimmed();
+        if (inComment) {
+            int end = line.indexOf("*/");
+            if (end < 0)
+                continue;
+            inComment = false;
+            line = line.mid(end + 2).trimmed();
+        }
+        if (line.startsWith("/*")) {
+            int end = line.indexOf("*/", 2);
+            if (end < 0) {
+                inComment = true;
+                continue;
+            }
+            line = line.mid(end + 2).trimmed();
+        }
+        if (line.isEmpty() || line.startsWith("//"))
+            continue;
+        // 只接受 #include <...>：带引号的是项目自己的头文件，经常改动
+        if (!line.startsWith('#'))
+            break;
+        QByteArray directive = line.mid(1).trimmed();
+        if (!directive.startsWith("include"))
+            break;
+        QByteArray target = directive.mid(7).trimmed();
+        int close = target.indexOf('>');
+        if (!target.startsWith('<') || close < 0)
+            break;
+        QByteArray name = target.mid(1, close - 1).trimmed();
+        QByteArray rest = target.mid(close + 1).trimmed();
+        if (!rest.isEmpty() && !rest.startsWith("//"))
+            break;
+        for (const char *header : HeavyHeaders) {
+            if (name == header) {
+                heavy = true;
+                break;
+            }
+        }
+        includes += "#include <" + name + ">\n";
+    }
+    return heavy ? includes : QByteArray();
+}
+
+QString PrecompiledHeader::headerPath(const QByteArray &compilerIdentity, const QStringList &flags,
+                                      const QByteArray &includes, bool *ready)
+{
+    QCryptographicHash key(QCryptographicHash::Sha1);
+    key.addData(compilerIdentity);
+    for (const QString &flag : flags) {
+        key.addData("\0", 1);
+        key.addData(flag.toUtf8());
+    }
+    key.addData("\0", 1);
+    key.addData(includes);
+    QString header = cacheRoot() + QLatin1Char('/') + QString::fromLatin1(key.result().toHex())
+                     + QLatin1Char('/') + HeaderName;
+
+    QFile gch(header + QLatin1String(".gch"));
+    *ready = gch.open(QIODevice::ReadOnly);
+    if (*ready)
+        gch.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    return header;
+}
+
+bool PrecompiledHeader::build(const QString &compiler, const QStringList &flags, const QString &header,
+                              const QByteArray &includes, const QAtomicInt *cancel)
+{
+    const QString gch = header + QLatin1String(".gch");
+    {
+        QMutexLocker locker(&buildingMutex);
+        if (building.contains(header) || QFileInfo::exists(gch))
+            return true;
+        building.insert(header);
+    }
+
+    bool ok = false;
+    QDir().mkpath(QFileInfo(header).absolutePath());
+    QFile out(header);
+    if (out.open(QIODevice::WriteOnly | QIODevice::Truncate) && out.write(includes) == includes.size()) {
+        out.close();
+        // 先写到临时文件，完成后 rename，编译时不会读到写了一半的 .gch
+        const QString temporary = gch + QLatin1String(".tmp");
+        QStringList arguments = QStringList() << QStringLiteral("-x") << QStringLiteral("c++-header")
+                                              << header << QStringLiteral("-o") << temporary;
+        int exitCode = -1;
+        if (Builder::runTool(compiler, arguments + flags, cancel, nullptr, nullptr, &exitCode) && exitCode == 0)
+            ok = QFile::rename(temporary, gch);
+        if (!ok)
+            QFile::remove(temporary);
+    }
+
+    {
+        QMutexLocker locker(&buildingMutex);
+        building.remove(header);
+    }
+    if (ok)
+        evict();
+    return ok;
+}
+
+// .gch 动辄上百 MB，只保留最近用过的几个
+void PrecompiledHeader::evict()
+{
+    const int keep = QSettings().value(QStringLiteral("build/precompiledHeaderCount"), 4).toInt();
+    QDir root(cacheRoot());
+    QList<QPair<QDateTime, QString>> entries;
+    for (const QString &name : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QString dir = root.filePath(name);
+        QFileInfo gch(dir + QLatin1Char('/') + HeaderName + QLatin1String(".gch"));
+        if (!gch.exists()) {
+            // 正在建立的目录不动；没建成的残留一小时后清理
+            if (QFileInfo(dir).lastModified().secsTo(QDateTime::currentDateTime()) > 3600)
+                QDir(dir).removeRecursively();
+            continue;
+        }
+        entries.append(qMakePair(gch.lastModified(), dir));
+    }
+    std::sort(entries.begin(), entries.end(), [](const QPair<QDateTime, QString> &a, const QPair<QDateTime, QString> &b) {
+        return a.first > b.first;
+    });
+    for (int i = keep; i < entries.size(); ++i)
+        QDir(entries.at(i).second).removeRecursively();
+}
@@ -0,0 +1,31 @@
+#ifndef PRECOMPILEDHEADER_H
+#define PRECOMPILEDHEADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QAtomicInt>
+
+// 预编译头：小程序的编译时间大多花在解析开头的 <bits/stdc++.h>、<iostream> 等标准头文件上。
+// 把源文件开头连续的标准库 #include 行单独做成头文件，按“编译器 + 选项 + 这些行”
+// 在缓存目录中预编译一份 .gch；编译时用 -include 引入该头文件，g++ 会自动改用旁边的 .gch。
+// 这些行本来就在文件最前面，提前引入不改变语义，源文件中重复的 #include 由头文件自身的保护宏跳过。
+class PrecompiledHeader
+{
+public:
+    // 源文件开头（只隔着空行与注释）的 #include 行，其中至少有一个重量级标准头文件时才返回
+    static QByteArray leadingIncludes(const QString &source);
+    // 同上，用于还没有保存的文本
+    static QByteArray leadingIncludesOf(const QByteArray &text);
+    // 对应的头文件路径，.gch 在它旁边；ready 表示 .gch 是否已经建好（建好时顺便更新使用时间）
+    static QString headerPath(const QByteArray &compilerIdentity, const QStringList &flags,
+                              const QByteArray &includes, bool *ready);
+    // 建立预编译头；已经建好或者另一个线程正在建立时直接返回
+    static bool build(const QString &compiler, const QStringList &flags, const QString &header,
+                      const QByteArray &includes, const QAtomicInt *cancel);
+
+private:
+    static void evict();
+};
+
+#endif // PRECOMPILEDHEADER_H
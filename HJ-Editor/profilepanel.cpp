@@ -0,0 +1,146 @@
+#include "profilepanel.h"
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFileInfo>
+#include <QTime>
+#include <QLocale>
+
+namespace {
+
+const int MaxRuns = 100;
+
+enum Column {
+    TimeColumn,
+    ProgramColumn,
+    ExitColumn,
+    WallColumn,
+    UserColumn,
+    SystemColumn,
+    MemoryColumn,
+    FaultsColumn,
+    SwitchesColumn,
+    InstructionsColumn,
+    CyclesColumn,
+    IpcColumn,
+    CacheMissesColumn,
+    BranchMissesColumn,
+    ColumnCount
+};
+
+QString milliseconds(qint64 microseconds)
+{
+    return microseconds < 0 ? QStringLiteral("—") : QString::number(microseconds / 1000.0, 'f', 1);
+}
+
+// 大数用 K/M/G 缩写，提示中给出精确值
+QString abbreviated(qint64 value)
+{
+    if (value < 0)
+        return QStringLiteral("—");
+    if (value < 10000)
+        return QString::number(value);
+    const char *const suffixes[] = {"K", "M", "G", "T"};
+    double scaled = value;
+    int i = -1;
+    while (scaled >= 1000 && i < 3) {
+        scaled /= 1000;
+        ++i;
+    }
+    return QString::number(scaled, 'f', scaled < 100 ? 2 : 1) + QLatin1String(suffixes[i]);
+}
+
+QString pair(qint64 first, qint64 second)
+{
+    if (first < 0 || second < 0)
+        return QStringLiteral("—");
+    return abbreviated(first) + QLatin1String(" / ") + abbreviated(second);
+}
+
+QString exitText(const RunProfile &profile)
+{
+    if (profile.signal > 0)
+        return QObject::tr("信号 %1").arg(profile.signal);
+    return QString::number(profile.exitCode);
+}
+
+} // namespace
+
+ProfilePanel::ProfilePanel(QWidget *parent) : QWidget(parent)
+{
+    table = new QTableWidget(0, ColumnCount, this);
+    statusLabel = new QLabel(this);
+    clearButton = new QPushButton("清空", this);
+
+    table->setHorizontalHeaderLabels(QStringList()
+        << "时间" << "程序" << "退出码" << "墙钟 ms" << "用户 CPU ms" << "系统 CPU ms" << "峰值内存 MB"
+        << "缺页 次要/主要" << "上下文切换 自愿/非自愿" << "指令" << "周期" << "IPC" << "缓存未命中" << "分支预测失败");
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    QHBoxLayout *statusLayout = new QHBoxLayout;
+    statusLayout->addWidget(statusLabel, 1);
+    statusLayout->addWidget(clearButton);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(table);
+    mainLayout->addLayout(statusLayout);
+    setLayout(mainLayout);
+
+    connect(clearButton, &QPushButton::clicked, this, [this] { table->setRowCount(0); });
+}
+
+void ProfilePanel::addRun(const QString &program, const RunProfile &profile)
+{
+    table->insertRow(0);
+    if (table->rowCount() > MaxRuns)
+        table->setRowCount(MaxRuns);
+
+    double ipc = profile.instructions >= 0 && profile.cycles > 0 ? double(profile.instructions) / profile.cycles : -1;
+    QString texts[ColumnCount];
+    texts[TimeColumn] = QTime::currentTime().toString(QStringLiteral("HH:mm:ss"));
+    texts[ProgramColumn] = QFileInfo(program).fileName();
+    texts[ExitColumn] = exitText(profile);
+    texts[WallColumn] = milliseconds(profile.wallTime);
+    texts[UserColumn] = milliseconds(profile.userTime);
+    texts[SystemColumn] = milliseconds(profile.systemTime);
+    texts[MemoryColumn] = profile.peakMemory < 0 ? QStringLiteral("—") : QString::number(profile.peakMemory / 1024.0, 'f', 1);
+    texts[FaultsColumn] = pair(profile.minorFaults, profile.majorFaults);
+    texts[SwitchesColumn] = pair(profile.voluntarySwitches, profile.involuntarySwitches);
+    texts[InstructionsColumn] = abbreviated(profile.instructions);
+    texts[CyclesColumn] = abbreviated(profile.cycles);
+    texts[IpcColumn] = ipc < 0 ? QStringLiteral("—") : QString::number(ipc, 'f', 2);
+    texts[CacheMissesColumn] = abbreviated(profile.cacheMisses);
+    texts[BranchMissesColumn] = abbreviated(profile.branchMisses);
+
+    const qint64 exact[ColumnCount] = {-1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                       profile.instructions, profile.cycles, -1, profile.cacheMisses, profile.branchMisses};
+    for (int column = 0; column < ColumnCount; ++column) {
+        QTableWidgetItem *item = new QTableWidgetItem(texts[column]);
+        if (column != ProgramColumn && column != TimeColumn)
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        if (exact[column] >= 0)
+            item->setToolTip(QLocale().toString(exact[column]));
+        table->setItem(0, column, item);
+    }
+    table->item(0, ProgramColumn)->setToolTip(program);
+
+    if (profile.instructions < 0 && profile.cycles < 0)
+        statusLabel->setText(tr("硬件计数器不可用（内核不支持、/proc/sys/kernel/perf_event_paranoid 限制或运行在虚拟机中），只显示 rusage 数据"));
+    else
+        statusLabel->setText(tr("硬件计数器只统计用户态；计数器被分时复用时按实际计数时间放大"));
+}
+
+QString ProfilePanel::summary(const RunProfile &profile)
+{
+    QString text = tr("墙钟 %1 ms，用户 %2 ms，系统 %3 ms，峰值内存 %4 MB")
+                       .arg(milliseconds(profile.wallTime)).arg(milliseconds(profile.userTime))
+                       .arg(milliseconds(profile.systemTime)).arg(profile.peakMemory / 1024.0, 0, 'f', 1);
+    if (profile.instructions >= 0)
+        text += tr("，指令 %1").arg(abbreviated(profile.instructions));
+    return text;
+}
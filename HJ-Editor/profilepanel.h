@@ -0,0 +1,30 @@
+#ifndef PROFILEPANEL_H
+#define PROFILEPANEL_H
+
+#include <QWidget>
+#include "runprofiler.h"
+
+QT_BEGIN_NAMESPACE
+class QTableWidget;
+class QLabel;
+class QPushButton;
+QT_END_NAMESPACE
+
+// “性能分析”面板：每次性能分析运行一行，最新的在最上面，方便调整代码后对比
+class ProfilePanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ProfilePanel(QWidget *parent = nullptr);
+    void addRun(const QString &program, const RunProfile &profile);
+    // 状态栏用的一句话摘要
+    static QString summary(const RunProfile &profile);
+
+private:
+    QTableWidget *table;
+    QLabel *statusLabel;
+    QPushButton *clearButton;
+};
+
+#endif // PROFILEPANEL_H
@@ -0,0 +1,229 @@
+#include "projectbuilder.h"
+#include "compilecache.h"
+#include "projectfiles.h"
+#include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+const int MaxUnits = 4096;
+
+struct UnitJob {
+    QString source;
+    QString object;
+    QString signature;
+};
+
+struct UnitOutcome {
+    bool ok;
+    qint64 elapsed;
+    QString output;
+    QVector<Diagnostic> diagnostics;
+};
+
+bool isTranslationUnit(const QFileInfo &info)
+{
+    const QString suffix = info.suffix().toLower();
+    return suffix == QLatin1String("cpp") || suffix == QLatin1String("cc") || suffix == QLatin1String("cxx");
+}
+
+// 先写到临时文件，成功后 rename 覆盖，中途失败或取消不会留下半个目标文件
+UnitOutcome compileUnit(const BuildRequest &request, const QStringList &diagnosticOptions, const UnitJob &job,
+                        const QAtomicInt *cancel)
+{
+    QElapsedTimer timer;
+    timer.start();
+    UnitOutcome outcome;
+    const QString temporary = job.object + QLatin1String(".tmp");
+    int exitCode = -1;
+    QStringList arguments = diagnosticOptions;
+    arguments << QStringLiteral("-c") << job.source << QStringLiteral("-o") << temporary;
+    DiagnosticParser parser;
+    bool ran = Builder::runTool(request.compiler, arguments + request.flags, cancel, nullptr, nullptr, &exitCode, nullptr,
+                                [&parser](const QByteArray &data) { parser.feed(data); });
+    parser.finish();
+    outcome.output = parser.text();
+    outcome.diagnostics = parser.diagnostics();
+    outcome.ok = ran && exitCode == 0;
+    if (outcome.ok) {
+        QFile::remove(job.object);
+        outcome.ok = QFile::rename(temporary, job.object);
+    }
+    if (!outcome.ok)
+        QFile::remove(temporary);
+    outcome.elapsed = timer.elapsed();
+    return outcome;
+}
+
+QJsonObject readManifest(const QString &path)
+{
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(in.readAll()).object();
+}
+
+void writeManifest(const QString &path, const QJsonObject &manifest)
+{
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return;
+    out.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+    out.commit();
+}
+
+} // namespace
+
+BuildResult buildProject(const BuildRequest &request, IncludeGraph *graph, const QAtomicInt *cancel)
+{
+    QElapsedTimer timer;
+    timer.start();
+    BuildResult result;
+    result.ok = false;
+    result.cacheHit = false;
+    result.elapsed = 0;
+    result.linkElapsed = -1;
+
+    QByteArray identity = Builder::compilerIdentity(request.compiler, cancel);
+    if (identity.isEmpty()) {
+        result.output = QObject::tr("无法启动编译器 ") + request.compiler + QLatin1Char('\n');
+        return result;
+    }
+
+    const QString root = QFileInfo(request.source).absolutePath();
+    QStringList sources;
+    walkProject(root, [&sources](const QFileInfo &info) {
+        if (isTranslationUnit(info))
+            sources.append(info.absoluteFilePath());
+        return sources.size() < MaxUnits;
+    }, cancel);
+    if (cancel->load())
+        return result;
+    if (sources.isEmpty()) {
+        result.output = QObject::tr("项目目录中没有可编译的源文件：") + root + QLatin1Char('\n');
+        return result;
+    }
+    std::sort(sources.begin(), sources.end());
+
+    QString directory = CompileCache::defaultDirectory(QLatin1String("projects/")
+        + QString::fromLatin1(QCryptographicHash::hash(root.toUtf8(), QCryptographicHash::Sha1).toHex()));
+    if (!request.configuration.isEmpty())
+        directory += QLatin1Char('/') + request.configuration;
+    QDir().mkpath(directory);
+    const QString manifestPath = directory + QLatin1String("/manifest.json");
+    QJsonObject manifest = readManifest(manifestPath);
+    QJsonObject signatures = manifest.value(QStringLiteral("units")).toObject();
+
+    // 逐个翻译单元求签名，依赖图只重新扫描变化了的文件
+    graph->setSearchPaths(IncludeGraph::searchPathsOf(request.flags, root));
+    graph->startPass();
+    QCryptographicHash options(QCryptographicHash::Sha1);
+    options.addData(identity);
+    for (const QString &flag : request.flags) {
+        options.addData("\0", 1);
+        options.addData(flag.toUtf8());
+    }
+    const QByteArray optionsHash = options.result();
+
+    QCryptographicHash linkKey(QCryptographicHash::Sha1);
+    linkKey.addData(optionsHash);
+    QVector<UnitJob> jobs;
+    QStringList objects;
+    QJsonObject current;
+    for (const QString &source : sources) {
+        UnitJob job;
+        job.source = source;
+        job.object = directory + QLatin1Char('/')
+                     + QString::fromLatin1(QCryptographicHash::hash(source.toUtf8(), QCryptographicHash::Sha1).toHex())
+                     + QLatin1String(".o");
+        job.signature = QString::fromLatin1(QCryptographicHash::hash(optionsHash + graph->signature(source),
+                                                                     QCryptographicHash::Sha1).toHex());
+        objects.append(job.object);
+        linkKey.addData(job.object.toUtf8());
+        linkKey.addData(job.signature.toLatin1());
+        if (signatures.value(source).toString() == job.signature && QFileInfo::exists(job.object)) {
+            current.insert(source, job.signature);
+            result.units.append({QDir(root).relativeFilePath(source), -1, true});
+        } else {
+            jobs.append(job);
+        }
+    }
+
+    // 过期的翻译单元并行编译，相当于 make -j
+    QThreadPool compilePool;
+    compilePool.setMaxThreadCount(QThread::idealThreadCount());
+    const QStringList diagnosticOptions = Builder::diagnosticOptions(request.compiler, identity, cancel);
+    QVector<QFuture<UnitOutcome>> futures;
+    for (const UnitJob &job : jobs)
+        futures.append(QtConcurrent::run(&compilePool, [request, diagnosticOptions, job, cancel] {
+            return compileUnit(request, diagnosticOptions, job, cancel);
+        }));
+    bool failed = false;
+    for (int i = 0; i < jobs.size(); ++i) {
+        UnitOutcome outcome = futures[i].result();
+        result.output += outcome.output;
+        result.diagnostics += outcome.diagnostics;
+        result.units.append({QDir(root).relativeFilePath(jobs.at(i).source), outcome.elapsed, outcome.ok});
+        if (outcome.ok)
+            current.insert(jobs.at(i).source, jobs.at(i).signature);
+        else
+            failed = true;
+    }
+    std::sort(result.units.begin(), result.units.end(), [](const UnitTiming &a, const UnitTiming &b) {
+        return a.file < b.file;
+    });
+    // 编译成功的目标文件即使这次构建失败也记下来，下次不必重新编译
+    manifest.insert(QStringLiteral("units"), current);
+    writeManifest(manifestPath, manifest);
+    result.elapsed = timer.elapsed();
+    if (failed || cancel->load())
+        return result;
+
+    // 所有目标文件与上次链接时一致且程序还在，就不必重新链接
+    const QString binary = directory + QLatin1String("/program");
+    const QString linkSignature = QString::fromLatin1(linkKey.result().toHex());
+    if (!jobs.isEmpty() || manifest.value(QStringLiteral("link")).toString() != linkSignature || !QFileInfo::exists(binary)) {
+        QElapsedTimer linkTimer;
+        linkTimer.start();
+        const QString temporary = binary + QLatin1String(".tmp");
+        QByteArray errors;
+        int exitCode = -1;
+        QStringList arguments = objects;
+        arguments << QStringLiteral("-o") << temporary;
+        bool ran = Builder::runTool(request.compiler, arguments + request.flags, cancel, nullptr, &errors, &exitCode);
+        // 链接器的输出是文本格式
+        DiagnosticParser parser;
+        parser.feed(errors);
+        parser.finish();
+        result.output += parser.text();
+        result.diagnostics += parser.diagnostics();
+        bool linked = ran && exitCode == 0;
+        if (linked) {
+            QFile::remove(binary);
+            linked = QFile::rename(temporary, binary);
+        }
+        if (!linked) {
+            QFile::remove(temporary);
+            result.elapsed = timer.elapsed();
+            return result;
+        }
+        result.linkElapsed = linkTimer.elapsed();
+        manifest.insert(QStringLiteral("link"), linkSignature);
+        writeManifest(manifestPath, manifest);
+    }
+
+    result.ok = true;
+    result.cacheHit = jobs.isEmpty() && result.linkElapsed < 0;
+    result.binary = binary;
+    result.elapsed = timer.elapsed();
+    return result;
+}
@@ -0,0 +1,13 @@
+#ifndef PROJECTBUILDER_H
+#define PROJECTBUILDER_H
+
+#include "builder.h"
+
+// 项目模式的构建：request.source 所在目录（遵循忽略规则）下的每个 .cpp/.cc/.cxx 作为一个翻译单元，
+// 分别编译为目标文件后链接。翻译单元的签名由编译器版本、选项以及它的 #include 闭包中
+// 各文件的大小与修改时间组成，签名没变的目标文件直接沿用；需要重新编译的翻译单元在多个核上并行编译，
+// 所有目标文件都没变时也不重新链接。目标文件与签名清单保存在按项目目录区分的缓存目录中，重启后依然有效。
+// 在构建线程中调用，graph 由调用者跨构建保留。
+BuildResult buildProject(const BuildRequest &request, IncludeGraph *graph, const QAtomicInt *cancel);
+
+#endif // PROJECTBUILDER_H
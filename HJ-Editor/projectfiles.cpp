@@ -0,0 +1,169 @@
+#include "projectfiles.h"
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+
+void IgnoreRules::addDirectory(const QString &directory)
+{
+    addFile(directory, QStringLiteral(".gitignore"));
+    addFile(directory, QStringLiteral(".ignore"));
+}
+
+void IgnoreRules::addAncestors(const QString &root, const QString &directory)
+{
+    QString dir = QDir(root).absolutePath();
+    const QString target = QDir(directory).absolutePath();
+    if (!target.startsWith(dir + QLatin1Char('/')))
+        return;
+    const QStringList parts = target.mid(dir.size() + 1).split(QLatin1Char('/'), QString::SkipEmptyParts);
+    for (const QString &part : parts) {
+        addDirectory(dir);
+        dir += QLatin1Char('/') + part;
+    }
+}
+
+void IgnoreRules::addFile(const QString &directory, const QString &fileName)
+{
+    QFile file(directory + QLatin1Char('/') + fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
+    QString base = directory.endsWith(QLatin1Char('/')) ? directory : directory + QLatin1Char('/');
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            continue;
+        Rule rule;
+        rule.base = base;
+        rule.negate = line.startsWith(QLatin1Char('!'));
+        if (rule.negate)
+            line.remove(0, 1);
+        rule.dirOnly = line.endsWith(QLatin1Char('/'));
+        if (rule.dirOnly)
+            line.chop(1);
+        // 含有 / 的规则相对于所在目录匹配，否则匹配任意层级的文件名
+        rule.matchPath = line.contains(QLatin1Char('/'));
+        if (line.startsWith(QLatin1Char('/')))
+            line.remove(0, 1);
+        if (line.isEmpty())
+            continue;
+        rule.pattern = QRegularExpression(globToRegex(line));
+        if (rule.pattern.isValid())
+            rules.append(rule);
+    }
+}
+
+bool IgnoreRules::isIgnored(const QString &path, bool isDir) const
+{
+    bool ignored = false;
+    QString name = path.mid(path.lastIndexOf(QLatin1Char('/')) + 1);
+    // 后面的规则覆盖前面的规则
+    for (const Rule &rule : rules) {
+        if (rule.dirOnly && !isDir)
+            continue;
+        // 只有可能改变当前结果的规则才需要匹配
+        if (rule.negate != ignored)
+            continue;
+        if (!path.startsWith(rule.base))
+            continue;
+        const QString subject = rule.matchPath ? path.mid(rule.base.size()) : name;
+        if (rule.pattern.match(subject).hasMatch())
+            ignored = !rule.negate;
+    }
+    return ignored;
+}
+
+int IgnoreRules::count() const
+{
+    return rules.size();
+}
+
+void IgnoreRules::truncate(int count)
+{
+    rules.resize(count);
+}
+
+QString IgnoreRules::globToRegex(const QString &glob)
+{
+    QString regex = QStringLiteral("^");
+    for (int i = 0; i < glob.size(); ++i) {
+        QChar c = glob.at(i);
+        if (c == QLatin1Char('*')) {
+            if (i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('*')) {
+                // ** 可以跨越目录；**/ 也可以匹配零层目录
+                ++i;
+                if (i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('/')) {
+                    ++i;
+                    regex += QStringLiteral("(?:.*/)?");
+                } else {
+                    regex += QStringLiteral(".*");
+                }
+            } else {
+                regex += QStringLiteral("[^/]*");
+            }
+        } else if (c == QLatin1Char('?')) {
+            regex += QStringLiteral("[^/]");
+        } else if (c == QLatin1Char('[')) {
+            int end = glob.indexOf(QLatin1Char(']'), i + 1);
+            if (end < 0) {
+                regex += QStringLiteral("\\[");
+            } else {
+                QString set = glob.mid(i + 1, end - i - 1);
+                if (set.startsWith(QLatin1Char('!')))
+                    set[0] = QLatin1Char('^');
+                regex += QLatin1Char('[') + set + QLatin1Char(']');
+                i = end;
+            }
+        } else {
+            regex += QRegularExpression::escape(QString(c));
+        }
+    }
+    // 匹配目录时也排除其下的所有内容
+    regex += QStringLiteral("(?:/.*)?$");
+    return regex;
+}
+
+void walkProject(const QString &root, const ProjectFileCallback &onFile, const QAtomicInt *cancel,
+                 const ProjectDirectoryCallback &onDirectory, const IgnoreRules *inherited)
+{
+    struct Pending {
+        QString path;
+        int ruleCount;  // 进入该目录之前的规则数
+    };
+    IgnoreRules rules = inherited ? *inherited : IgnoreRules();
+    QVector<Pending> stack;
+    stack.append({QDir(root).absolutePath(), rules.count()});
+
+    while (!stack.isEmpty()) {
+        if (cancel && cancel->loadAcquire())
+            return;
+        Pending current = stack.takeLast();
+        rules.truncate(current.ruleCount);
+        rules.addDirectory(current.path);
+        int ruleCount = rules.count();
+
+        QDir dir(current.path);
+        const QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks,
+                                                        QDir::Name);
+        QVector<Pending> subdirs;
+        for (const QFileInfo &info : entries) {
+            const QString path = info.absoluteFilePath();
+            if (info.isDir()) {
+                const QString name = info.fileName();
+                if (name == QLatin1String(".git") || name == QLatin1String(".hg") || name == QLatin1String(".svn"))
+                    continue;
+                if (!rules.isIgnored(path, true)) {
+                    if (onDirectory)
+                        onDirectory(info);
+                    subdirs.append({path, ruleCount});
+                }
+            } else if (info.isFile() && !rules.isIgnored(path, false)) {
+                if (!onFile(info))
+                    return;
+            }
+        }
+        // 逆序入栈，保证按名称顺序深度优先遍历
+        for (int i = subdirs.size() - 1; i >= 0; --i)
+            stack.append(subdirs.at(i));
+    }
+}
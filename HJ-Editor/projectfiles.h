@@ -0,0 +1,46 @@
+#ifndef PROJECTFILES_H
+#define PROJECTFILES_H
+
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+#include <QAtomicInt>
+#include <QFileInfo>
+#include <functional>
+
+// 忽略规则：支持 .gitignore / .ignore 的常用语法（通配符、**、前导 /、结尾 /、! 取反）
+class IgnoreRules
+{
+public:
+    // 读取 directory 下的 .gitignore 与 .ignore，规则相对于该目录
+    void addDirectory(const QString &directory);
+    // 依次读取从 root 到 directory（不含）各级目录的规则，用于从中间目录开始判断
+    void addAncestors(const QString &root, const QString &directory);
+    bool isIgnored(const QString &path, bool isDir) const;
+    int count() const;
+    void truncate(int count);  // 离开目录时丢弃其规则
+
+private:
+    struct Rule {
+        QString base;            // 规则所在目录，以 / 结尾
+        QRegularExpression pattern;
+        bool negate;
+        bool dirOnly;
+        bool matchPath;          // 含 / 的规则匹配相对路径，否则只匹配文件名
+    };
+    void addFile(const QString &directory, const QString &fileName);
+    static QString globToRegex(const QString &glob);
+
+    QVector<Rule> rules;
+};
+
+// 遍历项目目录：跳过 .git 等版本库目录、忽略文件中排除的路径以及符号链接。
+// onFile 返回 false 或 cancel 被置位时停止遍历。onDirectory 在进入每个子目录前调用；
+// inherited 是 root 上层目录的规则，从项目中间的目录开始遍历时传入。
+typedef std::function<bool(const QFileInfo &info)> ProjectFileCallback;
+typedef std::function<void(const QFileInfo &info)> ProjectDirectoryCallback;
+void walkProject(const QString &root, const ProjectFileCallback &onFile, const QAtomicInt *cancel = nullptr,
+                 const ProjectDirectoryCallback &onDirectory = ProjectDirectoryCallback(),
+                 const IgnoreRules *inherited = nullptr);
+
+#endif // PROJECTFILES_H
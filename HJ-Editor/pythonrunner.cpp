@@ -0,0 +1,377 @@
+#include "pythonrunner.h"
+#include <QProcessEnvironment>
+#include <QSettings>
+#include <QCoreApplication>
+#include <QFile>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 常驻解释器的引导脚本：从标准输入读取“\x1eHJ-RUN 标记 字节数\n路径\n代码”，执行后写出“\x1eHJ-DONE 标记 退出码 是否重启\n”
+const char Bootstrap[] = R"python(
+import builtins, io, os, sys, threading, traceback, types
+
+def run(path, code, requests):
+    directory = os.path.dirname(os.path.abspath(path))
+    # 与脚本同目录的模块可能刚被修改，每次重新导入
+    for name, module in list(sys.modules.items()):
+        file = getattr(module, '__file__', None)
+        if file and os.path.abspath(file).startswith(directory + os.sep):
+            del sys.modules[name]
+    main = types.ModuleType('__main__')
+    main.__file__ = path
+    main.__builtins__ = builtins
+    saved = (sys.argv, sys.path[:], sys.modules['__main__'], os.getcwd(), sys.stdin, sys.stdout, sys.stderr)
+    # 每次运行用新的文本包装读取标准输入，上一次预读而未用完的输入随之丢弃
+    sys.stdin = io.TextIOWrapper(requests, encoding='utf-8', line_buffering=True)
+    sys.argv = [path]
+    sys.path.insert(0, directory)
+    sys.modules['__main__'] = main
+    os.chdir(directory)
+    status = 0
+    try:
+        exec(compile(code, path, 'exec'), main.__dict__)
+    except SystemExit as exit:
+        if exit.code is None:
+            status = 0
+        elif isinstance(exit.code, int):
+            status = exit.code
+        else:
+            print(exit.code, file=sys.stderr)
+            status = 1
+    except BaseException:
+        kind, value, trace = sys.exc_info()
+        traceback.print_exception(kind, value, trace.tb_next)
+        status = 1
+    finally:
+        for stream in (sys.stdout, sys.stderr):
+            try:
+                stream.flush()
+            except Exception:
+                pass
+        try:
+            sys.stdin.detach()
+        except Exception:
+            pass
+        sys.argv, sys.path[:], sys.modules['__main__'] = saved[0], saved[1], saved[2]
+        os.chdir(saved[3])
+        sys.stdin, sys.stdout, sys.stderr = saved[4], saved[5], saved[6]
+    return status
+
+def serve():
+    requests = sys.stdin.buffer
+    while True:
+        line = requests.readline()
+        if not line:
+            return
+        if not line.startswith(b'\x1eHJ-RUN '):
+            continue  # 上一个脚本没有读完的输入
+        _, token, size = line.split()
+        path = requests.readline().decode('utf-8').rstrip('\r\n')
+        code = requests.read(int(size)).decode('utf-8')
+        status = run(path, code, requests)
+        restart = threading.active_count() > 1
+        sys.stderr.flush()
+        sys.stdout.write('\x1eHJ-DONE %s %d %d\n' % (token.decode(), status, int(restart)))
+        sys.stdout.flush()
+        if restart:
+            return
+
+serve()
+)python";
+
+const char DoneMarker[] = "\x1eHJ-DONE ";
+const int LimitCheckInterval = 100;   // 毫秒
+
+// 进程已用的 CPU 时间（毫秒，用户态加内核态），/proc/<pid>/stat 的第 14、15 项；无法取得时返回 -1
+qint64 processCpuTime(qint64 pid)
+{
+#ifdef Q_OS_LINUX
+    QFile file(QStringLiteral("/proc/%1/stat").arg(pid));
+    if (pid <= 0 || !file.open(QIODevice::ReadOnly))
+        return -1;
+    const QByteArray stat = file.readAll();
+    // 进程名可能含空格，从最后一个右括号之后数起，第 3 项开始
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13)
+        return -1;
+    const long hertz = sysconf(_SC_CLK_TCK);
+    if (hertz <= 0)
+        return -1;
+    return (fields.at(11).toLongLong() + fields.at(12).toLongLong()) * 1000 / hertz;
+#else
+    Q_UNUSED(pid);
+    return -1;
+#endif
+}
+
+// 在子进程 exec 之前设置地址空间限制（Qt 5 只能通过重写 setupChildProcess 做到）
+class LimitedProcess : public QProcess
+{
+public:
+    LimitedProcess(qint64 addressSpace, QObject *parent) : QProcess(parent), addressSpace(addressSpace) {}
+
+protected:
+#ifdef Q_OS_UNIX
+    void setupChildProcess() override
+    {
+        if (addressSpace > 0) {
+            rlimit limit;
+            limit.rlim_cur = limit.rlim_max = rlim_t(addressSpace);
+            ::setrlimit(RLIMIT_AS, &limit);
+        }
+    }
+#endif
+
+private:
+    qint64 addressSpace;
+};
+
+} // namespace
+
+PythonRunner::PythonRunner(QObject *parent) : QObject(parent)
+{
+    worker = nullptr;
+    running = false;
+    warmRun = false;
+    serial = 0;
+    workerMemory = 0;
+    outputBytes = 0;
+    cpuAtStart = -1;
+    limits = RunLimits::load();
+    limitTimer.setInterval(LimitCheckInterval);
+    connect(&limitTimer, &QTimer::timeout, this, &PythonRunner::checkLimits);
+}
+
+PythonRunner::~PythonRunner()
+{
+    running = false;
+    discardWorker();
+}
+
+QString PythonRunner::interpreter()
+{
+#ifdef Q_OS_WIN
+    const QString fallback = QStringLiteral("python");
+#else
+    const QString fallback = QStringLiteral("python3");
+#endif
+    return QSettings().value(QStringLiteral("python/interpreter"), fallback).toString();
+}
+
+qint64 PythonRunner::memoryLimitSetting()
+{
+    const RunLimits current = RunLimits::load();
+    return current.enabled && current.memory > 0 ? qint64(current.memory) << 20 : 0;
+}
+
+// 按设置中的内存限制启动，运行时限制不同则在 run 中重新启动
+void PythonRunner::warmUp()
+{
+    if (worker)
+        return;
+    workerMemory = memoryLimitSetting();
+    worker = new LimitedProcess(workerMemory, this);
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("PYTHONIOENCODING"), QStringLiteral("utf-8"));
+    environment.insert(QStringLiteral("PYTHONUNBUFFERED"), QStringLiteral("1"));
+    worker->setProcessEnvironment(environment);
+    connect(worker, &QProcess::readyReadStandardOutput, this, &PythonRunner::readOutput);
+    connect(worker, &QProcess::readyReadStandardError, this, &PythonRunner::readError);
+    connect(worker, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+            this, &PythonRunner::workerFinished);
+    connect(worker, &QProcess::errorOccurred, this, &PythonRunner::workerError);
+    worker->start(interpreter(), QStringList() << QStringLiteral("-u") << QStringLiteral("-c")
+                                               << QString::fromUtf8(Bootstrap));
+}
+
+// 解释器还在启动时请求先写入管道，启动完成后自然读到
+void PythonRunner::run(const QString &path, const QString &code, const RunLimits &limits)
+{
+    this->limits = limits;
+    const qint64 memory = limits.enabled && limits.memory > 0 ? qint64(limits.memory) << 20 : 0;
+    if (worker && workerMemory != memory)
+        discardWorker();
+    warmRun = worker && worker->state() == QProcess::Running;
+    warmUp();
+    running = true;
+    pending.clear();
+    outputBytes = 0;
+    cpuAtStart = warmRun ? processCpuTime(worker->processId()) : 0;
+    if (limits.enabled && (limits.wallTime > 0 || limits.cpuTime > 0 || limits.output > 0))
+        limitTimer.start();
+    const QByteArray token = QByteArray::number(QCoreApplication::applicationPid()) + '-' + QByteArray::number(++serial);
+    marker = QByteArray(DoneMarker) + token + ' ';
+    const QByteArray source = code.toUtf8();
+    timer.start();
+    worker->write("\x1eHJ-RUN " + token + ' ' + QByteArray::number(source.size()) + '\n'
+                  + path.toUtf8() + '\n' + source);
+}
+
+void PythonRunner::write(const QByteArray &data)
+{
+    if (running && worker)
+        worker->write(data);
+}
+
+void PythonRunner::stop()
+{
+    if (!running)
+        return;
+    running = false;
+    limitTimer.stop();
+    discardWorker();
+    warmUp();   // 换一个干净的解释器，下次运行仍然是热的
+}
+
+// 冷启动时解释器自身的启动时间也计入 CPU 时间，与编译运行时包含程序的启动一样
+void PythonRunner::checkLimits()
+{
+    if (!running || !worker) {
+        limitTimer.stop();
+        return;
+    }
+    if (limits.wallTime > 0 && timer.elapsed() > limits.wallTime) {
+        abortRun(RunProfile::TimeLimitExceeded);
+        return;
+    }
+    if (limits.cpuTime > 0 && cpuAtStart >= 0) {
+        const qint64 used = processCpuTime(worker->processId());
+        if (used >= 0 && used - cpuAtStart > limits.cpuTime)
+            abortRun(RunProfile::TimeLimitExceeded);
+    }
+}
+
+// 超出限制：丢弃解释器（连同脚本留下的一切）并换一个新的
+void PythonRunner::abortRun(RunProfile::Verdict verdict)
+{
+    running = false;
+    limitTimer.stop();
+    pending.clear();
+    discardWorker();
+    warmUp();
+    emit finished(-1, timer.elapsed(), warmRun, verdict);
+}
+
+void PythonRunner::forwardOutput(const QByteArray &data)
+{
+    const qint64 outputLimit = limits.enabled && limits.output > 0 ? qint64(limits.output) << 20 : 0;
+    if (outputLimit > 0 && outputBytes + data.size() > outputLimit) {
+        emit standardOutput(data.left(int(outputLimit - outputBytes)));
+        outputBytes = outputLimit;
+        abortRun(RunProfile::OutputLimitExceeded);
+        return;
+    }
+    outputBytes += data.size();
+    emit standardOutput(data);
+}
+
+bool PythonRunner::isRunning() const
+{
+    return running;
+}
+
+void PythonRunner::discardWorker()
+{
+    if (!worker)
+        return;
+    QProcess *old = worker;
+    worker = nullptr;
+    old->disconnect(this);
+    old->kill();
+    old->waitForFinished(1000);
+    old->deleteLater();
+}
+
+// 结束标记可能被拆在两次读取之间，末尾可能是标记开头的部分先留着
+void PythonRunner::readOutput()
+{
+    QByteArray data = pending + worker->readAllStandardOutput();
+    pending.clear();
+    if (!running)
+        return;   // 两次运行之间（如脚本留下的线程）的输出不属于任何一次运行
+    int at = data.indexOf(marker);
+    if (at >= 0) {
+        int end = data.indexOf('\n', at);
+        if (end < 0) {
+            pending = data.mid(at);
+            if (at > 0)
+                forwardOutput(data.left(at));
+            return;
+        }
+        if (at > 0)
+            forwardOutput(data.left(at));
+        if (!running)
+            return;   // 结束标记之前的输出已经超出限制
+        const QList<QByteArray> fields = data.mid(at + marker.size(), end - at - marker.size()).trimmed().split(' ');
+        finishRun(fields.value(0).toInt(), fields.value(1) == "1");
+        return;
+    }
+    int partial = data.lastIndexOf('\x1e');
+    if (partial >= 0 && marker.startsWith(data.mid(partial))) {
+        pending = data.mid(partial);
+        data.truncate(partial);
+    }
+    if (!data.isEmpty())
+        forwardOutput(data);
+}
+
+void PythonRunner::readError()
+{
+    QByteArray data = worker->readAllStandardError();
+    if (running && !data.isEmpty())
+        emit standardError(data);
+}
+
+void PythonRunner::finishRun(int exitCode, bool restart)
+{
+    running = false;
+    limitTimer.stop();
+    // 结束标记之前写出的标准错误可能还没读到
+    if (worker) {
+        QByteArray rest = worker->readAllStandardError();
+        if (!rest.isEmpty())
+            emit standardError(rest);
+    }
+    if (restart) {
+        discardWorker();
+        warmUp();
+    }
+    emit finished(exitCode, timer.elapsed(), warmRun, exitCode == 0 ? RunProfile::Finished : RunProfile::RuntimeError);
+}
+
+// 脚本调用了 os._exit 或解释器崩溃
+void PythonRunner::workerFinished()
+{
+    QProcess *process = worker;
+    worker = nullptr;
+    if (process) {
+        process->disconnect(this);
+        process->deleteLater();
+    }
+    if (!running)
+        return;
+    running = false;
+    limitTimer.stop();
+    const int exitCode = process && process->exitStatus() == QProcess::NormalExit ? process->exitCode() : -1;
+    emit finished(exitCode, timer.elapsed(), warmRun, exitCode == 0 ? RunProfile::Finished : RunProfile::RuntimeError);
+}
+
+void PythonRunner::workerError(QProcess::ProcessError error)
+{
+    if (error != QProcess::FailedToStart)
+        return;
+    emit standardError(tr("无法启动 Python 解释器 %1：%2\n").arg(interpreter(), worker->errorString()).toUtf8());
+    QProcess *process = worker;
+    worker = nullptr;
+    process->disconnect(this);
+    process->deleteLater();
+    if (running) {
+        running = false;
+        limitTimer.stop();
+        emit finished(-1, timer.elapsed(), false, RunProfile::RuntimeError);
+    }
+}
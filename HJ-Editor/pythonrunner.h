@@ -0,0 +1,72 @@
+#ifndef PYTHONRUNNER_H
+#define PYTHONRUNNER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "runprofiler.h"
+
+// 运行 Python 文件：预先启动一个常驻的解释器进程，每次运行把缓冲区内容发给它，
+// 在全新的 __main__ 命名空间中执行，省去启动解释器与重复导入模块的时间。
+// 标准输出与标准错误原样转发，脚本结束后解释器在标准输出上写一行结束标记（含退出码）。
+// 与脚本同目录的模块每次重新导入，其他已导入的模块保留；脚本留下了未结束的线程、
+// 或解释器异常退出、或被停止时，丢弃该进程并重新冷启动一个。
+// 运行限制（RunLimits）由这里执行：墙钟时间、CPU 时间（Linux，按解释器进程的 CPU 时间增量）与标准输出
+// 每 100 ms 检查一次，超出时结束解释器并换一个新的；内存限制在启动解释器时以 RLIMIT_AS 设置（Unix），
+// 限制值变化时重新启动解释器。
+class PythonRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PythonRunner(QObject *parent = nullptr);
+    ~PythonRunner();
+
+    // 启动解释器，已启动时什么都不做
+    void warmUp();
+    void run(const QString &path, const QString &code, const RunLimits &limits);
+    // 脚本的标准输入
+    void write(const QByteArray &data);
+    // 结束当前脚本（连同解释器），不再发出 finished
+    void stop();
+    bool isRunning() const;
+
+    // QSettings 的 python/interpreter，默认为 python3（Windows 上为 python）
+    static QString interpreter();
+
+signals:
+    void standardOutput(const QByteArray &data);
+    void standardError(const QByteArray &data);
+    // warm 表示运行时解释器已经预热好；超出限制时 exitCode 为 -1
+    void finished(int exitCode, qint64 elapsed, bool warm, RunProfile::Verdict verdict);
+
+private slots:
+    void readOutput();
+    void readError();
+    void workerFinished();
+    void workerError(QProcess::ProcessError error);
+    void checkLimits();
+
+private:
+    void discardWorker();
+    void finishRun(int exitCode, bool restart);
+    void forwardOutput(const QByteArray &data);
+    void abortRun(RunProfile::Verdict verdict);
+    static qint64 memoryLimitSetting();
+
+    QProcess *worker;
+    bool running;
+    bool warmRun;
+    QByteArray marker;   // 本次运行的结束标记
+    QByteArray pending;  // 可能是结束标记开头、暂不转发的输出
+    int serial;
+    QElapsedTimer timer;
+    qint64 workerMemory;   // 解释器启动时设置的 RLIMIT_AS（字节），0 表示不限
+    RunLimits limits;      // 本次运行的限制
+    qint64 outputBytes;
+    qint64 cpuAtStart;     // 毫秒，本次运行开始时解释器已用的 CPU 时间，-1 表示无法取得
+    QTimer limitTimer;
+};
+
+#endif // PYTHONRUNNER_H
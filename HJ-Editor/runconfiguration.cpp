@@ -0,0 +1,109 @@
+#include "runconfiguration.h"
+#include <QSettings>
+#include <QUuid>
+
+namespace {
+
+RunConfiguration builtin(const char *id, const QString &name, const QStringList &flags)
+{
+    RunConfiguration configuration;
+    configuration.id = QLatin1String(id);
+    configuration.name = name;
+    configuration.flags = flags;
+    configuration.builtin = true;
+    return configuration;
+}
+
+QVector<RunConfiguration> builtins()
+{
+    QVector<RunConfiguration> configurations;
+    configurations.append(builtin("debug", QStringLiteral("Debug"),
+                                  QStringList() << QStringLiteral("-O0") << QStringLiteral("-g")));
+    configurations.append(builtin("o2", QStringLiteral("-O2"), QStringList() << QStringLiteral("-O2")));
+    configurations.append(builtin("o3-native", QStringLiteral("-O3 -march=native"),
+                                  QStringList() << QStringLiteral("-O3") << QStringLiteral("-march=native")));
+    configurations.append(builtin("sanitize", QStringLiteral("ASan/UBSan"),
+                                  QStringList() << QStringLiteral("-O1") << QStringLiteral("-g")
+                                                << QStringLiteral("-fsanitize=address,undefined")
+                                                << QStringLiteral("-fno-omit-frame-pointer")));
+    configurations.append(builtin("lto", QStringLiteral("LTO"),
+                                  QStringList() << QStringLiteral("-O2") << QStringLiteral("-flto")));
+    return configurations;
+}
+
+} // namespace
+
+QStringList RunConfiguration::compilerFlags() const
+{
+    QStringList result;
+    if (!standard.isEmpty())
+        result << QStringLiteral("-std=") + standard;
+    for (const QString &define : defines)
+        result << QStringLiteral("-D") + define;
+    return result + flags;
+}
+
+QVector<RunConfiguration> RunConfiguration::all()
+{
+    QVector<RunConfiguration> configurations = builtins();
+    QSettings settings;
+    int count = settings.beginReadArray(QStringLiteral("runConfigurations"));
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        RunConfiguration configuration;
+        configuration.id = settings.value(QStringLiteral("id")).toString();
+        configuration.name = settings.value(QStringLiteral("name")).toString();
+        configuration.standard = settings.value(QStringLiteral("standard")).toString();
+        configuration.defines = settings.value(QStringLiteral("defines")).toStringList();
+        configuration.flags = settings.value(QStringLiteral("flags")).toStringList();
+        configuration.builtin = false;
+        if (!configuration.id.isEmpty() && !configuration.name.isEmpty())
+            configurations.append(configuration);
+    }
+    settings.endArray();
+    return configurations;
+}
+
+RunConfiguration RunConfiguration::find(const QString &id)
+{
+    const QVector<RunConfiguration> configurations = all();
+    for (const RunConfiguration &configuration : configurations) {
+        if (configuration.id == id)
+            return configuration;
+    }
+    return configurations.first();
+}
+
+QString RunConfiguration::currentId()
+{
+    return QSettings().value(QStringLiteral("build/configuration"), QStringLiteral("debug")).toString();
+}
+
+void RunConfiguration::setCurrentId(const QString &id)
+{
+    QSettings().setValue(QStringLiteral("build/configuration"), id);
+}
+
+// 只保存自定义配置，内置配置不可修改
+void RunConfiguration::saveCustom(const QVector<RunConfiguration> &configurations)
+{
+    QSettings settings;
+    settings.beginWriteArray(QStringLiteral("runConfigurations"));
+    int index = 0;
+    for (const RunConfiguration &configuration : configurations) {
+        if (configuration.builtin)
+            continue;
+        settings.setArrayIndex(index++);
+        settings.setValue(QStringLiteral("id"), configuration.id);
+        settings.setValue(QStringLiteral("name"), configuration.name);
+        settings.setValue(QStringLiteral("standard"), configuration.standard);
+        settings.setValue(QStringLiteral("defines"), configuration.defines);
+        settings.setValue(QStringLiteral("flags"), configuration.flags);
+    }
+    settings.endArray();
+}
+
+QString RunConfiguration::newId()
+{
+    return QStringLiteral("custom-") + QUuid::createUuid().toString().mid(1, 8);
+}
@@ -0,0 +1,31 @@
+#ifndef RUNCONFIGURATION_H
+#define RUNCONFIGURATION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 命名的运行配置：一组编译选项。内置 Debug、-O2、-O3 -march=native、ASan/UBSan、LTO 五种，
+// 另可添加自定义配置（指定 -std 版本、宏定义与其他选项），保存在 QSettings 的 runConfigurations 中。
+// 每种配置的编译缓存放在各自的子目录（以 id 命名），切换配置不会挤掉其他配置的缓存。
+struct RunConfiguration {
+    QString id;          // 缓存子目录名，只含 ASCII 字母、数字与 -
+    QString name;        // 显示名
+    QString standard;    // 如 c++17，空表示编译器默认
+    QStringList defines; // NAME 或 NAME=VALUE
+    QStringList flags;
+    bool builtin;
+
+    // 传给编译器的完整选项
+    QStringList compilerFlags() const;
+
+    static QVector<RunConfiguration> all();
+    // 找不到时返回第一个内置配置（Debug）
+    static RunConfiguration find(const QString &id);
+    static QString currentId();
+    static void setCurrentId(const QString &id);
+    static void saveCustom(const QVector<RunConfiguration> &configurations);
+    static QString newId();
+};
+
+#endif // RUNCONFIGURATION_H
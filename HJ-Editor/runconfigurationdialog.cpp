@@ -0,0 +1,159 @@
+#include "runconfigurationdialog.h"
+#include <QListWidget>
+#include <QLineEdit>
+#include <QComboBox>
+#include <QPushButton>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QRegularExpression>
+
+namespace {
+
+QStringList splitWords(const QString &text)
+{
+    return text.split(QRegularExpression(QStringLiteral("\\s+")), QString::SkipEmptyParts);
+}
+
+} // namespace
+
+RunConfigurationDialog::RunConfigurationDialog(QWidget *parent) : QDialog(parent)
+{
+    setWindowTitle("编辑运行配置");
+
+    list = new QListWidget(this);
+    nameEdit = new QLineEdit(this);
+    standardBox = new QComboBox(this);
+    definesEdit = new QLineEdit(this);
+    flagsEdit = new QLineEdit(this);
+    QPushButton *addButton = new QPushButton("新建", this);
+    QPushButton *duplicateButton = new QPushButton("复制", this);
+    removeButton = new QPushButton("删除", this);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    // 第一项为编译器默认的标准
+    standardBox->addItem("编译器默认", QString());
+    const char *standards[] = {"c++11", "c++14", "c++17", "c++20", "c++23", "gnu++17", "gnu++20"};
+    for (const char *standard : standards)
+        standardBox->addItem(QLatin1String(standard), QLatin1String(standard));
+    definesEdit->setPlaceholderText("以空格分隔，如 LOCAL N=100");
+    flagsEdit->setPlaceholderText("以空格分隔，如 -O2 -Wall");
+
+    QVBoxLayout *buttonLayout = new QVBoxLayout;
+    buttonLayout->addWidget(addButton);
+    buttonLayout->addWidget(duplicateButton);
+    buttonLayout->addWidget(removeButton);
+    buttonLayout->addStretch();
+    QHBoxLayout *listLayout = new QHBoxLayout;
+    listLayout->addWidget(list);
+    listLayout->addLayout(buttonLayout);
+    QFormLayout *form = new QFormLayout;
+    form->addRow("名称:", nameEdit);
+    form->addRow("C++ 标准:", standardBox);
+    form->addRow("宏定义:", definesEdit);
+    form->addRow("编译选项:", flagsEdit);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(listLayout);
+    mainLayout->addLayout(form);
+    mainLayout->addWidget(buttons);
+    setLayout(mainLayout);
+    resize(520, 420);
+
+    currentRow = -1;
+    for (const RunConfiguration &configuration : RunConfiguration::all())
+        appendConfiguration(configuration);
+
+    connect(list, &QListWidget::currentRowChanged, this, &RunConfigurationDialog::selectConfiguration);
+    connect(addButton, &QPushButton::clicked, this, &RunConfigurationDialog::addConfiguration);
+    connect(duplicateButton, &QPushButton::clicked, this, &RunConfigurationDialog::duplicateConfiguration);
+    connect(removeButton, &QPushButton::clicked, this, &RunConfigurationDialog::removeConfiguration);
+    connect(buttons, &QDialogButtonBox::accepted, this, [this] {
+        storeEdits();
+        RunConfiguration::saveCustom(items);
+        accept();
+    });
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    list->setCurrentRow(0);
+}
+
+void RunConfigurationDialog::appendConfiguration(const RunConfiguration &configuration)
+{
+    items.append(configuration);
+    list->addItem(configuration.builtin ? configuration.name + QStringLiteral("（内置）") : configuration.name);
+}
+
+// 切换选中项之前先把编辑框中的内容存回上一项
+void RunConfigurationDialog::selectConfiguration(int row)
+{
+    storeEdits();
+    currentRow = row;
+    if (row < 0 || row >= items.size())
+        return;
+    const RunConfiguration &configuration = items.at(row);
+    nameEdit->setText(configuration.name);
+    int index = standardBox->findData(configuration.standard);
+    if (index < 0) {
+        standardBox->addItem(configuration.standard, configuration.standard);
+        index = standardBox->count() - 1;
+    }
+    standardBox->setCurrentIndex(index);
+    definesEdit->setText(configuration.defines.join(QLatin1Char(' ')));
+    flagsEdit->setText(configuration.flags.join(QLatin1Char(' ')));
+    const bool editable = !configuration.builtin;
+    nameEdit->setReadOnly(!editable);
+    standardBox->setEnabled(editable);
+    definesEdit->setReadOnly(!editable);
+    flagsEdit->setReadOnly(!editable);
+    removeButton->setEnabled(editable);
+}
+
+void RunConfigurationDialog::storeEdits()
+{
+    if (currentRow < 0 || currentRow >= items.size() || items.at(currentRow).builtin)
+        return;
+    RunConfiguration &configuration = items[currentRow];
+    QString name = nameEdit->text().trimmed();
+    if (!name.isEmpty())
+        configuration.name = name;
+    configuration.standard = standardBox->currentData().toString();
+    configuration.defines = splitWords(definesEdit->text());
+    configuration.flags = splitWords(flagsEdit->text());
+    list->item(currentRow)->setText(configuration.name);
+}
+
+void RunConfigurationDialog::addConfiguration()
+{
+    RunConfiguration configuration;
+    configuration.id = RunConfiguration::newId();
+    configuration.name = tr("自定义 %1").arg(items.size() + 1);
+    configuration.builtin = false;
+    appendConfiguration(configuration);
+    list->setCurrentRow(items.size() - 1);
+    nameEdit->setFocus();
+    nameEdit->selectAll();
+}
+
+// 以选中的配置（可以是内置的）为模板新建
+void RunConfigurationDialog::duplicateConfiguration()
+{
+    if (currentRow < 0)
+        return;
+    storeEdits();
+    RunConfiguration configuration = items.at(currentRow);
+    configuration.id = RunConfiguration::newId();
+    configuration.name = tr("%1 副本").arg(configuration.name);
+    configuration.builtin = false;
+    appendConfiguration(configuration);
+    list->setCurrentRow(items.size() - 1);
+}
+
+void RunConfigurationDialog::removeConfiguration()
+{
+    if (currentRow < 0 || items.at(currentRow).builtin)
+        return;
+    int row = currentRow;
+    currentRow = -1;   // 不再把编辑框的内容存回被删除的项
+    items.remove(row);
+    delete list->takeItem(row);
+}
@@ -0,0 +1,43 @@
+#ifndef RUNCONFIGURATIONDIALOG_H
+#define RUNCONFIGURATIONDIALOG_H
+
+#include <QDialog>
+#include "runconfiguration.h"
+
+QT_BEGIN_NAMESPACE
+class QListWidget;
+class QLineEdit;
+class QComboBox;
+class QPushButton;
+QT_END_NAMESPACE
+
+// “编辑运行配置”：查看内置配置，新建、复制、删除自定义配置。
+// 确定时才写入 QSettings，内置配置只能查看
+class RunConfigurationDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RunConfigurationDialog(QWidget *parent = nullptr);
+
+private slots:
+    void selectConfiguration(int row);
+    void addConfiguration();
+    void duplicateConfiguration();
+    void removeConfiguration();
+    void storeEdits();
+
+private:
+    void appendConfiguration(const RunConfiguration &configuration);
+
+    QVector<RunConfiguration> items;   // 与列表中的顺序一致
+    int currentRow;
+    QListWidget *list;
+    QLineEdit *nameEdit;
+    QComboBox *standardBox;
+    QLineEdit *definesEdit;
+    QLineEdit *flagsEdit;
+    QPushButton *removeButton;
+};
+
+#endif // RUNCONFIGURATIONDIALOG_H
@@ -0,0 +1,79 @@
+#include "runlimitsdialog.h"
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QVBoxLayout>
+
+RunLimitsDialog::RunLimitsDialog(QWidget *parent) : QDialog(parent)
+{
+    setWindowTitle("运行限制");
+
+    enabledCheckBox = new QCheckBox("限制运行、测试用例与性能分析运行的资源", this);
+    cpuBox = new QSpinBox(this);
+    wallBox = new QSpinBox(this);
+    memoryBox = new QSpinBox(this);
+    outputBox = new QSpinBox(this);
+    QLabel *note = new QLabel("0 表示不限制。墙钟时间包括等待输入的时间，交互运行时一般不设。\n"
+                              "内存优先用 cgroup 限制常驻内存，不可用时改为限制地址空间"
+                              "（ASan 程序不限制地址空间，只在结束后按峰值内存判定）。", this);
+    note->setWordWrap(true);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    cpuBox->setRange(0, 3600000);
+    cpuBox->setSingleStep(500);
+    cpuBox->setSuffix(" ms");
+    wallBox->setRange(0, 3600000);
+    wallBox->setSingleStep(500);
+    wallBox->setSuffix(" ms");
+    memoryBox->setRange(0, 1048576);
+    memoryBox->setSingleStep(64);
+    memoryBox->setSuffix(" MB");
+    outputBox->setRange(0, 1048576);
+    outputBox->setSingleStep(16);
+    outputBox->setSuffix(" MB");
+
+    QFormLayout *form = new QFormLayout;
+    form->addRow(enabledCheckBox);
+    form->addRow("CPU 时间:", cpuBox);
+    form->addRow("墙钟时间:", wallBox);
+    form->addRow("内存:", memoryBox);
+    form->addRow("标准输出:", outputBox);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addLayout(form);
+    mainLayout->addWidget(note);
+    mainLayout->addWidget(buttons);
+    setLayout(mainLayout);
+
+    connect(enabledCheckBox, &QCheckBox::toggled, cpuBox, &QSpinBox::setEnabled);
+    connect(enabledCheckBox, &QCheckBox::toggled, wallBox, &QSpinBox::setEnabled);
+    connect(enabledCheckBox, &QCheckBox::toggled, memoryBox, &QSpinBox::setEnabled);
+    connect(enabledCheckBox, &QCheckBox::toggled, outputBox, &QSpinBox::setEnabled);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+}
+
+void RunLimitsDialog::setLimits(const RunLimits &limits)
+{
+    enabledCheckBox->setChecked(limits.enabled);
+    cpuBox->setValue(limits.cpuTime);
+    wallBox->setValue(limits.wallTime);
+    memoryBox->setValue(limits.memory);
+    outputBox->setValue(limits.output);
+    cpuBox->setEnabled(limits.enabled);
+    wallBox->setEnabled(limits.enabled);
+    memoryBox->setEnabled(limits.enabled);
+    outputBox->setEnabled(limits.enabled);
+}
+
+RunLimits RunLimitsDialog::limits() const
+{
+    RunLimits limits;
+    limits.enabled = enabledCheckBox->isChecked();
+    limits.cpuTime = cpuBox->value();
+    limits.wallTime = wallBox->value();
+    limits.memory = memoryBox->value();
+    limits.output = outputBox->value();
+    return limits;
+}
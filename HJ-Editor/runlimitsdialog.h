@@ -0,0 +1,30 @@
+#ifndef RUNLIMITSDIALOG_H
+#define RUNLIMITSDIALOG_H
+
+#include <QDialog>
+#include "runprofiler.h"
+
+QT_BEGIN_NAMESPACE
+class QCheckBox;
+class QSpinBox;
+QT_END_NAMESPACE
+
+// “运行限制”：CPU 时间、墙钟时间、内存与输出的上限，0 表示不限制
+class RunLimitsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RunLimitsDialog(QWidget *parent = nullptr);
+    void setLimits(const RunLimits &limits);
+    RunLimits limits() const;
+
+private:
+    QCheckBox *enabledCheckBox;
+    QSpinBox *cpuBox;
+    QSpinBox *wallBox;
+    QSpinBox *memoryBox;
+    QSpinBox *outputBox;
+};
+
+#endif // RUNLIMITSDIALOG_H
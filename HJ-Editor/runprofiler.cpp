@@ -0,0 +1,633 @@
+#include "runprofiler.h"
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QSettings>
+#include <QDir>
+#include <QTemporaryDir>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#endif
+
+const char RunProfiler::WrapperOption[] = "--hj-profile-wrapper";
+
+namespace {
+
+#ifdef Q_OS_UNIX
+
+volatile sig_atomic_t childPid = 0;
+
+// 编辑器停止运行时结束的是包装进程，把信号转给被测程序
+void forwardSignal(int signal)
+{
+    if (childPid > 0)
+        ::kill(childPid, signal);
+}
+
+qint64 microseconds(const timeval &time)
+{
+    return qint64(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+qint64 elapsedMicroseconds(const timespec &start)
+{
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000;
+}
+
+void writeAll(int fd, const char *data, ssize_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size_t(size));
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return;   // 编辑器已不再读取，丢弃输出
+        data += written;
+        size -= written;
+    }
+}
+
+#endif
+
+#ifdef Q_OS_LINUX
+
+enum Counter {
+    Instructions,
+    Cycles,
+    CacheMisses,
+    BranchMisses,
+    CounterCount
+};
+
+const quint64 CounterConfigs[CounterCount] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// 计数器在子进程 exec 时开始计数，并继承到它创建的线程与子进程
+int openCounter(pid_t pid, quint64 config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;   // perf_event_paranoid 为 2 时普通用户只能统计用户态
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return int(::syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0));
+}
+
+// 计数器数量超过硬件寄存器时内核分时复用，按实际计数的时间比例放大
+qint64 readCounter(int fd)
+{
+    quint64 values[3];
+    if (fd < 0 || ::read(fd, values, sizeof values) != ssize_t(sizeof values) || values[2] == 0)
+        return -1;
+    return qint64(double(values[0]) * values[1] / values[2]);
+}
+
+bool writeText(const QByteArray &path, const QByteArray &text)
+{
+    int fd = ::open(path.constData(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool ok = ::write(fd, text.constData(), size_t(text.size())) == ssize_t(text.size());
+    ::close(fd);
+    return ok;
+}
+
+// 读取 cgroup 接口文件中“key 值”一行的值，找不到时为 -1
+qint64 readKey(const QByteArray &path, const char *key)
+{
+    FILE *in = std::fopen(path.constData(), "r");
+    if (!in)
+        return -1;
+    char name[64];
+    long long value;
+    qint64 result = -1;
+    while (std::fscanf(in, "%63s %lld", name, &value) == 2) {
+        if (std::strcmp(name, key) == 0) {
+            result = value;
+            break;
+        }
+    }
+    std::fclose(in);
+    return result;
+}
+
+// 在包装进程所在的 cgroup（v2）下为被测程序建一个子 cgroup 并设置 memory.max。
+// 只有当前 cgroup 已委派给用户并启用了 memory 控制器时才能成功，失败时返回空
+QByteArray createMemoryGroup(qint64 bytes)
+{
+    FILE *in = std::fopen("/proc/self/cgroup", "r");
+    if (!in)
+        return QByteArray();
+    char line[4096];
+    QByteArray parent;
+    while (std::fgets(line, sizeof line, in)) {
+        if (std::strncmp(line, "0::", 3) == 0) {
+            parent = QByteArray("/sys/fs/cgroup") + QByteArray(line + 3).trimmed();
+            break;
+        }
+    }
+    std::fclose(in);
+    if (parent.isEmpty())
+        return QByteArray();
+
+    // 清理之前被强行结束的包装进程留下的空 cgroup。只删除所属包装进程已经不在的，
+    // 并行运行的其他包装进程刚建好、还没放入子进程的 cgroup 同样是空的
+    if (DIR *dir = ::opendir(parent.constData())) {
+        while (dirent *entry = ::readdir(dir)) {
+            if (std::strncmp(entry->d_name, "hj-run-", 7) != 0)
+                continue;
+            char *end = nullptr;
+            const long owner = std::strtol(entry->d_name + 7, &end, 10);
+            if (owner > 0 && *end == '\0' && ::kill(pid_t(owner), 0) != 0 && errno == ESRCH)
+                ::rmdir((parent + '/' + entry->d_name).constData());
+        }
+        ::closedir(dir);
+    }
+    QByteArray group = parent + "/hj-run-" + QByteArray::number(qint64(::getpid()));
+    if (::mkdir(group.constData(), 0755) != 0)
+        return QByteArray();
+    if (!writeText(group + "/memory.max", QByteArray::number(bytes))) {
+        ::rmdir(group.constData());
+        return QByteArray();
+    }
+    writeText(group + "/memory.swap.max", "0");   // 不允许换出到交换区，超出即 OOM
+    writeText(group + "/pids.max", "512");         // 顺便防止 fork 炸弹拖垮机器
+    return group;
+}
+
+#endif
+
+} // namespace
+
+RunLimits RunLimits::load()
+{
+    QSettings settings;
+    RunLimits limits;
+    limits.enabled = settings.value(QStringLiteral("limits/enabled"), true).toBool();
+    limits.cpuTime = settings.value(QStringLiteral("limits/cpuTime"), 10000).toInt();
+    limits.wallTime = settings.value(QStringLiteral("limits/wallTime"), 0).toInt();
+    limits.memory = settings.value(QStringLiteral("limits/memory"), 2048).toInt();
+    limits.output = settings.value(QStringLiteral("limits/output"), 256).toInt();
+    return limits;
+}
+
+void RunLimits::save() const
+{
+    QSettings settings;
+    settings.setValue(QStringLiteral("limits/enabled"), enabled);
+    settings.setValue(QStringLiteral("limits/cpuTime"), cpuTime);
+    settings.setValue(QStringLiteral("limits/wallTime"), wallTime);
+    settings.setValue(QStringLiteral("limits/memory"), memory);
+    settings.setValue(QStringLiteral("limits/output"), output);
+}
+
+QString RunLimits::describe() const
+{
+    if (!enabled)
+        return QObject::tr("不限制");
+    QStringList parts;
+    if (cpuTime > 0)
+        parts << QObject::tr("CPU %1 s").arg(cpuTime / 1000.0);
+    if (wallTime > 0)
+        parts << QObject::tr("墙钟 %1 s").arg(wallTime / 1000.0);
+    if (memory > 0)
+        parts << QObject::tr("内存 %1 MB").arg(memory);
+    if (output > 0)
+        parts << QObject::tr("输出 %1 MB").arg(output);
+    return parts.isEmpty() ? QObject::tr("不限制") : parts.join(QObject::tr("，"));
+}
+
+QString RunProfile::verdictName(Verdict verdict)
+{
+    switch (verdict) {
+    case Finished:
+        return QObject::tr("正常结束");
+    case TimeLimitExceeded:
+        return QObject::tr("超时");
+    case MemoryLimitExceeded:
+        return QObject::tr("超内存");
+    case OutputLimitExceeded:
+        return QObject::tr("超输出");
+    case RuntimeError:
+        break;
+    }
+    return QObject::tr("运行错误");
+}
+
+QString RunProfile::verdictText() const
+{
+    QString usage;
+    switch (verdict) {
+    case TimeLimitExceeded:
+        usage = QObject::tr("CPU %1 s，墙钟 %2 s").arg((userTime + systemTime) / 1e6, 0, 'f', 2).arg(wallTime / 1e6, 0, 'f', 2);
+        break;
+    case MemoryLimitExceeded:
+        usage = QObject::tr("峰值内存 %1 MB").arg(peakMemory / 1024.0, 0, 'f', 1);
+        break;
+    case OutputLimitExceeded:
+        usage = QObject::tr("输出 %1 MB").arg(outputBytes / 1048576.0, 0, 'f', 1);
+        break;
+    case RuntimeError:
+        usage = signal ? QObject::tr("信号 %1").arg(signal) : QObject::tr("退出码 %1").arg(exitCode);
+        break;
+    case Finished:
+        return verdictName(verdict);
+    }
+    return QObject::tr("%1（%2）").arg(verdictName(verdict), usage);
+}
+
+bool RunProfiler::isSupported()
+{
+#ifdef Q_OS_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString RunProfiler::reportPath(const QString &name)
+{
+    // 局部静态变量的初始化是线程安全的，基准测试与测试用例在工作线程中调用
+    static QTemporaryDir directory(QDir::temp().filePath(QStringLiteral("hj-editor-XXXXXX")));
+    return directory.isValid() ? directory.filePath(name) : QString();
+}
+
+QStringList RunProfiler::wrapperArguments(const QString &report, const QString &program, const QStringList &arguments,
+                                          const QStringList &options)
+{
+    QStringList result;
+    result << QLatin1String(WrapperOption) << report;
+    result += options;
+    result << QStringLiteral("--") << program;
+    return result + arguments;
+}
+
+QStringList RunProfiler::pinningOptions(int cpu)
+{
+    if (cpu < 0)
+        return QStringList();
+    return QStringList() << QStringLiteral("--cpu") << QString::number(cpu);
+}
+
+QStringList RunProfiler::limitOptions(const RunLimits &limits, bool addressSpace)
+{
+    QStringList options;
+    if (!limits.enabled)
+        return options;
+    if (limits.cpuTime > 0)
+        options << QStringLiteral("--cpu-time") << QString::number(limits.cpuTime);
+    if (limits.wallTime > 0)
+        options << QStringLiteral("--wall-time") << QString::number(limits.wallTime);
+    if (limits.memory > 0)
+        options << QStringLiteral("--memory") << QString::number(qint64(limits.memory) * 1024);
+    if (limits.memory > 0 && !addressSpace)
+        options << QStringLiteral("--no-address-limit");
+    if (limits.output > 0)
+        options << QStringLiteral("--output") << QString::number(qint64(limits.output) << 20);
+    return options;
+}
+
+int RunProfiler::runWrapper(int argc, char *argv[])
+{
+#ifdef Q_OS_UNIX
+    // argv：编辑器 --hj-profile-wrapper 报告文件 [选项...] -- 程序 参数...
+    int first = 3;
+    int cpu = -1;
+    long long cpuLimit = 0;       // 毫秒
+    long long wallLimit = 0;      // 毫秒
+    long long memoryLimit = 0;    // KB
+    long long outputLimit = 0;    // 字节
+    bool addressSpace = true;
+    for (; first < argc && std::strcmp(argv[first], "--") != 0; ++first) {
+        const char *option = argv[first];
+        if (std::strcmp(option, "--no-address-limit") == 0)
+            addressSpace = false;
+        else if (first + 1 >= argc)
+            break;
+        else if (std::strcmp(option, "--cpu") == 0)
+            cpu = std::atoi(argv[++first]);
+        else if (std::strcmp(option, "--cpu-time") == 0)
+            cpuLimit = std::atoll(argv[++first]);
+        else if (std::strcmp(option, "--wall-time") == 0)
+            wallLimit = std::atoll(argv[++first]);
+        else if (std::strcmp(option, "--memory") == 0)
+            memoryLimit = std::atoll(argv[++first]);
+        else if (std::strcmp(option, "--output") == 0)
+            outputLimit = std::atoll(argv[++first]);
+        else
+            break;
+    }
+    if (argc < 3 || first + 1 >= argc || std::strcmp(argv[first], "--") != 0) {
+        std::fprintf(stderr, "usage: %s %s report [--cpu n] [--cpu-time ms] [--wall-time ms] [--memory KB] "
+                             "[--output bytes] [--no-address-limit] -- program [arguments...]\n",
+                     argv[0], WrapperOption);
+        return 127;
+    }
+    const char *report = argv[2];
+    char **command = argv + first + 1;
+
+    QByteArray memoryGroup;
+#ifdef Q_OS_LINUX
+    if (memoryLimit > 0)
+        memoryGroup = createMemoryGroup(memoryLimit * 1024);
+#endif
+    // ready：计数器与 cgroup 准备好之前子进程不 exec，随后传来一个字节，'1' 表示已放入 cgroup，
+    // 否则子进程自己设置 RLIMIT_AS（包装进程意外退出时读到文件结束，同样设置）；failure：exec 成功时随 CLOEXEC 关闭，失败时传回 errno；
+    // output：限制输出时子进程的标准输出经包装进程转发
+    int ready[2];
+    int failure[2];
+    int output[2] = {-1, -1};
+    if (::pipe(ready) != 0 || ::pipe(failure) != 0 || (outputLimit > 0 && ::pipe(output) != 0)) {
+        std::perror("pipe");
+        return 127;
+    }
+    ::fcntl(failure[1], F_SETFD, FD_CLOEXEC);
+    pid_t child = ::fork();
+    if (child < 0) {
+        std::perror("fork");
+        return 127;
+    }
+    if (child == 0) {
+        ::close(ready[1]);
+        ::close(failure[0]);
+        if (output[1] >= 0) {
+            ::dup2(output[1], STDOUT_FILENO);
+            ::close(output[0]);
+            ::close(output[1]);
+        }
+#ifdef Q_OS_LINUX
+        ::prctl(PR_SET_PDEATHSIG, SIGKILL);   // 包装进程被强行结束时不留下孤儿进程
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (::sched_setaffinity(0, sizeof set, &set) != 0)
+                std::perror("sched_setaffinity");
+        }
+#else
+        Q_UNUSED(cpu);
+#endif
+        // 软限制向上取整到秒，是否超时最后按实际 CPU 时间判定
+        if (cpuLimit > 0) {
+            rlimit limit;
+            limit.rlim_cur = rlim_t((cpuLimit + 999) / 1000);
+            limit.rlim_max = limit.rlim_cur + 1;
+            ::setrlimit(RLIMIT_CPU, &limit);
+        }
+        if (outputLimit > 0) {   // 写入文件的输出
+            rlimit limit;
+            limit.rlim_cur = limit.rlim_max = rlim_t(outputLimit);
+            ::setrlimit(RLIMIT_FSIZE, &limit);
+        }
+        char attached = 0;
+        while (::read(ready[0], &attached, 1) < 0 && errno == EINTR) {
+        }
+        ::close(ready[0]);
+        // 没有放进 cgroup 时用地址空间限制代替，比常驻内存偏严
+        if (memoryLimit > 0 && addressSpace && attached != '1') {
+            rlimit limit;
+            limit.rlim_cur = limit.rlim_max = rlim_t(memoryLimit) * 1024;
+            ::setrlimit(RLIMIT_AS, &limit);
+        }
+        ::execvp(command[0], command);
+        int error = errno;
+        ssize_t written = ::write(failure[1], &error, sizeof error);
+        Q_UNUSED(written);
+        ::_exit(127);
+    }
+    ::close(ready[0]);
+    ::close(failure[1]);
+    int outputFd = output[0];
+    if (output[1] >= 0)
+        ::close(output[1]);
+    childPid = child;
+    ::signal(SIGTERM, forwardSignal);
+    ::signal(SIGINT, forwardSignal);
+    ::signal(SIGHUP, forwardSignal);
+    ::signal(SIGPIPE, SIG_IGN);
+
+#ifdef Q_OS_LINUX
+    if (!memoryGroup.isEmpty() && !writeText(memoryGroup + "/cgroup.procs", QByteArray::number(qint64(child)))) {
+        ::rmdir(memoryGroup.constData());
+        memoryGroup.clear();
+    }
+    int counters[CounterCount];
+    for (int i = 0; i < CounterCount; ++i)
+        counters[i] = openCounter(child, CounterConfigs[i]);
+#endif
+    // 与子进程的判断一致：只有确实放进了 cgroup 才不设 RLIMIT_AS
+    const bool limitAddressSpace = memoryLimit > 0 && memoryGroup.isEmpty() && addressSpace;
+    const char attached = memoryGroup.isEmpty() ? '0' : '1';
+
+    timespec start;
+    ::clock_gettime(CLOCK_MONOTONIC, &start);
+    ssize_t sent;
+    while ((sent = ::write(ready[1], &attached, 1)) < 0 && errno == EINTR) {
+    }
+    Q_UNUSED(sent);
+    ::close(ready[1]);
+    int error = 0;
+    ssize_t got;
+    while ((got = ::read(failure[0], &error, sizeof error)) < 0 && errno == EINTR) {
+    }
+    ::close(failure[0]);
+
+    // 有墙钟或输出限制时边转发输出边计时；标准输出关闭后每隔几毫秒检查子进程是否结束
+    int status = 0;
+    rusage usage;
+    std::memset(&usage, 0, sizeof usage);
+    bool wallExceeded = false;
+    bool outputExceeded = false;
+    qint64 outputBytes = 0;
+    if (wallLimit > 0 || outputFd >= 0) {
+        char buffer[65536];
+        for (;;) {
+            int timeout = -1;
+            if (wallLimit > 0 && !wallExceeded) {
+                qint64 left = wallLimit * 1000 - elapsedMicroseconds(start);
+                if (left <= 0) {
+                    ::kill(child, SIGKILL);
+                    wallExceeded = true;
+                    if (outputFd >= 0) {
+                        ::close(outputFd);
+                        outputFd = -1;
+                    }
+                    continue;
+                }
+                timeout = int(qMin<qint64>((left + 999) / 1000, 100));
+            }
+            if (outputFd >= 0) {
+                pollfd readable = {outputFd, POLLIN, 0};
+                if (::poll(&readable, 1, timeout) <= 0)
+                    continue;
+                ssize_t size = ::read(outputFd, buffer, sizeof buffer);
+                if (size < 0 && errno == EINTR)
+                    continue;
+                if (size > 0 && outputBytes + size <= outputLimit) {
+                    outputBytes += size;
+                    writeAll(STDOUT_FILENO, buffer, size);
+                    continue;
+                }
+                if (size > 0) {
+                    outputBytes += size;
+                    outputExceeded = true;
+                    ::kill(child, SIGKILL);
+                }
+                ::close(outputFd);
+                outputFd = -1;
+                continue;
+            }
+            if (timeout < 0) {
+                while (::wait4(child, &status, 0, &usage) < 0 && errno == EINTR) {
+                }
+                break;
+            }
+            if (::wait4(child, &status, WNOHANG, &usage) == child)
+                break;
+            timespec pause = {0, 2000000};
+            ::nanosleep(&pause, nullptr);
+        }
+    } else {
+        while (::wait4(child, &status, 0, &usage) < 0 && errno == EINTR) {
+        }
+    }
+    timespec end;
+    ::clock_gettime(CLOCK_MONOTONIC, &end);
+    childPid = 0;
+
+    bool oomKilled = false;
+    qint64 groupPeak = -1;
+#ifdef Q_OS_LINUX
+    if (!memoryGroup.isEmpty()) {
+        oomKilled = readKey(memoryGroup + "/memory.events", "oom_kill") > 0;
+        if (FILE *peak = std::fopen((memoryGroup + "/memory.peak").constData(), "r")) {   // Linux 5.19 起才有
+            long long bytes;
+            if (std::fscanf(peak, "%lld", &bytes) == 1)
+                groupPeak = bytes / 1024;
+            std::fclose(peak);
+        }
+        ::rmdir(memoryGroup.constData());
+    }
+#endif
+    if (got == ssize_t(sizeof error)) {
+        std::fprintf(stderr, "%s: %s\n", command[0], std::strerror(error));
+        return 127;
+    }
+
+    const qint64 cpuUsed = microseconds(usage.ru_utime) + microseconds(usage.ru_stime);
+#ifdef Q_OS_MACOS
+    const qint64 peakMemory = qMax<qint64>(usage.ru_maxrss / 1024, groupPeak);   // macOS 以字节计
+#else
+    const qint64 peakMemory = qMax<qint64>(usage.ru_maxrss, groupPeak);
+#endif
+    const bool failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    const int signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    RunProfile::Verdict verdict = RunProfile::Finished;
+    if (wallExceeded || signal == SIGXCPU || (cpuLimit > 0 && cpuUsed > cpuLimit * 1000))
+        verdict = RunProfile::TimeLimitExceeded;
+    else if (outputExceeded || signal == SIGXFSZ)
+        verdict = RunProfile::OutputLimitExceeded;
+    else if (oomKilled || (memoryLimit > 0 && peakMemory > memoryLimit))
+        verdict = RunProfile::MemoryLimitExceeded;
+    else if (failed && limitAddressSpace && peakMemory * 2 >= memoryLimit)
+        verdict = RunProfile::MemoryLimitExceeded;   // 分配失败通常在已用去一半以上时发生（容器按倍数增长）
+    else if (failed)
+        verdict = RunProfile::RuntimeError;
+
+    // 不跟随符号链接，新建的文件只有自己可读写
+    const int reportFd = ::open(report, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+    FILE *out = reportFd >= 0 ? ::fdopen(reportFd, "w") : nullptr;
+    if (out) {
+        std::fprintf(out, "exit %d\n", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        std::fprintf(out, "signal %d\n", signal);
+        std::fprintf(out, "verdict %d\n", int(verdict));
+        std::fprintf(out, "wall %lld\n", (long long)(end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000);
+        std::fprintf(out, "user %lld\n", (long long)microseconds(usage.ru_utime));
+        std::fprintf(out, "system %lld\n", (long long)microseconds(usage.ru_stime));
+        std::fprintf(out, "maxrss %lld\n", (long long)peakMemory);
+        std::fprintf(out, "minflt %lld\n", (long long)usage.ru_minflt);
+        std::fprintf(out, "majflt %lld\n", (long long)usage.ru_majflt);
+        std::fprintf(out, "nvcsw %lld\n", (long long)usage.ru_nvcsw);
+        std::fprintf(out, "nivcsw %lld\n", (long long)usage.ru_nivcsw);
+        if (outputLimit > 0)
+            std::fprintf(out, "output %lld\n", (long long)outputBytes);
+#ifdef Q_OS_LINUX
+        const char *const names[CounterCount] = {"instructions", "cycles", "cache-misses", "branch-misses"};
+        for (int i = 0; i < CounterCount; ++i) {
+            std::fprintf(out, "%s %lld\n", names[i], (long long)readCounter(counters[i]));
+            if (counters[i] >= 0)
+                ::close(counters[i]);
+        }
+#endif
+        std::fclose(out);
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+#else
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+    return 127;
+#endif
+}
+
+RunProfile RunProfiler::readReport(const QString &report)
+{
+    QHash<QByteArray, qint64> values;
+    QFile in(report);
+    if (in.open(QIODevice::ReadOnly)) {
+        for (const QByteArray &line : in.readAll().split('\n')) {
+            int space = line.indexOf(' ');
+            if (space > 0)
+                values.insert(line.left(space), line.mid(space + 1).toLongLong());
+        }
+    }
+    RunProfile profile;
+    profile.valid = values.contains("wall");
+    profile.verdict = RunProfile::Verdict(values.value("verdict", RunProfile::Finished));
+    profile.exitCode = int(values.value("exit", -1));
+    profile.signal = int(values.value("signal", 0));
+    profile.wallTime = values.value("wall", -1);
+    profile.userTime = values.value("user", -1);
+    profile.systemTime = values.value("system", -1);
+    profile.peakMemory = values.value("maxrss", -1);
+    profile.minorFaults = values.value("minflt", -1);
+    profile.majorFaults = values.value("majflt", -1);
+    profile.voluntarySwitches = values.value("nvcsw", -1);
+    profile.involuntarySwitches = values.value("nivcsw", -1);
+    profile.instructions = values.value("instructions", -1);
+    profile.cycles = values.value("cycles", -1);
+    profile.cacheMisses = values.value("cache-misses", -1);
+    profile.branchMisses = values.value("branch-misses", -1);
+    profile.outputBytes = values.value("output", -1);
+    return profile;
+}
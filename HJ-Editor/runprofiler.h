@@ -0,0 +1,84 @@
+#ifndef RUNPROFILER_H
+#define RUNPROFILER_H
+
+#include <QString>
+#include <QStringList>
+
+// 运行限制，保存在 QSettings 的 limits/ 下；各项为 0 表示不限制
+struct RunLimits {
+    bool enabled;
+    int cpuTime;     // 毫秒（CPU 时间）
+    int wallTime;    // 毫秒（墙钟时间）
+    int memory;      // MB
+    int output;      // MB（标准输出）
+
+    static RunLimits load();
+    void save() const;
+    QString describe() const;
+};
+
+// 一次运行的资源使用情况，-1 表示无法取得
+struct RunProfile {
+    enum Verdict {
+        Finished,             // 正常退出（退出码为 0）
+        TimeLimitExceeded,
+        MemoryLimitExceeded,
+        OutputLimitExceeded,
+        RuntimeError          // 非零退出码或被信号结束
+    };
+    bool valid;
+    Verdict verdict;
+    int exitCode;            // 被信号结束时为 -1
+    int signal;              // 结束进程的信号，正常退出时为 0
+    qint64 wallTime;         // 微秒
+    qint64 userTime;         // 微秒
+    qint64 systemTime;       // 微秒
+    qint64 peakMemory;       // KB（峰值常驻内存）
+    qint64 minorFaults;
+    qint64 majorFaults;
+    qint64 voluntarySwitches;
+    qint64 involuntarySwitches;
+    qint64 instructions;     // 以下来自硬件计数器（perf_event_open），只统计用户态
+    qint64 cycles;
+    qint64 cacheMisses;
+    qint64 branchMisses;
+    qint64 outputBytes;      // 经包装进程转发的标准输出字节数，没有限制输出时为 -1
+
+    static QString verdictName(Verdict verdict);
+    // 如“超时（CPU 2.01 s）”
+    QString verdictText() const;
+};
+
+// 性能分析运行：编辑器自己的可执行文件以 --hj-profile-wrapper 启动时充当包装进程，
+// fork 出被测程序并等待它结束，用 wait4 取得子进程的 rusage（CPU 时间、峰值内存、缺页、上下文切换），
+// Linux 上再用 perf_event_open 为子进程挂上指令数、周期、缓存未命中等计数器（enable_on_exec，
+// 只统计 exec 之后的部分）。计数器不可用（内核不支持、perf_event_paranoid 限制、虚拟机）时只给出 rusage。
+// 结果写入报告文件，包装进程以被测程序的退出码退出，标准输入输出原样交给被测程序。
+// 给出限制时包装进程还负责限制资源：CPU 时间用 RLIMIT_CPU（超出软限制收到 SIGXCPU，再超出 1 秒被 SIGKILL），
+// 内存优先放进单独的 cgroup v2 设置 memory.max（需要当前 cgroup 已委派给用户），不可用时退回 RLIMIT_AS，
+// 墙钟时间由包装进程计时，到时直接 SIGKILL；限制输出时标准输出经包装进程转发并计数，超出即 SIGKILL。
+// 判定（超时、超内存、超输出、运行错误）由包装进程写入报告。
+class RunProfiler
+{
+public:
+    static const char WrapperOption[];
+
+    // 当前平台是否支持（需要 fork/wait4）
+    static bool isSupported();
+    // 报告文件的路径：放在本进程私有的临时目录（0700，退出时删除）中，
+    // 其他用户无法预先放置同名文件或符号链接。目录无法创建时返回空串
+    static QString reportPath(const QString &name);
+    // 经包装进程运行 program 所用的参数，程序本身为 QCoreApplication::applicationFilePath()
+    static QStringList wrapperArguments(const QString &report, const QString &program, const QStringList &arguments,
+                                        const QStringList &options = QStringList());
+    // 包装进程选项：把被测程序固定在编号为 cpu 的核上运行（Linux），cpu < 0 时为空
+    static QStringList pinningOptions(int cpu);
+    // 包装进程选项：运行限制，limits.enabled 为 false 时为空。
+    // addressSpace 为 false 时不以 RLIMIT_AS 代替 cgroup（ASan 程序需要保留极大的虚拟地址空间）
+    static QStringList limitOptions(const RunLimits &limits, bool addressSpace = true);
+    // main() 中在创建 QApplication 之前调用：argv[1] 为 WrapperOption
+    static int runWrapper(int argc, char *argv[]);
+    static RunProfile readReport(const QString &report);
+};
+
+#endif // RUNPROFILER_H
@@ -0,0 +1,137 @@
+#include "startupprofiler.h"
+#include <QCoreApplication>
+#include <QTimer>
+#include <QEvent>
+#include <QWidget>
+#include <QDebug>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#ifdef Q_OS_LINUX
+#include <time.h>
+#include <unistd.h>
+#endif
+
+const char StartupProfiler::Option[] = "--startup-profile";
+
+namespace {
+
+// 进程创建到现在的微秒数：/proc/self/stat 的第 22 项是进程创建时刻（开机以来的时钟滴答），
+// 精度只有一个滴答（一般 10 ms），包括动态链接、加载 Qt 库与静态初始化
+qint64 processAge()
+{
+#ifdef Q_OS_LINUX
+    FILE *file = fopen("/proc/self/stat", "r");
+    if (!file)
+        return 0;
+    char buffer[1024];
+    size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    buffer[size] = '\0';
+    // 进程名可能含空格，从最后一个右括号之后数起，第 3 项开始
+    const char *field = strrchr(buffer, ')');
+    if (!field)
+        return 0;
+    for (int i = 2; i < 22 && field; ++i)
+        field = strchr(field + 1, ' ');
+    if (!field)
+        return 0;
+    const unsigned long long ticks = strtoull(field + 1, nullptr, 10);
+    const long hertz = sysconf(_SC_CLK_TCK);
+    timespec now;
+    if (hertz <= 0 || clock_gettime(CLOCK_BOOTTIME, &now) != 0)
+        return 0;
+    const qint64 age = qint64(now.tv_sec) * 1000000 + now.tv_nsec / 1000 - qint64(ticks) * 1000000 / hertz;
+    return qMax<qint64>(age, 0);
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+StartupProfiler::StartupProfiler(QObject *parent) : QObject(parent)
+{
+    enabled = false;
+    painted = false;
+    beforeMain = 0;
+}
+
+StartupProfiler *StartupProfiler::instance()
+{
+    static StartupProfiler profiler;
+    return &profiler;
+}
+
+void StartupProfiler::start(int argc, char *argv[])
+{
+    StartupProfiler *profiler = instance();
+    profiler->timer.start();
+    profiler->enabled = qEnvironmentVariableIsSet("HJ_STARTUP_PROFILE");
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], Option) == 0)
+            profiler->enabled = true;
+    }
+    if (!profiler->enabled)
+        return;
+    profiler->beforeMain = processAge();
+    if (profiler->beforeMain > 0)
+        profiler->phases.append(Phase{"进程创建到 main（动态链接与静态初始化）", profiler->beforeMain});
+}
+
+bool StartupProfiler::isEnabled()
+{
+    return instance()->enabled;
+}
+
+void StartupProfiler::mark(const char *phase)
+{
+    StartupProfiler *profiler = instance();
+    if (!profiler->enabled || profiler->painted)
+        return;
+    profiler->phases.append(Phase{phase, profiler->beforeMain + profiler->timer.nsecsElapsed() / 1000});
+}
+
+void StartupProfiler::watchFirstPaint(QWidget *widget)
+{
+    if (isEnabled())
+        widget->installEventFilter(instance());
+}
+
+// 过滤器在绘制之前收到事件：记下开始绘制的时刻，绘制完成、事件循环空闲后再结束计时
+bool StartupProfiler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Paint && !painted) {
+        watched->removeEventFilter(this);
+        mark("布局完成，开始第一次绘制");
+        QTimer::singleShot(0, this, &StartupProfiler::finish);
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void StartupProfiler::finish()
+{
+    mark("第一次绘制完成，可以输入");
+    painted = true;
+    const qint64 total = phases.isEmpty() ? 0 : phases.last().time / 1000;
+    const QString text = report();
+    qInfo().noquote() << text;
+    emit reported(text, total);
+    if (qEnvironmentVariableIsSet("HJ_STARTUP_PROFILE_QUIT"))
+        QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+}
+
+QString StartupProfiler::report() const
+{
+    QString text = tr("启动时间线（毫秒，从进程创建算起）：\n");
+    qint64 previous = 0;
+    for (const Phase &phase : phases) {
+        text += QString("  %1  +%2  %3\n").arg(phase.time / 1000.0, 8, 'f', 1)
+                .arg((phase.time - previous) / 1000.0, 7, 'f', 1).arg(QString::fromUtf8(phase.name));
+        previous = phase.time;
+    }
+    const qint64 total = phases.isEmpty() ? 0 : phases.last().time / 1000;
+    text += total <= Target ? tr("第一次可交互绘制 %1 ms，目标 %2 ms 以内\n").arg(total).arg(Target)
+                            : tr("第一次可交互绘制 %1 ms，超出目标 %2 ms\n").arg(total).arg(Target);
+    return text;
+}
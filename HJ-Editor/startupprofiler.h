@@ -0,0 +1,56 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+class QWidget;
+QT_END_NAMESPACE
+
+// 启动计时：从进程创建到编辑器第一次绘制完成，记录各阶段的时间线。
+// 以 --startup-profile 启动（或设置环境变量 HJ_STARTUP_PROFILE）时才打点，
+// 第一次绘制完成后把时间线写到标准错误并发出 reported；未启用时 mark() 什么都不做。
+// 同时设置了 HJ_STARTUP_PROFILE_QUIT 时报告后立即退出，供 benchmarks/startup/measure.sh 反复测量
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const char Option[];
+    static const int Target = 150;   // 第一次可交互绘制的目标（毫秒）
+
+    static StartupProfiler *instance();
+    // main 开头、创建 QApplication 之前调用
+    static void start(int argc, char *argv[]);
+    static bool isEnabled();
+    // 记录一个阶段在此刻结束
+    static void mark(const char *phase);
+    // widget 第一次绘制并回到事件循环后结束计时并报告
+    static void watchFirstPaint(QWidget *widget);
+
+signals:
+    void reported(const QString &report, qint64 total);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit StartupProfiler(QObject *parent = nullptr);
+    void finish();
+    QString report() const;
+
+    struct Phase {
+        const char *name;
+        qint64 time;   // 微秒，相对进程创建
+    };
+    bool enabled;
+    bool painted;
+    qint64 beforeMain;   // 微秒，进程创建到 main 的时间，无法取得时为 0
+    QElapsedTimer timer; // 从 main 开始
+    QVector<Phase> phases;
+};
+
+#endif // STARTUPPROFILER_H
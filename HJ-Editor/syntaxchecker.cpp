@@ -0,0 +1,172 @@
+#include "syntaxchecker.h"
+#include "builder.h"
+#include "precompiledheader.h"
+#include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QProcess>
+
+namespace {
+
+const int CacheEntries = 64;
+const QLatin1String StandardInputName("<stdin>");   // g++ 与 clang 对标准输入的称呼
+
+} // namespace
+
+SyntaxChecker::SyntaxChecker(QObject *parent) : QObject(parent)
+{
+    running = false;
+    hasPending = false;
+    pool.setMaxThreadCount(1);
+    connect(&watcher, &QFutureWatcher<SyntaxCheckResult>::finished, this, &SyntaxChecker::checkFinished);
+}
+
+SyntaxChecker::~SyntaxChecker()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void SyntaxChecker::check(const QString &path, const QByteArray &text, const QString &compiler, const QStringList &flags)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    // 与编译缓存一样认编译器本身而不是名字，PATH 变化或升级编译器后不会用到旧结果
+    hash.addData(Builder::compilerStamp(compiler).toUtf8());
+    for (const QString &flag : flags) {
+        hash.addData("\0", 1);
+        hash.addData(flag.toUtf8());
+    }
+    hash.addData("\0", 1);
+    hash.addData(path.toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(text);
+    const QByteArray key = hash.result();
+    if (key == latestKey)
+        return;   // 内容没有变化（重新高亮等也会触发调用）
+    latestKey = key;
+
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd()) {
+        // 检查过的内容：立即给出结果，等待中的旧内容不必再检查
+        hasPending = false;
+        const QVector<Diagnostic> diagnostics = it.value();
+        remember(key, diagnostics);
+        emit checked(path, diagnostics);
+        return;
+    }
+    pending.path = path;
+    pending.text = text;
+    pending.compiler = compiler;
+    pending.flags = flags;
+    pending.key = key;
+    hasPending = true;
+    if (running) {
+        // 正在检查的内容已经过时，结束后在 checkFinished 中接着检查最新的内容
+        cancelFlag->store(1);
+        return;
+    }
+    startPending();
+}
+
+void SyntaxChecker::cancel()
+{
+    if (cancelFlag)
+        cancelFlag->store(1);
+    hasPending = false;
+    pending = Job();
+    latestKey.clear();
+}
+
+void SyntaxChecker::startPending()
+{
+    hasPending = false;
+    running = true;
+    cancelFlag.reset(new QAtomicInt(0));
+    QSharedPointer<QAtomicInt> flag = cancelFlag;
+    Job job = pending;
+    pending = Job();
+    watcher.setFuture(QtConcurrent::run(&pool, [job, flag] {
+        return run(job, flag.data());
+    }));
+}
+
+void SyntaxChecker::checkFinished()
+{
+    running = false;
+    SyntaxCheckResult result = watcher.result();
+    if (result.completed) {
+        remember(result.key, result.diagnostics);
+        if (result.key == latestKey)
+            emit checked(result.path, result.diagnostics);
+    }
+    if (hasPending)
+        startPending();
+}
+
+void SyntaxChecker::remember(const QByteArray &key, const QVector<Diagnostic> &diagnostics)
+{
+    if (cache.contains(key))
+        cacheOrder.removeOne(key);
+    cache.insert(key, diagnostics);
+    cacheOrder.append(key);
+    while (cacheOrder.size() > CacheEntries)
+        cache.remove(cacheOrder.takeFirst());
+}
+
+// 检查线程：内容经标准输入交给编译器，只解析不生成代码
+SyntaxCheckResult SyntaxChecker::run(const Job &job, const QAtomicInt *cancel)
+{
+    SyntaxCheckResult result;
+    result.path = job.path;
+    result.key = job.key;
+    result.completed = false;
+
+    QByteArray identity = Builder::compilerIdentity(job.compiler, cancel);
+    if (identity.isEmpty())
+        return result;
+    QStringList arguments = Builder::diagnosticOptions(job.compiler, identity, cancel);
+    arguments << QStringLiteral("-fsyntax-only");
+    // 运行时建好的预编译头在这里同样可用，开头引入 <bits/stdc++.h> 的文件也能很快检查完
+    QByteArray includes = PrecompiledHeader::leadingIncludesOf(job.text);
+    if (!includes.isEmpty()) {
+        bool ready = false;
+        QString header = PrecompiledHeader::headerPath(identity, job.flags, includes, &ready);
+        if (ready)
+            arguments << QStringLiteral("-include") << header;
+    }
+    // 标准输入没有所在目录，带引号的 #include 按文件所在目录查找
+    const QString directory = QFileInfo(job.path).absolutePath();
+    arguments << QStringLiteral("-iquote") << directory;
+    arguments += job.flags;
+    arguments << QStringLiteral("-x") << QStringLiteral("c++") << QStringLiteral("-");
+
+    QProcess process;
+    process.setWorkingDirectory(directory);
+    process.start(job.compiler, arguments);
+    if (!process.waitForStarted())
+        return result;
+    process.write(job.text);
+    process.closeWriteChannel();
+    DiagnosticParser parser;
+    for (;;) {
+        bool done = process.waitForFinished(50);
+        parser.feed(process.readAllStandardError());
+        process.readAllStandardOutput();
+        if (done || process.state() == QProcess::NotRunning)
+            break;
+        if (cancel->load()) {
+            process.kill();
+            process.waitForFinished();
+            return result;
+        }
+    }
+    parser.finish();
+    for (Diagnostic diagnostic : parser.diagnostics()) {
+        if (diagnostic.file != StandardInputName)
+            continue;   // 头文件中的问题不在这个缓冲区里
+        diagnostic.file = job.path;
+        result.diagnostics.append(diagnostic);
+    }
+    result.completed = true;
+    return result;
+}
@@ -0,0 +1,70 @@
+#ifndef SYNTAXCHECKER_H
+#define SYNTAXCHECKER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include "diagnostics.h"
+
+// 一次语法检查的结果，diagnostics 只包含缓冲区本身的诊断，file 已换成 path
+struct SyntaxCheckResult {
+    QString path;
+    QByteArray key;
+    bool completed;   // 被取消或编译器无法运行时为 false，不放入缓存
+    QVector<Diagnostic> diagnostics;
+};
+
+// 边输入边检查语法：把缓冲区的快照经标准输入交给 g++ -fsyntax-only（或设置中的编译器），
+// 不必先保存文件。同一时间最多只有一个检查在进行，新的内容到达时取消正在进行的检查，
+// 等它退出后再检查最新的内容，中间的版本直接跳过。
+// 结果按“编译器（可执行文件的路径、大小与修改时间）+ 选项 + 路径 + 内容”的哈希缓存，撤销、重做回到检查过的内容时立即给出结果。
+// 防抖由调用者负责（停止输入一小段时间后再调用 check）。
+class SyntaxChecker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyntaxChecker(QObject *parent = nullptr);
+    ~SyntaxChecker();
+
+    // path 用于解析相对的 #include 与标记结果所属的文件
+    void check(const QString &path, const QByteArray &text, const QString &compiler, const QStringList &flags);
+    // 放弃正在进行与等待中的检查，不再发出它们的结果
+    void cancel();
+
+signals:
+    void checked(const QString &path, const QVector<Diagnostic> &diagnostics);
+
+private slots:
+    void checkFinished();
+
+private:
+    struct Job {
+        QString path;
+        QByteArray text;
+        QString compiler;
+        QStringList flags;
+        QByteArray key;
+    };
+    static SyntaxCheckResult run(const Job &job, const QAtomicInt *cancel);
+    void startPending();
+    void remember(const QByteArray &key, const QVector<Diagnostic> &diagnostics);
+
+    QThreadPool pool;   // 单线程
+    QFutureWatcher<SyntaxCheckResult> watcher;
+    QSharedPointer<QAtomicInt> cancelFlag;
+    bool running;
+    bool hasPending;
+    Job pending;
+    QByteArray latestKey;   // 最近一次请求的内容，只发出与它一致的结果
+    QHash<QByteArray, QVector<Diagnostic>> cache;
+    QList<QByteArray> cacheOrder;   // 最近使用的在后
+};
+
+#endif // SYNTAXCHECKER_H
@@ -0,0 +1,200 @@
+#include "testpanel.h"
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QDir>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+enum Column {
+    InputColumn,
+    ExpectedColumn,
+    VerdictColumn,
+    TimeColumn,
+    DetailColumn,
+    ColumnCount
+};
+
+// 按常见的命名习惯找期望输出：1.in → 1.out / 1.ans，input1.txt → output1.txt
+QString guessExpected(const QString &input)
+{
+    QFileInfo info(input);
+    QDir dir = info.absoluteDir();
+    const char *suffixes[] = {".out", ".ans", ".answer", ".expected"};
+    for (const char *suffix : suffixes) {
+        QString candidate = dir.filePath(info.completeBaseName() + QLatin1String(suffix));
+        if (QFile::exists(candidate))
+            return candidate;
+    }
+    QString name = info.fileName();
+    if (name.contains(QLatin1String("input"))) {
+        QString candidate = dir.filePath(QString(name).replace(QLatin1String("input"), QLatin1String("output")));
+        if (QFile::exists(candidate))
+            return candidate;
+    }
+    return QString();
+}
+
+} // namespace
+
+TestPanel::TestPanel(QWidget *parent) : QWidget(parent)
+{
+    runner = new TestRunner(this);
+    passed = 0;
+    table = new QTableWidget(0, ColumnCount, this);
+    statusLabel = new QLabel(this);
+    addButton = new QPushButton("添加...", this);
+    removeButton = new QPushButton("删除", this);
+    runButton = new QPushButton("运行全部", this);
+
+    table->setHorizontalHeaderLabels(QStringList() << "输入" << "期望输出" << "结果" << "时间 ms" << "说明");
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table->horizontalHeader()->setStretchLastSection(true);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    buttonLayout->addWidget(statusLabel, 1);
+    buttonLayout->addWidget(addButton);
+    buttonLayout->addWidget(removeButton);
+    buttonLayout->addWidget(runButton);
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->addWidget(table);
+    mainLayout->addLayout(buttonLayout);
+    setLayout(mainLayout);
+
+    connect(addButton, &QPushButton::clicked, this, &TestPanel::addCases);
+    connect(removeButton, &QPushButton::clicked, this, &TestPanel::removeCases);
+    connect(runButton, &QPushButton::clicked, this, &TestPanel::runRequested);
+    connect(runner, &TestRunner::caseFinished, this, &TestPanel::showOutcome);
+    connect(runner, &TestRunner::finished, this, &TestPanel::runFinished);
+    setSource(QString());
+}
+
+void TestPanel::setSource(const QString &source)
+{
+    if (isRunning())
+        return;
+    this->source = source;
+    cases = source.isEmpty() ? QVector<TestCase>() : TestRunner::casesFor(source);
+    reloadTable();
+    setEnabled(!source.isEmpty());
+    statusLabel->setText(source.isEmpty() ? tr("文件保存后才能添加测试用例")
+                                          : tr("%1：%2 个用例").arg(QFileInfo(source).fileName()).arg(cases.size()));
+}
+
+bool TestPanel::hasCases() const
+{
+    return !cases.isEmpty();
+}
+
+void TestPanel::reloadTable()
+{
+    table->setRowCount(cases.size());
+    for (int row = 0; row < cases.size(); ++row) {
+        const TestCase &testCase = cases.at(row);
+        QTableWidgetItem *input = new QTableWidgetItem(QFileInfo(testCase.input).fileName());
+        input->setToolTip(testCase.input);
+        QTableWidgetItem *expected = new QTableWidgetItem(QFileInfo(testCase.expected).fileName());
+        expected->setToolTip(testCase.expected);
+        table->setItem(row, InputColumn, input);
+        table->setItem(row, ExpectedColumn, expected);
+        for (int column = VerdictColumn; column < ColumnCount; ++column)
+            table->setItem(row, column, new QTableWidgetItem);
+        table->item(row, TimeColumn)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    }
+}
+
+void TestPanel::addCases()
+{
+    const QString directory = QFileInfo(source).absolutePath();
+    const QStringList inputs = QFileDialog::getOpenFileNames(this, tr("选择输入文件"), directory,
+                                                             tr("输入文件 (*.in *.txt);;所有文件 (*)"));
+    if (inputs.isEmpty())
+        return;
+    for (const QString &input : inputs) {
+        TestCase testCase;
+        testCase.input = input;
+        testCase.expected = guessExpected(input);
+        if (testCase.expected.isEmpty())
+            testCase.expected = QFileDialog::getOpenFileName(this, tr("选择 %1 的期望输出").arg(QFileInfo(input).fileName()),
+                                                             QFileInfo(input).absolutePath());
+        if (!testCase.expected.isEmpty())
+            cases.append(testCase);
+    }
+    TestRunner::saveCases(source, cases);
+    setSource(source);
+}
+
+void TestPanel::removeCases()
+{
+    if (isRunning())
+        return;
+    QList<int> rows;
+    for (const QModelIndex &index : table->selectionModel()->selectedRows())
+        rows.append(index.row());
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    for (int row : rows)
+        cases.remove(row);
+    TestRunner::saveCases(source, cases);
+    setSource(source);
+}
+
+void TestPanel::run(const QString &binary, const QString &workingDirectory, const RunLimits &limits, bool addressSpace)
+{
+    reloadTable();
+    passed = 0;
+    addButton->setEnabled(false);
+    removeButton->setEnabled(false);
+    runButton->setEnabled(false);
+    statusLabel->setText(tr("正在并行运行 %1 个用例...").arg(cases.size()));
+    timer.start();
+    runner->start(binary, workingDirectory, cases, limits, addressSpace);
+}
+
+void TestPanel::cancel()
+{
+    if (!isRunning())
+        return;
+    runner->cancel();
+    addButton->setEnabled(true);
+    removeButton->setEnabled(true);
+    runButton->setEnabled(true);
+    statusLabel->setText(tr("已停止"));
+}
+
+bool TestPanel::isRunning() const
+{
+    return runner->isRunning();
+}
+
+void TestPanel::showOutcome(const TestOutcome &outcome)
+{
+    if (outcome.index >= table->rowCount())
+        return;
+    if (outcome.verdict == TestOutcome::Passed)
+        ++passed;
+    QTableWidgetItem *verdict = table->item(outcome.index, VerdictColumn);
+    verdict->setText(TestOutcome::verdictName(outcome.verdict));
+    verdict->setForeground(outcome.verdict == TestOutcome::Passed ? QColor(0, 150, 0) : QColor(200, 0, 0));
+    table->item(outcome.index, TimeColumn)->setText(QString::number(outcome.elapsed / 1000.0, 'f', 1));
+    table->item(outcome.index, DetailColumn)->setText(outcome.detail);
+    table->item(outcome.index, DetailColumn)->setToolTip(outcome.detail);
+}
+
+void TestPanel::runFinished()
+{
+    addButton->setEnabled(true);
+    removeButton->setEnabled(true);
+    runButton->setEnabled(true);
+    statusLabel->setText(tr("通过 %1/%2，用时 %3 ms").arg(passed).arg(cases.size()).arg(timer.elapsed()));
+    emit finished(passed, cases.size());
+}
@@ -0,0 +1,56 @@
+#ifndef TESTPANEL_H
+#define TESTPANEL_H
+
+#include <QWidget>
+#include <QElapsedTimer>
+#include "testrunner.h"
+
+QT_BEGIN_NAMESPACE
+class QTableWidget;
+class QLabel;
+class QPushButton;
+QT_END_NAMESPACE
+
+// “测试用例”面板：为源文件挂上若干组输入/期望输出文件，编译后并行运行全部用例，
+// 逐个显示结果与耗时。用例随源文件保存，下次打开时自动恢复
+class TestPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TestPanel(QWidget *parent = nullptr);
+    // 切换到另一个源文件的用例，运行中不切换
+    void setSource(const QString &source);
+    bool hasCases() const;
+    // 用编译好的程序运行全部用例，limits 与 addressSpace 见 TestRunner::start
+    void run(const QString &binary, const QString &workingDirectory, const RunLimits &limits, bool addressSpace);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    // 点击“运行全部”，由主窗口先编译再调用 run
+    void runRequested();
+    void finished(int passed, int total);
+
+private slots:
+    void addCases();
+    void removeCases();
+    void showOutcome(const TestOutcome &outcome);
+    void runFinished();
+
+private:
+    void reloadTable();
+
+    QString source;
+    QVector<TestCase> cases;
+    TestRunner *runner;
+    int passed;
+    QElapsedTimer timer;
+    QTableWidget *table;
+    QLabel *statusLabel;
+    QPushButton *addButton;
+    QPushButton *removeButton;
+    QPushButton *runButton;
+};
+
+#endif // TESTPANEL_H
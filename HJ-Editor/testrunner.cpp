@@ -0,0 +1,349 @@
+#include "testrunner.h"
+#include <QtConcurrent>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+// 不限制资源时每个用例最多运行的墙钟时间，防止死循环的程序一直占着线程
+const qint64 CaseTimeLimit = 10000;   // 毫秒
+const int ExcerptLength = 60;
+
+QByteArray trimmedRight(QByteArray line)
+{
+    int end = line.size();
+    while (end > 0 && (line.at(end - 1) == ' ' || line.at(end - 1) == '\t' || line.at(end - 1) == '\r'))
+        --end;
+    line.truncate(end);
+    return line;
+}
+
+// 读取期望输出的下一行，去掉换行与行尾空白
+QByteArray nextLine(QIODevice *device)
+{
+    QByteArray line = device->readLine();
+    if (line.endsWith('\n'))
+        line.chop(1);
+    return trimmedRight(line);
+}
+
+QString excerpt(const QByteArray &line)
+{
+    QString text = QString::fromLocal8Bit(line.left(ExcerptLength * 4));
+    if (text.size() > ExcerptLength)
+        text = text.left(ExcerptLength) + QStringLiteral("…");
+    return text;
+}
+
+} // namespace
+
+QString TestOutcome::verdictName(Verdict verdict)
+{
+    switch (verdict) {
+    case Passed:
+        return QObject::tr("通过");
+    case WrongAnswer:
+        return QObject::tr("答案错误");
+    case RuntimeError:
+        return QObject::tr("运行错误");
+    case TimeLimitExceeded:
+        return QObject::tr("超时");
+    case MemoryLimitExceeded:
+        return QObject::tr("超内存");
+    case OutputLimitExceeded:
+        return QObject::tr("超输出");
+    case Failed:
+        break;
+    }
+    return QObject::tr("无法运行");
+}
+
+OutputComparator::OutputComparator(QIODevice *expected) : expected(expected)
+{
+    line = 0;
+    mismatched = false;
+}
+
+bool OutputComparator::feed(const QByteArray &data)
+{
+    if (mismatched)
+        return false;
+    partial += data;
+    int start = 0;
+    int end;
+    while ((end = partial.indexOf('\n', start)) >= 0) {
+        if (!compareLine(partial.mid(start, end - start)))
+            return false;
+        start = end + 1;
+    }
+    partial.remove(0, start);
+    return true;
+}
+
+bool OutputComparator::finish()
+{
+    if (mismatched)
+        return false;
+    if (!partial.isEmpty() && !compareLine(partial))
+        return false;
+    partial.clear();
+    // 期望输出剩下的只能是空行
+    while (!expected->atEnd()) {
+        ++line;
+        QByteArray rest = nextLine(expected);
+        if (!rest.isEmpty()) {
+            mismatched = true;
+            detail = QObject::tr("输出在第 %1 行提前结束，期望“%2”").arg(line).arg(excerpt(rest));
+            return false;
+        }
+    }
+    return true;
+}
+
+QString OutputComparator::difference() const
+{
+    return detail;
+}
+
+// 期望输出已经结束时按空行比较，多出的空行不算错
+bool OutputComparator::compareLine(const QByteArray &actual)
+{
+    ++line;
+    bool ended = expected->atEnd();
+    QByteArray want = ended ? QByteArray() : nextLine(expected);
+    QByteArray got = trimmedRight(actual);
+    if (got == want)
+        return true;
+    mismatched = true;
+    detail = ended ? QObject::tr("第 %1 行多出输出“%2”").arg(line).arg(excerpt(got))
+                   : QObject::tr("第 %1 行不同：期望“%2”，实际“%3”").arg(line).arg(excerpt(want)).arg(excerpt(got));
+    return false;
+}
+
+TestRunner::TestRunner(QObject *parent) : QObject(parent)
+{
+    qRegisterMetaType<TestOutcome>();
+    generation = 0;
+    remaining = 0;
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+    connect(this, &TestRunner::outcomeReady, this, &TestRunner::collectOutcome, Qt::QueuedConnection);
+}
+
+TestRunner::~TestRunner()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+void TestRunner::start(const QString &binary, const QString &workingDirectory, const QVector<TestCase> &cases,
+                       const RunLimits &limits, bool addressSpace)
+{
+    cancel();
+    cancelFlag.reset(new QAtomicInt(0));
+    const int current = ++generation;
+    remaining = cases.size();
+    RunLimits caseLimits = limits;
+    if (caseLimits.wallTime <= 0)
+        caseLimits.wallTime = int(qMax<qint64>(CaseTimeLimit, qint64(caseLimits.cpuTime) * 2));
+    const QStringList options = RunProfiler::isSupported() ? RunProfiler::limitOptions(caseLimits, addressSpace)
+                                                           : QStringList();
+    QSharedPointer<QAtomicInt> flag = cancelFlag;
+    for (int i = 0; i < cases.size(); ++i) {
+        const TestCase testCase = cases.at(i);
+        const QString report = RunProfiler::reportPath(QString("test-%1-%2.txt").arg(current).arg(i));
+        QtConcurrent::run(&pool, [this, binary, workingDirectory, testCase, i, options, report, current, flag] {
+            TestOutcome outcome = runCase(binary, workingDirectory, testCase, i, options, report, flag.data());
+            if (!flag->load())
+                emit outcomeReady(current, outcome);
+        });
+    }
+    if (cases.isEmpty())
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+void TestRunner::cancel()
+{
+    if (cancelFlag)
+        cancelFlag->store(1);
+    remaining = 0;
+}
+
+bool TestRunner::isRunning() const
+{
+    return remaining > 0;
+}
+
+void TestRunner::collectOutcome(int generation, const TestOutcome &outcome)
+{
+    if (generation != this->generation || remaining <= 0)
+        return;
+    emit caseFinished(outcome);
+    if (--remaining == 0)
+        emit finished();
+}
+
+// 后台线程：运行一个用例
+TestOutcome TestRunner::runCase(const QString &binary, const QString &workingDirectory, const TestCase &testCase,
+                                int index, const QStringList &limitOptions, const QString &report,
+                                const QAtomicInt *cancel)
+{
+    TestOutcome outcome;
+    outcome.index = index;
+    outcome.verdict = TestOutcome::Failed;
+    outcome.elapsed = 0;
+    QFile expected(testCase.expected);
+    if (!expected.open(QIODevice::ReadOnly)) {
+        outcome.detail = tr("无法打开期望输出：") + expected.errorString();
+        return outcome;
+    }
+    if (!QFile::exists(testCase.input)) {
+        outcome.detail = tr("输入文件不存在");
+        return outcome;
+    }
+    OutputComparator comparator(&expected);
+    QProcess process;
+    process.setWorkingDirectory(workingDirectory);
+    process.setStandardInputFile(testCase.input);
+    process.setStandardErrorFile(QProcess::nullDevice());
+    const bool wrapped = !limitOptions.isEmpty();
+    QElapsedTimer timer;
+    timer.start();
+    if (wrapped) {
+        QFile::remove(report);
+        process.start(QCoreApplication::applicationFilePath(),
+                      RunProfiler::wrapperArguments(report, binary, QStringList(), limitOptions));
+    } else {
+        process.start(binary, QStringList());
+    }
+    if (!process.waitForStarted()) {
+        outcome.detail = process.errorString();
+        return outcome;
+    }
+    // 包装进程收到 SIGTERM 会结束被测程序并清理 cgroup，不响应时再强行结束
+    auto stop = [&process, wrapped] {
+        if (wrapped) {
+            process.terminate();
+            if (process.waitForFinished(1000))
+                return;
+        }
+        process.kill();
+        process.waitForFinished();
+    };
+    for (;;) {
+        bool ready = process.waitForReadyRead(50);
+        if (ready && !comparator.feed(process.readAllStandardOutput())) {
+            // 已经确定答案错误，不必等程序运行完
+            stop();
+            QFile::remove(report);
+            outcome.elapsed = timer.nsecsElapsed() / 1000;
+            outcome.verdict = TestOutcome::WrongAnswer;
+            outcome.detail = comparator.difference();
+            return outcome;
+        }
+        if (!ready && process.state() == QProcess::NotRunning)
+            break;
+        if (cancel->load() || (!wrapped && timer.elapsed() > CaseTimeLimit)) {
+            stop();
+            QFile::remove(report);
+            outcome.elapsed = timer.nsecsElapsed() / 1000;
+            outcome.verdict = TestOutcome::TimeLimitExceeded;
+            outcome.detail = tr("超过 %1 秒").arg(CaseTimeLimit / 1000);
+            return outcome;
+        }
+    }
+    outcome.elapsed = timer.nsecsElapsed() / 1000;
+    bool same = comparator.feed(process.readAllStandardOutput()) && comparator.finish();
+    if (wrapped) {
+        RunProfile profile = RunProfiler::readReport(report);
+        QFile::remove(report);
+        if (!profile.valid) {
+            outcome.detail = tr("没有得到运行结果");
+            return outcome;
+        }
+        outcome.elapsed = profile.wallTime;
+        switch (profile.verdict) {
+        case RunProfile::TimeLimitExceeded:
+            outcome.verdict = TestOutcome::TimeLimitExceeded;
+            break;
+        case RunProfile::MemoryLimitExceeded:
+            outcome.verdict = TestOutcome::MemoryLimitExceeded;
+            break;
+        case RunProfile::OutputLimitExceeded:
+            outcome.verdict = TestOutcome::OutputLimitExceeded;
+            break;
+        case RunProfile::RuntimeError:
+            outcome.verdict = TestOutcome::RuntimeError;
+            break;
+        case RunProfile::Finished:
+            outcome.verdict = same ? TestOutcome::Passed : TestOutcome::WrongAnswer;
+            outcome.detail = same ? tr("峰值内存 %1 MB").arg(profile.peakMemory / 1024.0, 0, 'f', 1)
+                                  : comparator.difference();
+            return outcome;
+        }
+        outcome.detail = profile.verdictText();
+        return outcome;
+    }
+    if (process.exitStatus() != QProcess::NormalExit) {
+        outcome.verdict = TestOutcome::RuntimeError;
+        outcome.detail = tr("程序异常结束");
+    } else if (process.exitCode() != 0) {
+        outcome.verdict = TestOutcome::RuntimeError;
+        outcome.detail = tr("退出码 %1").arg(process.exitCode());
+    } else if (!same) {
+        outcome.verdict = TestOutcome::WrongAnswer;
+        outcome.detail = comparator.difference();
+    } else {
+        outcome.verdict = TestOutcome::Passed;
+    }
+    return outcome;
+}
+
+QString TestRunner::casesPath(const QString &source)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String("/tests");
+    QDir().mkpath(dir);
+    return dir + QLatin1Char('/')
+           + QString::fromLatin1(QCryptographicHash::hash(source.toUtf8(), QCryptographicHash::Sha1).toHex())
+           + QLatin1String(".json");
+}
+
+QVector<TestCase> TestRunner::casesFor(const QString &source)
+{
+    QVector<TestCase> cases;
+    QFile in(casesPath(source));
+    if (!in.open(QIODevice::ReadOnly))
+        return cases;
+    for (const QJsonValue &value : QJsonDocument::fromJson(in.readAll()).array()) {
+        QJsonObject object = value.toObject();
+        TestCase testCase;
+        testCase.input = object.value(QStringLiteral("input")).toString();
+        testCase.expected = object.value(QStringLiteral("expected")).toString();
+        cases.append(testCase);
+    }
+    return cases;
+}
+
+void TestRunner::saveCases(const QString &source, const QVector<TestCase> &cases)
+{
+    QJsonArray array;
+    for (const TestCase &testCase : cases) {
+        QJsonObject object;
+        object.insert(QStringLiteral("input"), testCase.input);
+        object.insert(QStringLiteral("expected"), testCase.expected);
+        array.append(object);
+    }
+    QSaveFile out(casesPath(source));
+    if (!out.open(QIODevice::WriteOnly))
+        return;
+    out.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+    out.commit();
+}
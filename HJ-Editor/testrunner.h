@@ -0,0 +1,106 @@
+#ifndef TESTRUNNER_H
+#define TESTRUNNER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include "runprofiler.h"
+
+class QIODevice;
+
+// 一个测试用例：标准输入文件与期望输出文件
+struct TestCase {
+    QString input;
+    QString expected;
+};
+
+struct TestOutcome {
+    enum Verdict {
+        Passed,
+        WrongAnswer,
+        RuntimeError,       // 非零退出码或被信号结束
+        TimeLimitExceeded,
+        MemoryLimitExceeded,
+        OutputLimitExceeded,
+        Failed              // 文件无法打开、程序无法启动
+    };
+    int index;          // 在用例列表中的序号
+    Verdict verdict;
+    qint64 elapsed;     // 微秒，从启动进程到结束
+    QString detail;     // 第一处不同、退出码等
+
+    static QString verdictName(Verdict verdict);
+};
+
+Q_DECLARE_METATYPE(TestOutcome)
+
+// 流式比较程序输出与期望输出：按行比较，忽略行尾空白与末尾的空行。
+// 期望输出边比较边读取，程序输出读到多少比较多少，内存占用与文件大小无关
+class OutputComparator
+{
+public:
+    explicit OutputComparator(QIODevice *expected);
+    // 出现不同后返回 false，之后的输出不再比较
+    bool feed(const QByteArray &data);
+    // 程序输出结束时调用，比较最后一行并检查期望输出是否还有剩余
+    bool finish();
+    QString difference() const;
+
+private:
+    bool compareLine(const QByteArray &actual);
+
+    QIODevice *expected;
+    QByteArray partial;   // 尚未遇到换行的输出
+    int line;
+    bool mismatched;
+    QString detail;
+};
+
+// 测试用例运行器：在线程池中同时运行所有用例（线程数为核数），标准输入直接从用例文件重定向，
+// 标准输出在读取时与期望输出流式比较，一旦不同立即结束该用例。
+// 启用运行限制时每个用例经包装进程运行，由包装进程限制资源并给出超时、超内存等判定；
+// 用例不会等待输入，没有设墙钟时间时按 CPU 时间的两倍（至少 10 秒）限制
+class TestRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TestRunner(QObject *parent = nullptr);
+    ~TestRunner();
+
+    // addressSpace 见 RunProfiler::limitOptions
+    void start(const QString &binary, const QString &workingDirectory, const QVector<TestCase> &cases,
+               const RunLimits &limits, bool addressSpace);
+    // 结束所有正在运行的用例，不再发出 caseFinished 与 finished
+    void cancel();
+    bool isRunning() const;
+
+    // 用例按源文件保存在应用数据目录下
+    static QVector<TestCase> casesFor(const QString &source);
+    static void saveCases(const QString &source, const QVector<TestCase> &cases);
+
+signals:
+    void caseFinished(const TestOutcome &outcome);
+    void finished();
+    // 在后台线程中发出，generation 用于丢弃已取消的运行的结果
+    void outcomeReady(int generation, const TestOutcome &outcome);
+
+private slots:
+    void collectOutcome(int generation, const TestOutcome &outcome);
+
+private:
+    static TestOutcome runCase(const QString &binary, const QString &workingDirectory, const TestCase &testCase,
+                               int index, const QStringList &limitOptions, const QString &report,
+                               const QAtomicInt *cancel);
+    static QString casesPath(const QString &source);
+
+    QThreadPool pool;   // 线程数为核数
+    QSharedPointer<QAtomicInt> cancelFlag;
+    int generation;
+    int remaining;
+};
+
+#endif // TESTRUNNER_H
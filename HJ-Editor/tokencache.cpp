@@ -0,0 +1,139 @@
+#include "tokencache.h"
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+
+namespace {
+
+const quint32 TokenMagic = 0x484A544B;  // "HJTK"
+// 高亮规则改变时递增，旧的缓存随之作废
+const quint32 TokenVersion = 1;
+
+} // namespace
+
+QString TokenCache::cacheFile(const QByteArray &contentHash, LanguageType lang)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String("/tokens");
+    QDir().mkpath(dir);
+    return dir + QLatin1Char('/') + QString::fromLatin1(contentHash.toHex()) + QLatin1Char('-')
+           + QString::number(lang) + QLatin1String(".tokens");
+}
+
+// 格式只有几种，存一张格式表，每个区间只记序号；整体压缩后写入
+bool TokenCache::save(const QByteArray &contentHash, LanguageType lang, const QTextDocument *document)
+{
+    if (contentHash.isEmpty() || !document)
+        return false;
+    const QString path = cacheFile(contentHash, lang);
+    if (QFileInfo::exists(path))
+        return true;   // 内容相同，高亮结果也相同
+
+    QVector<QTextCharFormat> formatTable;
+    QByteArray blocks;
+    QDataStream blockStream(&blocks, QIODevice::WriteOnly);
+    blockStream.setVersion(QDataStream::Qt_5_6);
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        const QVector<QTextLayout::FormatRange> formats = block.layout()->formats();
+        blockStream << qint32(block.userState()) << qint32(block.length() - 1) << qint32(formats.size());
+        for (const QTextLayout::FormatRange &range : formats) {
+            int index = formatTable.indexOf(range.format);
+            if (index < 0) {
+                index = formatTable.size();
+                formatTable.append(range.format);
+            }
+            blockStream << qint32(range.start) << qint32(range.length) << qint32(index);
+        }
+    }
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << qint32(formatTable.size());
+    for (const QTextCharFormat &format : formatTable)
+        stream << static_cast<const QTextFormat &>(format);
+    stream << qint32(document->blockCount()) << blocks;
+
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream header(&out);
+    header.setVersion(QDataStream::Qt_5_6);
+    header << TokenMagic << TokenVersion << contentHash << qCompress(payload);
+    if (!out.commit())
+        return false;
+    prune(QFileInfo(path).absolutePath());
+    return true;
+}
+
+QVector<BlockTokens> TokenCache::load(const QByteArray &contentHash, LanguageType lang)
+{
+    QVector<BlockTokens> result;
+    if (contentHash.isEmpty())
+        return result;
+    QFile in(cacheFile(contentHash, lang));
+    if (!in.open(QIODevice::ReadOnly))
+        return result;
+    QDataStream header(&in);
+    header.setVersion(QDataStream::Qt_5_6);
+    quint32 magic, version;
+    QByteArray hash, compressed;
+    header >> magic >> version >> hash >> compressed;
+    if (header.status() != QDataStream::Ok || magic != TokenMagic || version != TokenVersion || hash != contentHash)
+        return result;
+
+    QByteArray payload = qUncompress(compressed);
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_6);
+    qint32 formatCount;
+    stream >> formatCount;
+    QVector<QTextCharFormat> formatTable;
+    for (int i = 0; i < formatCount && stream.status() == QDataStream::Ok; ++i) {
+        QTextFormat format;
+        stream >> format;
+        formatTable.append(format.toCharFormat());
+    }
+    qint32 blockCount;
+    QByteArray blocks;
+    stream >> blockCount >> blocks;
+    // 每行至少有状态、长度与区间数三个 qint32，行数不可能超过数据所能容纳的
+    if (stream.status() != QDataStream::Ok || blockCount < 0 || blockCount > blocks.size() / 12)
+        return result;
+
+    QDataStream blockStream(blocks);
+    blockStream.setVersion(QDataStream::Qt_5_6);
+    result.reserve(blockCount);
+    for (int i = 0; i < blockCount; ++i) {
+        BlockTokens tokens;
+        qint32 state, length, rangeCount;
+        blockStream >> state >> length >> rangeCount;
+        tokens.state = state;
+        tokens.length = length;
+        for (int j = 0; j < rangeCount && blockStream.status() == QDataStream::Ok; ++j) {
+            qint32 start, rangeLength, index;
+            blockStream >> start >> rangeLength >> index;
+            if (index < 0 || index >= formatTable.size())
+                return QVector<BlockTokens>();
+            QTextLayout::FormatRange range;
+            range.start = start;
+            range.length = rangeLength;
+            range.format = formatTable.at(index);
+            tokens.formats.append(range);
+        }
+        if (blockStream.status() != QDataStream::Ok)
+            return QVector<BlockTokens>();
+        result.append(tokens);
+    }
+    return result;
+}
+
+void TokenCache::prune(const QString &dir)
+{
+    QFileInfoList files = QDir(dir).entryInfoList(QStringList() << QStringLiteral("*.tokens"), QDir::Files, QDir::Time);
+    for (int i = MaxFiles; i < files.size(); ++i)
+        QFile::remove(files.at(i).absoluteFilePath());
+}
@@ -0,0 +1,30 @@
+#ifndef TOKENCACHE_H
+#define TOKENCACHE_H
+
+#include <QByteArray>
+#include <QVector>
+#include "highlighter.h"
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+// 语法高亮结果的磁盘缓存，按文件内容的 SHA-1 与语言保存在应用数据目录的 tokens/ 下。
+// 重新打开内容没有变化的文件时先照缓存着色，不必等词法分析；同样的内容只写一次，
+// 最多保留 MaxFiles 个，多出时删除最旧的
+class TokenCache
+{
+public:
+    static const int MaxFiles = 64;
+
+    // 没有缓存或缓存无法读取时返回空
+    static QVector<BlockTokens> load(const QByteArray &contentHash, LanguageType lang);
+    // 保存文档当前的高亮结果，document 必须与 contentHash 对应且已完成词法分析
+    static bool save(const QByteArray &contentHash, LanguageType lang, const QTextDocument *document);
+
+private:
+    static QString cacheFile(const QByteArray &contentHash, LanguageType lang);
+    static void prune(const QString &dir);
+};
+
+#endif // TOKENCACHE_H
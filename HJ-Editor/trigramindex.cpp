@@ -0,0 +1,839 @@
+#include "trigramindex.h"
+#include "projectfiles.h"
+#include <QtConcurrent>
+#include <QFileSystemWatcher>
+#include <QGuiApplication>
+#include <QSaveFile>
+#include <QDir>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const quint32 IndexMagic = 0x4954484a;   // "JHTI"
+const quint32 IndexVersion = 2;
+const qint64 MaxIndexedFileSize = 256 << 20;   // 与多文件查找的上限一致
+const int MaxWatchedDirectories = 4096;        // inotify 监视数有限
+const qint64 TimestampSlack = 2000;            // 部分文件系统的修改时间精度只有 1~2 秒
+const qint64 RestatInterval = 30000;           // 窗口一直处于激活状态时，隔这么久才重新比对索引文件
+
+// 索引文件布局：文件头、文件表（文件在前，子目录在后）、路径字符串、三元组表（按三元组排序）、
+// 倒排表（文件号升序）。各段按 8 字节对齐，映射后可直接按结构体访问
+struct IndexHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 fileCount;
+    quint32 trigramCount;
+    quint32 directoryCount;
+    quint32 reserved;
+    quint64 filesOffset;
+    quint64 namesOffset;
+    quint64 trigramsOffset;
+    quint64 postingsOffset;
+    quint64 totalSize;
+};
+
+struct IndexFileEntry {
+    qint64 size;
+    qint64 modified;
+    quint32 nameOffset;
+    quint32 nameLength;
+};
+
+struct TrigramEntry {
+    quint32 trigram;
+    quint32 count;
+    quint64 offset;   // 以文件号为单位，相对倒排表起点
+};
+
+inline uchar foldByte(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? uchar(c + ('a' - 'A')) : c;
+}
+
+inline qint64 modifiedTime(const QFileInfo &info)
+{
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+inline bool isRepositoryDirectory(const QString &name)
+{
+    return name == QLatin1String(".git") || name == QLatin1String(".hg") || name == QLatin1String(".svn");
+}
+
+// 折叠大小写后按 UTF-8 保存；忽略大小写时非 ASCII 字符可能有别的大小写形式，在此断开
+void appendLiteral(QVector<QByteArray> *literals, const QString &run, bool foldsCase)
+{
+    QString part;
+    for (int i = 0; i <= run.size(); ++i) {
+        if (i < run.size() && !(foldsCase && run.at(i).unicode() >= 0x80)) {
+            part += run.at(i);
+            continue;
+        }
+        QByteArray bytes = part.toUtf8();
+        for (char &c : bytes)
+            c = char(foldByte(uchar(c)));
+        if (bytes.size() >= 3)
+            literals->append(bytes);
+        part.clear();
+    }
+}
+
+} // namespace
+
+TrigramIndex::TrigramIndex(QObject *parent) : QObject(parent)
+{
+    loaded = false;
+    verifying = false;
+    stale = false;
+    scanStarted = 0;
+    buildStarted = 0;
+    restatPending = false;
+    trigramTable = nullptr;
+    trigramCount = 0;
+    postingData = nullptr;
+    postingCount = 0;
+    pool.setMaxThreadCount(1);
+    watcher = new QFileSystemWatcher(this);
+    rescanTimer.setSingleShot(true);
+    rescanTimer.setInterval(300);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &TrigramIndex::directoryChanged);
+    connect(&rescanTimer, &QTimer::timeout, this, &TrigramIndex::rescanChangedDirectories);
+    connect(&buildWatcher, &QFutureWatcher<bool>::finished, this, &TrigramIndex::buildFinished);
+    connect(&verifyWatcher, &QFutureWatcher<Overlay>::finished, this, &TrigramIndex::verifyFinished);
+    connect(qApp, &QGuiApplication::applicationStateChanged, this, &TrigramIndex::applicationStateChanged);
+}
+
+TrigramIndex::~TrigramIndex()
+{
+    if (cancelFlag)
+        cancelFlag->storeRelease(1);
+    pool.waitForDone();
+    unload();
+}
+
+void TrigramIndex::open(const QString &root)
+{
+    QString path = QDir(root).absolutePath();
+    if (!path.endsWith(QLatin1Char('/')))
+        path += QLatin1Char('/');
+    if (path == rootPath)
+        return;
+
+    if (cancelFlag)
+        cancelFlag->storeRelease(1);
+    cancelFlag.reset(new QAtomicInt(0));
+    unload();
+    dirty.clear();
+    removed.clear();
+    changedDirectories.clear();
+    unwatched.clear();
+    stale = false;
+    if (!watcher->directories().isEmpty())
+        watcher->removePaths(watcher->directories());
+    rootPath = path;
+
+    if (load())
+        startVerify();
+    else
+        startBuild();
+}
+
+QString TrigramIndex::root() const
+{
+    return rootPath;
+}
+
+bool TrigramIndex::isReady() const
+{
+    return loaded && !verifying;
+}
+
+bool TrigramIndex::covers(const QString &directory) const
+{
+    if (rootPath.isEmpty())
+        return false;
+    return (QDir(directory).absolutePath() + QLatin1Char('/')).startsWith(rootPath);
+}
+
+QString TrigramIndex::indexPathFor(const QString &root)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/index");
+    QDir().mkpath(dir);
+    QByteArray key = QCryptographicHash::hash(root.toUtf8(), QCryptographicHash::Sha1);
+    return dir + QLatin1Char('/') + QString::fromLatin1(key.toHex()) + QLatin1String(".idx");
+}
+
+void TrigramIndex::startBuild()
+{
+    // 旧目录的建立已被取消，新的任务在单线程池中排在它后面
+    if (buildWatcher.isRunning() && buildRoot == rootPath)
+        return;
+    buildRoot = rootPath;
+    buildTimer.start();
+    buildStarted = QDateTime::currentMSecsSinceEpoch() - TimestampSlack;
+    QString root = rootPath;
+    QString indexPath = indexPathFor(rootPath);
+    QSharedPointer<QAtomicInt> cancel = cancelFlag;
+    buildWatcher.setFuture(QtConcurrent::run(&pool, [root, indexPath, cancel] {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        return build(root, indexPath, cancel.data());
+    }));
+}
+
+void TrigramIndex::startVerify()
+{
+    verifying = true;
+    buildTimer.start();
+    QString root = rootPath;
+    QHash<QString, int> ids = idOf;
+    QVector<qint64> sizes = this->sizes;
+    QVector<qint64> modified = this->modified;
+    QSet<QString> directories = this->directories;
+    QSharedPointer<QAtomicInt> cancel = cancelFlag;
+    verifyWatcher.setFuture(QtConcurrent::run(&pool, [root, ids, sizes, modified, directories, cancel] {
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        return verify(root, ids, sizes, modified, directories, cancel.data());
+    }));
+}
+
+bool TrigramIndex::build(const QString &root, const QString &indexPath, const QAtomicInt *cancel)
+{
+    QVector<IndexFileEntry> entries;
+    QByteArray names;
+    QHash<quint32, QVector<quint32>> lists;
+    QVector<quint64> seen(1 << 18);   // 2^24 位，标记当前文件中已出现的三元组
+    QVector<quint32> grams;
+    QVector<QByteArray> directories;
+    const int baseLength = root.size();
+
+    walkProject(root, [&](const QFileInfo &info) {
+        if (info.size() > MaxIndexedFileSize)
+            return true;
+        QFile file(info.absoluteFilePath());
+        if (!file.open(QIODevice::ReadOnly))
+            return true;
+        const qint64 size = file.size();
+        const uchar *bytes = nullptr;
+        QByteArray fallback;
+        if (size > 0) {
+            bytes = file.map(0, size);
+            if (!bytes) {
+                fallback = file.readAll();
+                bytes = reinterpret_cast<const uchar *>(fallback.constData());
+            }
+            // 二进制文件不进索引，多文件查找同样会跳过它们
+            if (memchr(bytes, 0, size_t(qMin<qint64>(size, 8192))))
+                return true;
+        }
+
+        grams.clear();
+        quint32 gram = 0;
+        for (qint64 i = 0; i < size; ++i) {
+            gram = ((gram << 8) | foldByte(bytes[i])) & 0xffffff;
+            if (i < 2)
+                continue;
+            quint64 &word = seen[gram >> 6];
+            const quint64 bit = quint64(1) << (gram & 63);
+            if (!(word & bit)) {
+                word |= bit;
+                grams.append(gram);
+            }
+        }
+        const quint32 id = quint32(entries.size());
+        for (quint32 g : grams) {
+            lists[g].append(id);
+            seen[g >> 6] = 0;
+        }
+        QByteArray name = info.absoluteFilePath().mid(baseLength).toUtf8();
+        entries.append({size, modifiedTime(info), quint32(names.size()), quint32(name.size())});
+        names += name;
+        return !cancel->loadAcquire();
+    }, cancel, [&](const QFileInfo &info) {
+        directories.append(info.absoluteFilePath().mid(baseLength).toUtf8());
+    });
+    if (cancel->loadAcquire())
+        return false;
+
+    // 子目录接在文件后面，不占文件号
+    const quint32 fileCount = quint32(entries.size());
+    for (const QByteArray &name : directories) {
+        entries.append({-1, 0, quint32(names.size()), quint32(name.size())});
+        names += name;
+    }
+
+    QVector<quint32> keys;
+    keys.reserve(lists.size());
+    for (auto it = lists.constBegin(); it != lists.constEnd(); ++it)
+        keys.append(it.key());
+    std::sort(keys.begin(), keys.end());
+    QVector<TrigramEntry> table;
+    table.reserve(keys.size());
+    quint64 offset = 0;
+    for (quint32 key : keys) {
+        const quint32 count = quint32(lists.value(key).size());
+        table.append({key, count, offset});
+        offset += count;
+    }
+    while (names.size() % 8)
+        names.append('\0');
+
+    IndexHeader header;
+    header.magic = IndexMagic;
+    header.version = IndexVersion;
+    header.fileCount = fileCount;
+    header.trigramCount = quint32(table.size());
+    header.directoryCount = quint32(directories.size());
+    header.reserved = 0;
+    header.filesOffset = sizeof(IndexHeader);
+    header.namesOffset = header.filesOffset + quint64(entries.size()) * sizeof(IndexFileEntry);
+    header.trigramsOffset = header.namesOffset + quint64(names.size());
+    header.postingsOffset = header.trigramsOffset + quint64(table.size()) * sizeof(TrigramEntry);
+    header.totalSize = header.postingsOffset + offset * sizeof(quint32);
+
+    QSaveFile out(indexPath);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.constData()), entries.size() * int(sizeof(IndexFileEntry)));
+    out.write(names);
+    out.write(reinterpret_cast<const char *>(table.constData()), table.size() * int(sizeof(TrigramEntry)));
+    for (quint32 key : keys) {
+        const QVector<quint32> &list = lists[key];
+        out.write(reinterpret_cast<const char *>(list.constData()), list.size() * int(sizeof(quint32)));
+    }
+    return out.commit();
+}
+
+TrigramIndex::Overlay TrigramIndex::verify(const QString &root, const QHash<QString, int> &ids, const QVector<qint64> &sizes,
+                                           const QVector<qint64> &modified, const QSet<QString> &directories,
+                                           const QAtomicInt *cancel)
+{
+    Overlay overlay;
+    overlay.started = QDateTime::currentMSecsSinceEpoch() - TimestampSlack;
+    QVector<bool> seen(sizes.size(), false);
+    walkProject(root, [&](const QFileInfo &info) {
+        if (info.size() > MaxIndexedFileSize)
+            return true;
+        const QString path = info.absoluteFilePath();
+        const int id = ids.value(path, -1);
+        if (id < 0) {
+            overlay.dirty << path;
+        } else {
+            seen[id] = true;
+            if (sizes.at(id) != info.size() || modified.at(id) != modifiedTime(info))
+                overlay.dirty << path;
+        }
+        return true;
+    }, cancel, [&](const QFileInfo &info) {
+        if (!directories.contains(info.absoluteFilePath()))
+            overlay.newDirectories = true;
+    });
+    if (cancel->loadAcquire())
+        return Overlay();
+    for (auto it = ids.constBegin(); it != ids.constEnd(); ++it) {
+        if (!seen.at(it.value()))
+            overlay.removed << it.key();
+    }
+    return overlay;
+}
+
+bool TrigramIndex::load()
+{
+    unload();
+    indexFile.setFileName(indexPathFor(rootPath));
+    if (!indexFile.open(QIODevice::ReadOnly))
+        return false;
+    const qint64 size = indexFile.size();
+    const uchar *data = size >= qint64(sizeof(IndexHeader)) ? indexFile.map(0, size) : nullptr;
+    if (!data) {
+        indexFile.close();
+        return false;
+    }
+    // 索引文件可能被截断或损坏：各段必须依次排列、互不重叠且都在文件之内
+    const IndexHeader *header = reinterpret_cast<const IndexHeader *>(data);
+    if (header->magic != IndexMagic || header->version != IndexVersion || header->totalSize != quint64(size)
+            || header->filesOffset < sizeof(IndexHeader) || header->filesOffset % 8 != 0
+            || header->filesOffset > header->namesOffset
+            || header->namesOffset > header->trigramsOffset || header->trigramsOffset % 8 != 0
+            || header->trigramsOffset > header->postingsOffset || header->postingsOffset % sizeof(quint32) != 0
+            || header->postingsOffset > quint64(size)
+            || (quint64(header->fileCount) + header->directoryCount) * sizeof(IndexFileEntry)
+               > header->namesOffset - header->filesOffset
+            || quint64(header->trigramCount) * sizeof(TrigramEntry) > header->postingsOffset - header->trigramsOffset) {
+        unload();
+        return false;
+    }
+
+    const IndexFileEntry *entries = reinterpret_cast<const IndexFileEntry *>(data + header->filesOffset);
+    const char *names = reinterpret_cast<const char *>(data + header->namesOffset);
+    const quint64 namesSize = header->trigramsOffset - header->namesOffset;
+    const quint64 entryCount = quint64(header->fileCount) + header->directoryCount;
+    for (quint64 i = 0; i < entryCount; ++i) {
+        if (quint64(entries[i].nameOffset) + entries[i].nameLength > namesSize) {
+            unload();
+            return false;
+        }
+    }
+    paths.reserve(int(header->fileCount));
+    sizes.reserve(int(header->fileCount));
+    modified.reserve(int(header->fileCount));
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        const IndexFileEntry &entry = entries[i];
+        const QString path = rootPath + QString::fromUtf8(names + entry.nameOffset, int(entry.nameLength));
+        paths.append(path);
+        sizes.append(entry.size);
+        modified.append(entry.modified);
+        idOf.insert(path, int(i));
+        filesInDirectory[path.left(path.lastIndexOf(QLatin1Char('/')))].append(int(i));
+    }
+    for (quint64 i = header->fileCount; i < entryCount; ++i) {
+        const IndexFileEntry &entry = entries[i];
+        directories.insert(rootPath + QString::fromUtf8(names + entry.nameOffset, int(entry.nameLength)));
+    }
+    trigramTable = data + header->trigramsOffset;
+    trigramCount = header->trigramCount;
+    postingData = reinterpret_cast<const quint32 *>(data + header->postingsOffset);
+    postingCount = (quint64(size) - header->postingsOffset) / sizeof(quint32);
+    loaded = true;
+    return true;
+}
+
+void TrigramIndex::unload()
+{
+    loaded = false;
+    verifying = false;
+    trigramTable = nullptr;
+    trigramCount = 0;
+    postingData = nullptr;
+    postingCount = 0;
+    paths.clear();
+    sizes.clear();
+    modified.clear();
+    idOf.clear();
+    filesInDirectory.clear();
+    directories.clear();
+    indexFile.close();   // 同时解除映射
+}
+
+void TrigramIndex::buildFinished()
+{
+    if (buildRoot != rootPath || !buildWatcher.result() || cancelFlag->loadAcquire())
+        return;
+    if (!load())
+        return;
+    stale = false;
+    scanStarted = buildStarted;
+    restatPending = false;
+    restatScope = rootPath;
+    sinceRestat.start();
+    validateOverlay();
+    watch();
+    emit ready(paths.size(), buildTimer.elapsed());
+}
+
+void TrigramIndex::verifyFinished()
+{
+    if (!verifying || cancelFlag->loadAcquire())
+        return;
+    const Overlay overlay = verifyWatcher.result();
+    for (const QString &path : overlay.dirty)
+        dirty.insert(path);
+    for (const QString &path : overlay.removed)
+        removed.insert(path);
+    verifying = false;
+    scanStarted = overlay.started;
+    restatPending = false;
+    restatScope = rootPath;
+    sinceRestat.start();
+    watch();
+    emit ready(paths.size(), buildTimer.elapsed());
+    if (overlay.newDirectories)
+        markStale();
+    else
+        scheduleRebuildIfNeeded();
+}
+
+// 新索引载入后，去掉已经反映在索引里的改动
+void TrigramIndex::validateOverlay()
+{
+    for (auto it = dirty.begin(); it != dirty.end();) {
+        const int id = idOf.value(*it, -1);
+        QFileInfo info(*it);
+        if (id >= 0 && info.exists() && sizes.at(id) == info.size() && modified.at(id) == modifiedTime(info))
+            it = dirty.erase(it);
+        else
+            ++it;
+    }
+    for (auto it = removed.begin(); it != removed.end();) {
+        if (!idOf.contains(*it))
+            it = removed.erase(it);
+        else
+            ++it;
+    }
+}
+
+// 监视根目录和索引中的全部子目录，浅层优先；超出上限或监视失败的目录记下来，查找时直接列出
+void TrigramIndex::watch()
+{
+    QStringList all = directories.values();
+    std::sort(all.begin(), all.end(), [](const QString &a, const QString &b) {
+        return a.count(QLatin1Char('/')) < b.count(QLatin1Char('/'));
+    });
+    all.prepend(rootPath.left(rootPath.size() - 1));
+
+    const QSet<QString> watched = QSet<QString>::fromList(watcher->directories());
+    QStringList toWatch;
+    unwatched.clear();
+    for (int i = 0; i < all.size(); ++i) {
+        if (i >= MaxWatchedDirectories)
+            unwatched << all.at(i);
+        else if (!watched.contains(all.at(i)))
+            toWatch << all.at(i);
+    }
+    if (!toWatch.isEmpty())
+        unwatched += watcher->addPaths(toWatch);
+}
+
+void TrigramIndex::directoryChanged(const QString &path)
+{
+    changedDirectories.insert(path);
+    rescanTimer.start();
+}
+
+void TrigramIndex::rescanChangedDirectories()
+{
+    for (const QString &dir : changedDirectories) {
+        const QVector<int> known = filesInDirectory.value(dir);
+        QSet<QString> present;
+        const QFileInfoList entries = QDir(dir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden
+                                                              | QDir::NoSymLinks);
+        for (const QFileInfo &info : entries) {
+            const QString path = info.absoluteFilePath();
+            if (info.isDir()) {
+                // 新的子目录里的文件都不在索引中，也没有被监视，只能重建
+                if (!stale && !directories.contains(path) && !isRepositoryDirectory(info.fileName())) {
+                    IgnoreRules rules;
+                    rules.addAncestors(rootPath, path);
+                    if (!rules.isIgnored(path, true))
+                        markStale();
+                }
+                continue;
+            }
+            if (!info.isFile())
+                continue;
+            present.insert(path);
+            const int id = idOf.value(path, -1);
+            if (id < 0 || sizes.at(id) != info.size() || modified.at(id) != modifiedTime(info))
+                dirty.insert(path);
+            removed.remove(path);
+        }
+        for (int id : known) {
+            if (!present.contains(paths.at(id)))
+                removed.insert(paths.at(id));
+        }
+        const QString prefix = dir + QLatin1Char('/');
+        for (auto it = dirty.begin(); it != dirty.end();) {
+            if (it->startsWith(prefix) && it->indexOf(QLatin1Char('/'), prefix.size()) < 0 && !present.contains(*it))
+                it = dirty.erase(it);
+            else
+                ++it;
+        }
+    }
+    changedDirectories.clear();
+    scheduleRebuildIfNeeded();
+}
+
+// 离开窗口期间其他程序可能原地改写了文件，目录监视收不到通知
+void TrigramIndex::applicationStateChanged(Qt::ApplicationState state)
+{
+    if (state == Qt::ApplicationActive)
+        restatPending = true;
+}
+
+void TrigramIndex::markDirty(const QString &path)
+{
+    const QString absolute = QFileInfo(path).absoluteFilePath();
+    if (rootPath.isEmpty() || !absolute.startsWith(rootPath))
+        return;
+    dirty.insert(absolute);
+    removed.remove(absolute);
+    scheduleRebuildIfNeeded();
+}
+
+void TrigramIndex::markStale()
+{
+    stale = true;
+    startBuild();
+}
+
+void TrigramIndex::scheduleRebuildIfNeeded()
+{
+    if (isReady() && dirty.size() + removed.size() > qMax(256, paths.size() / 10))
+        startBuild();
+}
+
+QVector<QByteArray> TrigramIndex::requiredLiterals(const FindQuery &query)
+{
+    QVector<QByteArray> literals;
+    if (!query.regex) {
+        appendLiteral(&literals, query.text, !query.caseSensitive);
+        return literals;
+    }
+
+    // 只从正则表达式的顶层提取必然出现的连续文字；分组整体跳过，顶层有 | 时放弃
+    const QString &pattern = query.text;
+    QRegularExpression inlineFlags(QStringLiteral("\\(\\?\\^?([a-zA-Z]*)"));
+    bool foldsCase = !query.caseSensitive;
+    QRegularExpressionMatchIterator flags = inlineFlags.globalMatch(pattern);
+    while (flags.hasNext()) {
+        const QString options = flags.next().captured(1);
+        if (options.contains(QLatin1Char('x')))
+            return QVector<QByteArray>();
+        if (options.contains(QLatin1Char('i')))
+            foldsCase = true;
+    }
+
+    QVector<QString> runs;
+    QString run;
+    auto flush = [&] {
+        if (!run.isEmpty())
+            runs.append(run);
+        run.clear();
+    };
+    int depth = 0;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('\\')) {
+            if (++i >= pattern.size())
+                break;
+            const QChar escaped = pattern.at(i);
+            if (escaped.isLetterOrNumber()) {
+                // \w \d \b 等只断开文字；\x41、\p{..} 等带参数的转义无法简单处理，放弃
+                if (!QStringLiteral("wWdDsSbBAzZhHvVRnrtfe").contains(escaped))
+                    return QVector<QByteArray>();
+                if (depth == 0)
+                    flush();
+            } else if (depth == 0) {
+                run += escaped;
+            }
+        } else if (c == QLatin1Char('[')) {
+            // 跳过字符集，注意开头的 ]、转义和 [:alpha:]
+            int j = i + 1;
+            if (j < pattern.size() && pattern.at(j) == QLatin1Char('^'))
+                ++j;
+            if (j < pattern.size() && pattern.at(j) == QLatin1Char(']'))
+                ++j;
+            for (; j < pattern.size() && pattern.at(j) != QLatin1Char(']'); ++j) {
+                if (pattern.at(j) == QLatin1Char('\\')) {
+                    ++j;
+                } else if (pattern.at(j) == QLatin1Char('[') && j + 1 < pattern.size() && pattern.at(j + 1) == QLatin1Char(':')) {
+                    int end = pattern.indexOf(QLatin1String(":]"), j + 2);
+                    if (end > 0)
+                        j = end + 1;
+                }
+            }
+            i = j;
+            if (depth == 0)
+                flush();
+        } else if (c == QLatin1Char('(')) {
+            if (depth++ == 0)
+                flush();
+        } else if (c == QLatin1Char(')')) {
+            if (depth > 0)
+                --depth;
+        } else if (depth > 0) {
+            continue;
+        } else if (c == QLatin1Char('|')) {
+            return QVector<QByteArray>();
+        } else if (c == QLatin1Char('*') || c == QLatin1Char('?') || c == QLatin1Char('{')) {
+            // 前一个字符可以不出现
+            run.chop(1);
+            flush();
+            if (c == QLatin1Char('{')) {
+                int end = pattern.indexOf(QLatin1Char('}'), i);
+                if (end > 0)
+                    i = end;
+            }
+        } else if (c == QLatin1Char('+') || c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$')) {
+            flush();
+        } else {
+            run += c;
+        }
+    }
+    flush();
+    for (const QString &text : runs)
+        appendLiteral(&literals, text, foldsCase);
+    return literals;
+}
+
+bool TrigramIndex::candidates(const FindQuery &query, const QString &directory, QStringList *files, Check *check)
+{
+    if (!isReady() || stale)
+        return false;
+    QVector<quint32> grams;
+    for (const QByteArray &literal : requiredLiterals(query)) {
+        const uchar *bytes = reinterpret_cast<const uchar *>(literal.constData());
+        for (int i = 2; i < literal.size(); ++i)
+            grams.append((quint32(bytes[i - 2]) << 16) | (quint32(bytes[i - 1]) << 8) | bytes[i]);
+    }
+    if (grams.isEmpty())
+        return false;
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+    // 取出各三元组的倒排表，从最短的开始求交集
+    struct Postings {
+        const quint32 *ids;
+        quint32 count;
+    };
+    QVector<Postings> lists;
+    const TrigramEntry *table = reinterpret_cast<const TrigramEntry *>(trigramTable);
+    bool missing = false;
+    for (quint32 gram : grams) {
+        const TrigramEntry *entry = std::lower_bound(table, table + trigramCount, gram,
+                                                     [](const TrigramEntry &e, quint32 value) { return e.trigram < value; });
+        if (entry == table + trigramCount || entry->trigram != gram) {
+            missing = true;
+            break;
+        }
+        if (entry->offset > postingCount || entry->count > postingCount - entry->offset) {
+            markStale();
+            return false;
+        }
+        lists.append({postingData + entry->offset, entry->count});
+    }
+    QVector<quint32> result;
+    if (!missing) {
+        std::sort(lists.begin(), lists.end(), [](const Postings &a, const Postings &b) { return a.count < b.count; });
+        result.resize(int(lists.first().count));
+        std::copy(lists.first().ids, lists.first().ids + lists.first().count, result.begin());
+        QVector<quint32> next;
+        for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+            next.resize(result.size());
+            auto end = std::set_intersection(result.constBegin(), result.constEnd(),
+                                             lists.at(i).ids, lists.at(i).ids + lists.at(i).count, next.begin());
+            next.resize(int(end - next.begin()));
+            result.swap(next);
+        }
+    }
+
+    // 倒排表在查询时才检查（载入时不扫描整个倒排表），损坏的索引退回完整遍历并在后台重建
+    const QString prefix = QDir(directory).absolutePath() + QLatin1Char('/');
+    files->clear();
+    for (quint32 id : result) {
+        if (id >= quint32(paths.size())) {
+            files->clear();
+            markStale();
+            return false;
+        }
+        const QString &path = paths.at(int(id));
+        if (path.startsWith(prefix) && !removed.contains(path) && !dirty.contains(path))
+            files->append(path);
+    }
+    for (const QString &path : dirty) {
+        if (path.startsWith(prefix))
+            files->append(path);
+    }
+
+    check->root = rootPath;
+    check->prefix = prefix;
+    check->paths = paths;
+    check->sizes = sizes;
+    check->modified = modified;
+    check->ids = idOf;
+    check->directories = directories;
+    check->skip = QSet<QString>::fromList(*files) + removed;
+    check->unwatched.clear();
+    for (const QString &dir : unwatched) {
+        if ((dir + QLatin1Char('/')).startsWith(prefix))
+            check->unwatched << dir;
+    }
+    check->since = scanStarted;
+    // 逐个 stat 范围内的全部文件与文件数成正比，只在可能漏掉改动时才做
+    check->restat = restatPending || !sinceRestat.isValid() || sinceRestat.hasExpired(RestatInterval)
+            || !prefix.startsWith(restatScope);
+    if (check->restat) {
+        restatPending = false;
+        restatScope = prefix;
+        sinceRestat.start();
+    }
+    return true;
+}
+
+void TrigramIndex::checkFinished(const QString &root, const QStringList &changed, bool complete)
+{
+    if (root != rootPath || !isReady())
+        return;
+    for (const QString &path : changed) {
+        dirty.insert(path);
+        removed.remove(path);
+    }
+    if (!complete)
+        restatPending = true;   // 比对被打断，下次查找重新来过
+    scheduleRebuildIfNeeded();
+}
+
+bool TrigramIndex::runCheck(const Check &check, const ProjectFileCallback &onFile, const QAtomicInt *cancel,
+                            QStringList *changed)
+{
+    // 原地改写不会改变目录，监视收不到通知
+    for (int id = 0; check.restat && id < check.paths.size(); ++id) {
+        const QString &path = check.paths.at(id);
+        if (!path.startsWith(check.prefix) || check.skip.contains(path))
+            continue;
+        if (cancel->loadAcquire())
+            return false;
+        QFileInfo info(path);
+        if (info.isFile() && (info.size() != check.sizes.at(id) || modifiedTime(info) != check.modified.at(id))) {
+            changed->append(path);
+            if (!onFile(info))
+                return false;
+        }
+    }
+
+    for (const QString &dir : check.unwatched) {
+        if (cancel->loadAcquire())
+            return false;
+        if (modifiedTime(QFileInfo(dir)) < check.since)
+            continue;
+        IgnoreRules rules;
+        rules.addAncestors(check.root, dir);
+        rules.addDirectory(dir);
+        const QFileInfoList entries = QDir(dir).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden
+                                                              | QDir::NoSymLinks);
+        for (const QFileInfo &info : entries) {
+            const QString path = info.absoluteFilePath();
+            if (info.isDir()) {
+                if (!check.directories.contains(path) && !isRepositoryDirectory(info.fileName())
+                        && !rules.isIgnored(path, true))
+                    walkProject(path, onFile, cancel, ProjectDirectoryCallback(), &rules);
+            } else if (info.isFile() && !check.ids.contains(path) && !check.skip.contains(path)
+                       && !rules.isIgnored(path, false)) {
+                if (!onFile(info))
+                    return false;
+            }
+        }
+    }
+    return !cancel->loadAcquire();
+}
+
+QStringList TrigramIndex::files() const
+{
+    if (!isReady())
+        return QStringList();
+    QStringList result;
+    result.reserve(paths.size() + dirty.size());
+    for (const QString &path : paths) {
+        if (!removed.contains(path))
+            result.append(path);
+    }
+    for (const QString &path : dirty) {
+        if (!idOf.contains(path))
+            result.append(path);
+    }
+    return result;
+}
@@ -0,0 +1,139 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QThreadPool>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include "findengine.h"
+#include "projectfiles.h"
+
+QT_BEGIN_NAMESPACE
+class QFileSystemWatcher;
+QT_END_NAMESPACE
+
+// 项目目录的三元组索引：记录每个文件包含哪些三字节组（ASCII 字母折叠为小写），
+// 倒排表保存在磁盘上，查询时内存映射。查找前先用查询中必然出现的文字求候选文件，
+// 再由查找内核逐个校验，索引只会多给候选、不会漏掉文件。
+// 建立索引之后的改动记在“脏文件”集合里（目录监视与保存时通知），这些文件总是作为候选；
+// 改动积累过多时在后台整体重建。目录监视看不到的改动由查找时的补查兜底：原地改写的文件
+// 比对大小与修改时间（窗口重新激活后或距上次比对超过一定时间才做），超出监视上限的目录
+// 直接列出；出现新的子目录时索引作废，退回完整遍历。
+class TrigramIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TrigramIndex(QObject *parent = nullptr);
+    ~TrigramIndex();
+
+    // 载入 root 的索引并开始监视；磁盘上没有索引时在后台建立
+    void open(const QString &root);
+    QString root() const;
+    bool isReady() const;
+    bool covers(const QString &directory) const;
+
+    // 候选之外需要在查找线程里补查的文件，内容为索引数据的隐式共享副本
+    struct Check {
+        QString root;
+        QString prefix;               // 查找范围，以 / 结尾
+        QStringList paths;
+        QVector<qint64> sizes;
+        QVector<qint64> modified;
+        QHash<QString, int> ids;
+        QSet<QString> directories;
+        QSet<QString> skip;           // 已经作为候选或已删除
+        QStringList unwatched;        // 范围内没能监视的目录
+        qint64 since;                 // 此后修改过的未监视目录才需要列出
+        bool restat;                  // 是否重新比对范围内全部索引文件的大小与修改时间
+    };
+
+    // directory 下可能含有匹配的文件；索引无法缩小范围（查询太短、含有顶层 | 等）
+    // 或已经过时时返回 false。check 中的文件须另行交给 runCheck 补查
+    bool candidates(const FindQuery &query, const QString &directory, QStringList *files, Check *check);
+    // 对索引中改过的文件、未监视目录中新出现的文件调用 onFile；比对出改过的索引文件放进 changed。
+    // 没有被取消或中途停止时返回 true
+    static bool runCheck(const Check &check, const ProjectFileCallback &onFile, const QAtomicInt *cancel,
+                         QStringList *changed);
+    // 在主线程中接收 runCheck 的结果：改过的文件记为脏文件，之后的查找不必再比对
+    void checkFinished(const QString &root, const QStringList &changed, bool complete);
+    // 索引中的全部文件（已包含脏文件、去掉已删除的文件）
+    QStringList files() const;
+    void markDirty(const QString &path);
+
+signals:
+    void ready(int files, qint64 elapsed);
+
+private slots:
+    void buildFinished();
+    void verifyFinished();
+    void directoryChanged(const QString &path);
+    void rescanChangedDirectories();
+    void applicationStateChanged(Qt::ApplicationState state);
+
+private:
+    struct Overlay {
+        QStringList dirty;
+        QStringList removed;
+        bool newDirectories = false;
+        qint64 started = 0;
+    };
+    static bool build(const QString &root, const QString &indexPath, const QAtomicInt *cancel);
+    static Overlay verify(const QString &root, const QHash<QString, int> &ids, const QVector<qint64> &sizes,
+                          const QVector<qint64> &modified, const QSet<QString> &directories,
+                          const QAtomicInt *cancel);
+    static QVector<QByteArray> requiredLiterals(const FindQuery &query);
+    static QString indexPathFor(const QString &root);
+    void startBuild();
+    void startVerify();
+    bool load();
+    void unload();
+    void watch();
+    void validateOverlay();
+    void scheduleRebuildIfNeeded();
+    void markStale();
+
+    QString rootPath;   // 以 / 结尾
+    bool loaded;
+    bool verifying;
+    bool stale;         // 出现了索引之外的子目录，重建完成前不再缩小范围
+    QFile indexFile;
+    const uchar *trigramTable;
+    quint32 trigramCount;
+    const quint32 *postingData;
+    quint64 postingCount;
+    // 文件表（载入时解码一次）
+    QStringList paths;
+    QVector<qint64> sizes;
+    QVector<qint64> modified;
+    QHash<QString, int> idOf;
+    QHash<QString, QVector<int>> filesInDirectory;
+    QSet<QString> directories;   // 建立索引时存在的子目录（包括空目录）
+    // 索引建立之后的改动
+    QSet<QString> dirty;
+    QSet<QString> removed;
+
+    QFileSystemWatcher *watcher;
+    QSet<QString> changedDirectories;
+    QStringList unwatched;
+    qint64 scanStarted;    // 当前索引（及其校验）开始遍历的时间
+    qint64 buildStarted;
+    bool restatPending;         // 窗口重新激活过，下次查找时比对索引文件
+    QString restatScope;        // 上次比对覆盖的目录，以 / 结尾
+    QElapsedTimer sinceRestat;
+    QTimer rescanTimer;
+    QThreadPool pool;   // 单线程，建立与校验依次进行
+    QFutureWatcher<bool> buildWatcher;
+    QString buildRoot;
+    QFutureWatcher<Overlay> verifyWatcher;
+    QSharedPointer<QAtomicInt> cancelFlag;
+    QElapsedTimer buildTimer;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,487 @@
+#include "undohistory.h"
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace {
+
+const int MinGap = 4096;
+const qint64 DefaultBudget = 32 << 20;
+const int CompressThreshold = 4096;   // 超过该大小的增量在内存中也压缩保存
+const qint64 MergeInterval = 1500;    // 连续输入在该时间内合并为一步（毫秒）
+const int MaxMergeLength = 256;
+const quint32 HistoryMagic = 0x484A5548;  // "HJUH"
+const quint32 HistoryVersion = 1;
+
+QString textAt(QTextDocument *document, int position, int length)
+{
+    if (length <= 0)
+        return QString();
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    return text;
+}
+
+} // namespace
+
+TextMirror::TextMirror() : gapStart(0), gapEnd(0)
+{
+}
+
+void TextMirror::reset(const QString &text)
+{
+    buffer.resize(text.size() + MinGap);
+    if (!text.isEmpty())
+        memcpy(buffer.data(), text.constData(), text.size() * sizeof(QChar));
+    gapStart = text.size();
+    gapEnd = buffer.size();
+}
+
+int TextMirror::size() const
+{
+    return buffer.size() - (gapEnd - gapStart);
+}
+
+QString TextMirror::mid(int position, int length) const
+{
+    QString result(length, Qt::Uninitialized);
+    const QChar *data = buffer.constData();
+    QChar *out = result.data();
+    // 间隙之前的部分
+    int front = qBound(0, gapStart - position, length);
+    if (front > 0)
+        memcpy(out, data + position, front * sizeof(QChar));
+    // 间隙之后的部分
+    if (length > front) {
+        int logical = position + front;
+        memcpy(out + front, data + logical + (gapEnd - gapStart), (length - front) * sizeof(QChar));
+    }
+    return result;
+}
+
+void TextMirror::replace(int position, int removed, const QString &text)
+{
+    moveGap(position);
+    gapEnd += removed;
+    ensureGap(text.size());
+    if (!text.isEmpty())
+        memcpy(buffer.data() + gapStart, text.constData(), text.size() * sizeof(QChar));
+    gapStart += text.size();
+}
+
+void TextMirror::squeeze()
+{
+    buffer.squeeze();
+}
+
+void TextMirror::moveGap(int position)
+{
+    QChar *data = buffer.data();
+    if (position < gapStart) {
+        int count = gapStart - position;
+        memmove(data + gapEnd - count, data + position, count * sizeof(QChar));
+        gapEnd -= count;
+        gapStart = position;
+    } else if (position > gapStart) {
+        int count = position - gapStart;
+        memmove(data + gapStart, data + gapEnd, count * sizeof(QChar));
+        gapStart += count;
+        gapEnd += count;
+    }
+}
+
+void TextMirror::ensureGap(int length)
+{
+    if (gapEnd - gapStart >= length)
+        return;
+    int back = buffer.size() - gapEnd;
+    int capacity = size() + length + qMax(MinGap, size() / 8);
+    QVector<QChar> grown(capacity);
+    memcpy(grown.data(), buffer.constData(), gapStart * sizeof(QChar));
+    memcpy(grown.data() + capacity - back, buffer.constData() + gapEnd, back * sizeof(QChar));
+    buffer.swap(grown);
+    gapEnd = capacity - back;
+}
+
+UndoHistory::UndoHistory(QTextDocument *document, QObject *parent)
+    : QObject(parent), document(nullptr)
+{
+    index = 0;
+    firstInMemory = 0;
+    memoryUsed = 0;
+    budget = DefaultBudget;
+    enabled = true;
+    applying = false;
+    lastRevision = -1;
+    spillFile.setFileTemplate(QDir::tempPath() + QLatin1String("/hj-undo-XXXXXX.spill"));
+    clock.start();
+    setDocument(document);
+}
+
+UndoHistory::~UndoHistory()
+{
+}
+
+void UndoHistory::setDocument(QTextDocument *document)
+{
+    if (this->document)
+        disconnect(this->document, nullptr, this, nullptr);
+    this->document = document;
+    clear();
+    if (document) {
+        // 由本类接管撤销，关闭文档自带的撤销栈
+        document->setUndoRedoEnabled(false);
+        connect(document, &QTextDocument::contentsChange, this, &UndoHistory::contentsChanged);
+    }
+    resetMirror();
+}
+
+void UndoHistory::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+    if (enabled) {
+        clear();
+        resetMirror();
+    }
+}
+
+void UndoHistory::clear()
+{
+    truncate(0);
+    index = 0;
+    firstInMemory = 0;
+    memoryUsed = 0;
+    if (spillFile.isOpen())
+        spillFile.resize(0);
+    emit changed();
+}
+
+void UndoHistory::resetMirror()
+{
+    if (document && enabled) {
+        mirror.reset(document->toPlainText());
+        lastRevision = document->revision();
+    } else {
+        mirror.reset(QString());
+        mirror.squeeze();
+    }
+}
+
+bool UndoHistory::canUndo() const
+{
+    return index > 0;
+}
+
+bool UndoHistory::canRedo() const
+{
+    return index < entries.size();
+}
+
+int UndoHistory::undo()
+{
+    if (!document || !canUndo())
+        return -1;
+    const Delta delta = entries.at(index - 1);
+    QString removedText, addedText;
+    unpack(delta, &removedText, &addedText);
+    apply(delta.position, delta.addedLength, removedText);
+    --index;
+    emit changed();
+    return delta.position + delta.removedLength;
+}
+
+int UndoHistory::redo()
+{
+    if (!document || !canRedo())
+        return -1;
+    const Delta delta = entries.at(index);
+    QString removedText, addedText;
+    unpack(delta, &removedText, &addedText);
+    apply(delta.position, delta.removedLength, addedText);
+    ++index;
+    emit changed();
+    return delta.position + delta.addedLength;
+}
+
+void UndoHistory::setMemoryBudget(qint64 bytes)
+{
+    budget = bytes;
+    enforceBudget();
+}
+
+qint64 UndoHistory::memoryBudget() const
+{
+    return budget;
+}
+
+qint64 UndoHistory::memoryUsage() const
+{
+    return memoryUsed;
+}
+
+void UndoHistory::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    int revision = document->revision();
+    if (charsRemoved == charsAdded && revision == lastRevision)
+        return;  // 只有格式变化（如语法高亮）
+    lastRevision = revision;
+    if (!enabled)
+        return;
+
+    // 整篇替换时 contentsChange 的计数包含末尾的段落分隔符，按实际长度修正
+    int newLength = document->characterCount() - 1;
+    int removed = qMax(0, qMin(charsRemoved, mirror.size() - position));
+    int added = qMax(0, qMin(charsAdded, newLength - position));
+    QString removedText = mirror.mid(position, removed);
+    QString addedText = textAt(document, position, added);
+    mirror.replace(position, removed, addedText);
+
+    if (mirror.size() != newLength) {
+        // 镜像与文档不一致时放弃历史，保证之后的撤销不会破坏文本
+        clear();
+        resetMirror();
+        return;
+    }
+    if (!applying)
+        record(position, removedText, addedText);
+}
+
+void UndoHistory::record(int position, const QString &removedText, const QString &addedText)
+{
+    // 新的编辑会丢弃重做分支
+    truncate(index);
+    if (!merge(position, removedText, addedText)) {
+        Delta delta;
+        delta.position = position;
+        delta.removedLength = removedText.size();
+        delta.addedLength = addedText.size();
+        delta.removed = removedText.toUtf8();
+        delta.added = addedText.toUtf8();
+        delta.compressed = delta.removed.size() + delta.added.size() > CompressThreshold;
+        if (delta.compressed) {
+            delta.removed = qCompress(delta.removed, 1);
+            delta.added = qCompress(delta.added, 1);
+        }
+        delta.timestamp = clock.elapsed();
+        delta.spillOffset = -1;
+        entries.append(delta);
+        memoryUsed += cost(delta);
+    }
+    index = entries.size();
+    enforceBudget();
+    emit changed();
+}
+
+// 连续输入、连续退格/删除合并为一步撤销
+bool UndoHistory::merge(int position, const QString &removedText, const QString &addedText)
+{
+    if (index == 0 || index <= firstInMemory)
+        return false;
+    Delta &last = entries[index - 1];
+    qint64 now = clock.elapsed();
+    if (last.compressed || now - last.timestamp > MergeInterval)
+        return false;
+
+    if (removedText.isEmpty() && last.removedLength == 0 && !addedText.contains(QLatin1Char('\n'))
+            && position == last.position + last.addedLength
+            && last.addedLength + addedText.size() <= MaxMergeLength) {
+        QByteArray bytes = addedText.toUtf8();
+        last.added += bytes;
+        last.addedLength += addedText.size();
+        memoryUsed += bytes.size();
+    } else if (addedText.isEmpty() && last.addedLength == 0 && !removedText.contains(QLatin1Char('\n'))
+               && last.removedLength + removedText.size() <= MaxMergeLength) {
+        QByteArray bytes = removedText.toUtf8();
+        if (position + removedText.size() == last.position) {
+            last.removed.prepend(bytes);  // 退格
+            last.position = position;
+        } else if (position == last.position) {
+            last.removed.append(bytes);   // Delete
+        } else {
+            return false;
+        }
+        last.removedLength += removedText.size();
+        memoryUsed += bytes.size();
+    } else {
+        return false;
+    }
+    last.timestamp = now;
+    return true;
+}
+
+void UndoHistory::truncate(int count)
+{
+    if (count >= entries.size())
+        return;
+    qint64 spillEnd = -1;
+    for (int i = count; i < entries.size(); ++i) {
+        const Delta &delta = entries.at(i);
+        if (delta.spillOffset >= 0) {
+            if (spillEnd < 0)
+                spillEnd = delta.spillOffset;
+        } else {
+            memoryUsed -= cost(delta);
+        }
+    }
+    entries.erase(entries.begin() + count, entries.end());
+    // 溢出文件按顺序追加，截掉被丢弃条目占用的尾部
+    if (spillEnd >= 0)
+        spillFile.resize(spillEnd);
+    firstInMemory = qMin(firstInMemory, count);
+}
+
+void UndoHistory::enforceBudget()
+{
+    // 最近的一步始终留在内存中
+    while (memoryUsed > budget && firstInMemory < index - 1) {
+        if (!spill(entries[firstInMemory]))
+            break;
+        ++firstInMemory;
+    }
+}
+
+bool UndoHistory::spill(Delta &delta)
+{
+    if (!spillFile.isOpen() && !spillFile.open())
+        return false;
+    memoryUsed -= cost(delta);
+    if (!delta.compressed) {
+        delta.removed = qCompress(delta.removed);
+        delta.added = qCompress(delta.added);
+        delta.compressed = true;
+    }
+    qint64 offset = spillFile.size();
+    spillFile.seek(offset);
+    QDataStream out(&spillFile);
+    out << delta.removed << delta.added;
+    delta.spillOffset = offset;
+    delta.removed.clear();
+    delta.added.clear();
+    memoryUsed += cost(delta);
+    return true;
+}
+
+void UndoHistory::payload(const Delta &delta, QByteArray *removed, QByteArray *added)
+{
+    if (delta.spillOffset >= 0) {
+        spillFile.seek(delta.spillOffset);
+        QDataStream in(&spillFile);
+        in >> *removed >> *added;
+    } else {
+        *removed = delta.removed;
+        *added = delta.added;
+    }
+}
+
+void UndoHistory::unpack(const Delta &delta, QString *removedText, QString *addedText)
+{
+    QByteArray removed, added;
+    payload(delta, &removed, &added);
+    if (delta.compressed) {
+        removed = qUncompress(removed);
+        added = qUncompress(added);
+    }
+    *removedText = QString::fromUtf8(removed);
+    *addedText = QString::fromUtf8(added);
+}
+
+void UndoHistory::apply(int position, int length, const QString &text)
+{
+    applying = true;
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    if (text.isEmpty())
+        cursor.removeSelectedText();
+    else
+        cursor.insertText(text);
+    cursor.endEditBlock();
+    applying = false;
+}
+
+qint64 UndoHistory::cost(const Delta &delta)
+{
+    return sizeof(Delta) + delta.removed.size() + delta.added.size();
+}
+
+QString UndoHistory::historyFile(const QString &filePath)
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String("/undo");
+    QDir().mkpath(dir);
+    QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+    return dir + QLatin1Char('/') + QString::fromLatin1(key.toHex()) + QLatin1String(".undo");
+}
+
+bool UndoHistory::save(const QString &filePath, const QByteArray &contentHash)
+{
+    QSaveFile out(historyFile(filePath));
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+    return save(&out, contentHash) && out.commit();
+}
+
+bool UndoHistory::load(const QString &filePath, const QByteArray &contentHash)
+{
+    QFile in(historyFile(filePath));
+    if (!in.open(QIODevice::ReadOnly))
+        return false;
+    return load(&in, contentHash);
+}
+
+bool UndoHistory::save(QIODevice *out, const QByteArray &contentHash)
+{
+    QDataStream stream(out);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << HistoryMagic << HistoryVersion << contentHash << qint32(index) << qint32(entries.size());
+    for (const Delta &delta : entries) {
+        QByteArray removed, added;
+        payload(delta, &removed, &added);
+        stream << qint32(delta.position) << qint32(delta.removedLength) << qint32(delta.addedLength)
+               << delta.compressed << removed << added;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool UndoHistory::load(QIODevice *in, const QByteArray &contentHash)
+{
+    QDataStream stream(in);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic, version;
+    QByteArray hash;
+    qint32 savedIndex, count;
+    stream >> magic >> version >> hash >> savedIndex >> count;
+    // 文件在外部被修改过，历史不再适用
+    if (stream.status() != QDataStream::Ok || magic != HistoryMagic || version != HistoryVersion || hash != contentHash)
+        return false;
+
+    clear();
+    for (int i = 0; i < count; ++i) {
+        Delta delta;
+        qint32 position, removedLength, addedLength;
+        stream >> position >> removedLength >> addedLength >> delta.compressed >> delta.removed >> delta.added;
+        if (stream.status() != QDataStream::Ok)
+            break;
+        delta.position = position;
+        delta.removedLength = removedLength;
+        delta.addedLength = addedLength;
+        delta.timestamp = -MergeInterval - 1;  // 载入的历史不参与合并
+        delta.spillOffset = -1;
+        entries.append(delta);
+        memoryUsed += cost(delta);
+    }
+    index = qBound(0, int(savedIndex), entries.size());
+    enforceBudget();
+    emit changed();
+    return true;
+}
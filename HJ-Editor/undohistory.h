@@ -0,0 +1,114 @@
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QTemporaryFile>
+#include <QElapsedTimer>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+// 文档文本的镜像（间隙缓冲区），用来在 contentsChange 之后取回被删除的文本。
+// 连续的局部编辑只移动间隙附近的数据，不会每次搬移整篇文档。
+class TextMirror
+{
+public:
+    TextMirror();
+    void reset(const QString &text);
+    int size() const;
+    QString mid(int position, int length) const;
+    void replace(int position, int removed, const QString &text);
+    void squeeze();
+
+private:
+    void moveGap(int position);
+    void ensureGap(int length);
+
+    QVector<QChar> buffer;
+    int gapStart;
+    int gapEnd;
+};
+
+// 撤销历史：替代 QTextDocument 无上限的撤销栈。
+// 每一步只保存增量（UTF-8 编码，大的增量再压缩），超出内存预算后把最早的历史
+// 压缩写入磁盘上的溢出文件；文件保存后还可以按内容哈希持久化，重新打开时继续撤销。
+class UndoHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UndoHistory(QTextDocument *document, QObject *parent = nullptr);
+    ~UndoHistory();
+
+    // 切换到另一个文档（或 nullptr 暂时脱离），历史会被清空
+    void setDocument(QTextDocument *document);
+    // 关闭记录（整篇载入文本时），重新开启时以当前文本为起点并清空历史
+    void setEnabled(bool enabled);
+    void clear();
+
+    bool canUndo() const;
+    bool canRedo() const;
+    // 撤销/重做一步，返回建议的光标位置，没有可执行的步骤时返回 -1
+    int undo();
+    int redo();
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const;
+    qint64 memoryUsage() const;  // 内存中历史占用的字节数（不含文本镜像）
+
+    // 按文件路径持久化，contentHash 为磁盘内容的 SHA-1，用于判断历史是否仍然适用
+    bool save(const QString &filePath, const QByteArray &contentHash);
+    bool load(const QString &filePath, const QByteArray &contentHash);
+    // 写入/读回任意设备（例如标签页休眠期间的临时文件）
+    bool save(QIODevice *out, const QByteArray &contentHash);
+    bool load(QIODevice *in, const QByteArray &contentHash);
+
+signals:
+    void changed();
+
+private slots:
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+
+private:
+    struct Delta {
+        int position;
+        int removedLength;   // 以 QChar 计
+        int addedLength;
+        QByteArray removed;  // UTF-8，compressed 时为 qCompress 结果
+        QByteArray added;
+        bool compressed;
+        qint64 timestamp;
+        qint64 spillOffset;  // 已写入溢出文件时为文件偏移，否则为 -1
+    };
+
+    void record(int position, const QString &removedText, const QString &addedText);
+    bool merge(int position, const QString &removedText, const QString &addedText);
+    void truncate(int count);
+    void enforceBudget();
+    bool spill(Delta &delta);
+    void payload(const Delta &delta, QByteArray *removed, QByteArray *added);
+    void unpack(const Delta &delta, QString *removedText, QString *addedText);
+    void apply(int position, int length, const QString &text);
+    void resetMirror();
+    static qint64 cost(const Delta &delta);
+    static QString historyFile(const QString &filePath);
+
+    QTextDocument *document;
+    TextMirror mirror;
+    QVector<Delta> entries;
+    int index;           // 下一步撤销的是 entries[index - 1]
+    int firstInMemory;   // 之前的条目都已溢出到磁盘
+    qint64 memoryUsed;
+    qint64 budget;
+    QTemporaryFile spillFile;
+    QElapsedTimer clock;
+    bool enabled;
+    bool applying;
+    int lastRevision;
+};
+
+#endif // UNDOHISTORY_H